@@ -45,7 +45,7 @@
 #define LLPC_INTERFACE_MAJOR_VERSION 40
 
 /// LLPC minor interface version.
-#define LLPC_INTERFACE_MINOR_VERSION 0
+#define LLPC_INTERFACE_MINOR_VERSION 2
 
 #ifndef LLPC_CLIENT_INTERFACE_MAJOR_VERSION
 #if VFX_INSIDE_SPVGEN
@@ -69,6 +69,8 @@
 //* %Version History
 //* | %Version | Change Description                                                                                    |
 //* | -------- | ----------------------------------------------------------------------------------------------------- |
+//* |     40.2 | Added loadScalarizerCostModel to PipelineShaderOptions                                                |
+//* |     40.1 | Added fastCompile to PipelineOptions                                                                  |
 //* |     40.0 | Added DescriptorReserved12, which moves DescriptorYCbCrSampler down to 13                             |
 //* |     39.0 | Non-LLPC-specific XGL code should #include vkcgDefs.h instead of llpc.h                               |
 //* |     38.3 | Added shadowDescriptorTableUsage and shadowDescriptorTablePtrHigh to PipelineOptions                  |
@@ -261,6 +263,10 @@ struct PipelineOptions {
 
   ShadowDescriptorTableUsage shadowDescriptorTableUsage; ///< Controls shadow descriptor table.
   unsigned shadowDescriptorTablePtrHigh;                 ///< Sets high part of VA ptr for shadow descriptor table.
+  bool fastCompile; ///< If set, compile with the fast tier: a reduced optimization pass list, and fast instruction
+                    ///  selection and register allocation. The fast tier has its own cache key, so the client can
+                    ///  rebuild the pipeline with this cleared (e.g. on a background thread) and switch to the fully
+                    ///  optimized result when it is ready.
 };
 
 /// Prototype of allocator for output data buffer, used in shader-specific operations.
@@ -475,6 +481,10 @@ struct PipelineShaderOptions {
 
   /// The threshold for load scalarizer.
   unsigned scalarThreshold;
+
+  /// Decide for each load whether to scalarize it by a cost model of its uses, alignment and register pressure,
+  /// where the load scalarizer is enabled.
+  bool loadScalarizerCostModel;
 };
 
 /// Represents YCbCr sampler meta data in resource descriptor
@@ -87,7 +87,7 @@ const CommonShaderMode &Builder::getCommonShaderMode() {
 //
 // @param tessellationMode : Tessellation mode
 void Builder::setTessellationMode(const TessellationMode &tessellationMode) {
-  getShaderModes()->setTessellationMode(tessellationMode);
+  getShaderModes()->setTessellationMode(m_shaderStage, tessellationMode);
 }
 
 // =====================================================================================================================
@@ -114,6 +114,14 @@ void Builder::setComputeShaderMode(const ComputeShaderMode &computeShaderMode) {
   getShaderModes()->setComputeShaderMode(computeShaderMode);
 }
 
+// =====================================================================================================================
+// Record the shader modes of the current shader stage into IR metadata, even in a pipeline compile.
+//
+// @param [in/out] module : Module to record into
+void Builder::recordCurrentShaderModes(Module *module) {
+  getShaderModes()->record(module, m_shaderStage);
+}
+
 // =====================================================================================================================
 // Get the type pElementTy, turned into a vector of the same vector width as pMaybeVecTy if the latter
 // is a vector type.
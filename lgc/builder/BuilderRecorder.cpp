@@ -1819,39 +1819,47 @@ Value *BuilderRecorder::CreateSubgroupMbcnt(Value *const mask, const Twine &inst
 // @param attribs : Attributes to give the function declaration
 Instruction *BuilderRecorder::record(BuilderRecorder::Opcode opcode, Type *resultTy, ArrayRef<Value *> args,
                                      const Twine &instName, ArrayRef<Attribute::AttrKind> attribs) {
-  // Create mangled name of builder call. This only needs to be mangled on return type.
-  std::string mangledName;
-  {
-    raw_string_ostream mangledNameStream(mangledName);
-    mangledNameStream << BuilderCallPrefix;
-    mangledNameStream << getCallName(opcode);
-    if (resultTy) {
-      mangledNameStream << ".";
-      getTypeName(resultTy, mangledNameStream);
-    } else
-      resultTy = Type::getVoidTy(getContext());
-  }
-
-  // See if the declaration already exists in the module.
   Module *const module = GetInsertBlock()->getModule();
-  Function *func = dyn_cast_or_null<Function>(module->getFunction(mangledName));
-  if (!func) {
-    // Does not exist. Create it as a varargs function.
-    auto funcTy = FunctionType::get(resultTy, {}, true);
-    func = Function::Create(funcTy, GlobalValue::ExternalLinkage, mangledName, module);
-
-    // Add opcode metadata to the function, so that BuilderReplayer does not need to do a string comparison.
-    // We do not add that metadata if doing -emit-lgc, so that a test constructed with -emit-lgc will rely
-    // on the more stable lgc.create.* name rather than the less stable opcode.
-    if (!m_omitOpcodes) {
-      MDNode *const funcMeta = MDNode::get(getContext(), ConstantAsMetadata::get(getInt32(opcode)));
-      func->setMetadata(opcodeMetaKindId, funcMeta);
+  Type *const callResultTy = resultTy ? resultTy : Type::getVoidTy(getContext());
+
+  // Look up the declaration in the cache first. A cached declaration from another module, or one that has been
+  // deleted, is looked up again by name.
+  WeakVH &cachedFunc = m_declarations[std::make_pair(static_cast<unsigned>(opcode), callResultTy)];
+  Function *func = cast_or_null<Function>(cachedFunc);
+  if (!func || func->getParent() != module) {
+    // Create mangled name of builder call. This only needs to be mangled on return type.
+    std::string mangledName;
+    {
+      raw_string_ostream mangledNameStream(mangledName);
+      mangledNameStream << BuilderCallPrefix;
+      mangledNameStream << getCallName(opcode);
+      if (resultTy) {
+        mangledNameStream << ".";
+        getTypeName(resultTy, mangledNameStream);
+      }
     }
 
-    // Add requested attributes, plus nounwind.
-    func->addFnAttr(Attribute::NoUnwind);
-    for (auto attrib : attribs)
-      func->addFnAttr(attrib);
+    // See if the declaration already exists in the module.
+    func = dyn_cast_or_null<Function>(module->getFunction(mangledName));
+    if (!func) {
+      // Does not exist. Create it as a varargs function.
+      auto funcTy = FunctionType::get(callResultTy, {}, true);
+      func = Function::Create(funcTy, GlobalValue::ExternalLinkage, mangledName, module);
+
+      // Add opcode metadata to the function, so that BuilderReplayer does not need to do a string comparison.
+      // We do not add that metadata if doing -emit-lgc, so that a test constructed with -emit-lgc will rely
+      // on the more stable lgc.create.* name rather than the less stable opcode.
+      if (!m_omitOpcodes) {
+        MDNode *const funcMeta = MDNode::get(getContext(), ConstantAsMetadata::get(getInt32(opcode)));
+        func->setMetadata(opcodeMetaKindId, funcMeta);
+      }
+
+      // Add requested attributes, plus nounwind.
+      func->addFnAttr(Attribute::NoUnwind);
+      for (auto attrib : attribs)
+        func->addFnAttr(attrib);
+    }
+    cachedFunc = func;
   }
 
   // Create the call.
@@ -31,9 +31,8 @@
 #pragma once
 
 #include "lgc/Builder.h"
-#ifndef NDEBUG
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/IR/ValueHandle.h"
-#endif
 
 namespace llvm {
 
@@ -558,6 +557,8 @@ private:
   PipelineState *m_pipelineState;             // PipelineState; nullptr for shader compile
   std::unique_ptr<ShaderModes> m_shaderModes; // ShaderModes for a shader compile
   bool m_omitOpcodes;                         // Omit opcodes on lgc.create.* function declarations
+  // lgc.create.* declaration for each opcode and return type, in the module last recorded into for it
+  llvm::DenseMap<std::pair<unsigned, llvm::Type *>, llvm::WeakVH> m_declarations;
 };
 
 // Create BuilderReplayer pass
@@ -32,6 +32,7 @@
 #include "lgc/LgcContext.h"
 #include "lgc/state/PipelineState.h"
 #include "lgc/util/Internal.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Support/Debug.h"
 
 #define DEBUG_TYPE "llpc-builder-replayer"
@@ -62,15 +63,22 @@ private:
   BuilderReplayer(const BuilderReplayer &) = delete;
   BuilderReplayer &operator=(const BuilderReplayer &) = delete;
 
+  // The recorded calls in one shader function, in the order they are replayed
+  struct Partition {
+    Function *func;                                         // Enclosing function
+    SmallVector<std::pair<CallInst *, unsigned>, 16> calls; // Calls with their opcodes
+  };
+
+  void replayPartition(Partition &partition);
+
   void replayCall(unsigned opcode, CallInst *call);
 
   Value *processCall(unsigned opcode, CallInst *call);
 
-  std::unique_ptr<Builder> m_builder;                 // The LLPC builder that the builder
-                                                      //  calls are being replayed on.
-  std::map<Function *, ShaderStage> m_shaderStageMap; // Map function -> shader stage
-  llvm::Function *m_enclosingFunc = nullptr;          // Last function written with current
-                                                      //  shader stage
+  std::unique_ptr<Builder> m_builder;                // The LLPC builder that the builder
+                                                     //  calls are being replayed on.
+  DenseMap<Function *, unsigned> m_partitionIndices; // Map function -> index into m_partitions
+  SmallVector<Partition, 8> m_partitions;            // Recorded calls, partitioned by enclosing function
 };
 
 } // namespace
@@ -133,44 +141,51 @@ bool BuilderReplayer::runOnModule(Module &module) {
       opcode = BuilderRecorder::getOpcodeFromName(func.getName());
     }
 
-    // Replay all call uses of the function declaration.
-    while (!func.use_empty()) {
-      CallInst *call = cast<CallInst>(func.use_begin()->getUser());
-      replayCall(opcode, call);
+    // Add all call uses of the function declaration to the partition of their enclosing function. Within a
+    // partition, the calls stay in declaration order, which some replays rely on (for example, descriptor loads are
+    // replayed before the image sample that looks at them to find a converting sampler).
+    for (User *user : func.users()) {
+      CallInst *call = cast<CallInst>(user);
+      Function *enclosingFunc = call->getFunction();
+      auto it = m_partitionIndices.insert({enclosingFunc, m_partitions.size()});
+      if (it.second)
+        m_partitions.push_back({enclosingFunc, {}});
+      m_partitions[it.first->second].calls.push_back({call, opcode});
     }
-
-    func.clearMetadata();
-    assert(func.user_empty());
     funcsToRemove.push_back(&func);
   }
 
-  for (Function *const func : funcsToRemove)
+  // Replay the calls of each shader function, setting its shader stage on the Builder once.
+  for (Partition &partition : m_partitions)
+    replayPartition(partition);
+  m_partitions.clear();
+  m_partitionIndices.clear();
+
+  for (Function *const func : funcsToRemove) {
+    func->clearMetadata();
+    assert(func->user_empty());
     func->eraseFromParent();
+  }
 
   return true;
 }
 
+// =====================================================================================================================
+// Replay the recorded builder calls in one function.
+//
+// @param partition : The function and the calls in it
+void BuilderReplayer::replayPartition(Partition &partition) {
+  m_builder->setShaderStage(getShaderStage(partition.func));
+  for (const auto &callAndOpcode : partition.calls)
+    replayCall(callAndOpcode.second, callAndOpcode.first);
+}
+
 // =====================================================================================================================
 // Replay a recorded builder call.
 //
 // @param opcode : The builder call opcode
 // @param call : The builder call to process
 void BuilderReplayer::replayCall(unsigned opcode, CallInst *call) {
-  // Change shader stage if necessary.
-  Function *enclosingFunc = call->getParent()->getParent();
-  if (enclosingFunc != m_enclosingFunc) {
-    m_enclosingFunc = enclosingFunc;
-
-    auto mapIt = m_shaderStageMap.find(enclosingFunc);
-    ShaderStage stage = ShaderStageInvalid;
-    if (mapIt == m_shaderStageMap.end()) {
-      stage = getShaderStage(enclosingFunc);
-      m_shaderStageMap[enclosingFunc] = stage;
-    } else
-      stage = mapIt->second;
-    m_builder->setShaderStage(stage);
-  }
-
   // Set the insert point on the Builder. Also sets debug location to that of pCall.
   m_builder->SetInsertPoint(call);
 
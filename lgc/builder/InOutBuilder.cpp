@@ -304,23 +304,28 @@ void InOutBuilder::markGenericInputOutputUsage(bool isOutput, unsigned location,
     }
   }
 
+  // When building relocatable ELF, the fragment shader is compiled separately from the pre-rasterization stages. Keep
+  // all locations up to this one in the outputs of the last pre-rasterization stage and in the inputs of the fragment
+  // shader, so that both get an identity location mapping.
+  bool keepAllLocations = false;
+  if (getLgcContext()->buildingRelocatableElf()) {
+    if (isOutput && m_shaderStage != ShaderStageFragment &&
+        getPipelineState()->getNextShaderStage(m_shaderStage) == ShaderStageInvalid)
+      keepAllLocations = true;
+    if (m_shaderStage == ShaderStageFragment && !isOutput)
+      keepAllLocations = true;
+  }
+  unsigned startLocation = (keepAllLocations ? 0 : location);
+
   if (!isOutput || m_shaderStage != ShaderStageGeometry) {
-    bool keepAllLocations = false;
-    if (getLgcContext()->buildingRelocatableElf()) {
-      if (m_shaderStage == ShaderStageVertex && isOutput)
-        keepAllLocations = true;
-      if (m_shaderStage == ShaderStageFragment && !isOutput)
-        keepAllLocations = true;
-    }
-    unsigned startLocation = (keepAllLocations ? 0 : location);
     // Non-GS-output case.
     for (unsigned i = startLocation; i < location + locationCount; ++i)
       (*inOutLocMap)[i] = InvalidValue;
   } else {
     // GS output. We include the stream ID with the location in the map key.
-    for (unsigned i = 0; i < locationCount; ++i) {
+    for (unsigned i = startLocation; i < location + locationCount; ++i) {
       GsOutLocInfo outLocInfo = {};
-      outLocInfo.location = location + i;
+      outLocInfo.location = i;
       outLocInfo.streamId = inOutInfo.getStreamId();
       (*inOutLocMap)[outLocInfo.u32All] = InvalidValue;
     }
@@ -31,6 +31,7 @@
 #pragma once
 
 #include "lgc/Pipeline.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/Pass.h"
 
 namespace llvm {
@@ -53,12 +54,15 @@ void initializePatchInOutImportExportPass(PassRegistry &);
 void initializePatchIntrinsicSimplifyPass(PassRegistry &);
 void initializePatchLlvmIrInclusionPass(PassRegistry &);
 void initializePatchLoadScalarizerPass(PassRegistry &);
+void initializePatchNewPmOptimizerPass(PassRegistry &);
 void initializePatchNullFragShaderPass(PassRegistry &);
 void initializePatchPeepholeOptPass(PassRegistry &);
 void initializePatchPreparePipelineAbiPass(PassRegistry &);
 void initializePatchPushConstOpPass(PassRegistry &);
 void initializePatchResourceCollectPass(PassRegistry &);
 void initializePatchSetupTargetFeaturesPass(PassRegistry &);
+void initializePatchShaderStatsPass(PassRegistry &);
+void initializePatchUniformWaterfallPass(PassRegistry &);
 
 } // namespace llvm
 
@@ -79,12 +83,15 @@ inline static void initializePatchPasses(llvm::PassRegistry &passRegistry) {
   initializePatchIntrinsicSimplifyPass(passRegistry);
   initializePatchLlvmIrInclusionPass(passRegistry);
   initializePatchLoadScalarizerPass(passRegistry);
+  initializePatchNewPmOptimizerPass(passRegistry);
   initializePatchNullFragShaderPass(passRegistry);
   initializePatchPeepholeOptPass(passRegistry);
   initializePatchPreparePipelineAbiPass(passRegistry);
   initializePatchPushConstOpPass(passRegistry);
   initializePatchResourceCollectPass(passRegistry);
   initializePatchSetupTargetFeaturesPass(passRegistry);
+  initializePatchShaderStatsPass(passRegistry);
+  initializePatchUniformWaterfallPass(passRegistry);
 }
 
 llvm::FunctionPass *createPatchBufferOp();
@@ -96,15 +103,69 @@ llvm::ModulePass *createPatchInOutImportExport();
 llvm::FunctionPass *createPatchIntrinsicSimplify();
 llvm::ModulePass *createPatchLlvmIrInclusion();
 llvm::FunctionPass *createPatchLoadScalarizer();
+llvm::ModulePass *createPatchNewPmOptimizer();
 llvm::ModulePass *createPatchNullFragShader();
 llvm::FunctionPass *createPatchPeepholeOpt(bool enableDiscardOpt = false);
 llvm::ModulePass *createPatchPreparePipelineAbi(bool onlySetCallingConvs);
 llvm::ModulePass *createPatchPushConstOp();
 llvm::ModulePass *createPatchResourceCollect();
 llvm::ModulePass *createPatchSetupTargetFeatures();
+llvm::ModulePass *createPatchShaderStats();
+llvm::ModulePass *createPatchUniformWaterfall();
 
 class PipelineState;
 
+// Optimization passes in the curated optimization list. Patch::addOptimizationPasses adds the list to the legacy
+// pass manager, and PatchNewPmOptimizer to the new pass manager.
+enum class OptimizationPass : unsigned {
+  // Module passes
+  ForceFunctionAttrs,
+  IpSccp,
+  CalledValuePropagation,
+  GlobalOpt,
+  StripDeadPrototypes,
+  GlobalDce,
+  ConstantMerge,
+  // Function passes
+  PromoteMemoryToRegister,
+  InstCombine, // Parameter: maximum number of iterations
+  PeepholeOpt, // Parameter: whether to enable the optimization for "kill" intrinsic
+  InstSimplify,
+  CfgSimplify,
+  CfgSimplifyLate, // CFG simplification with switch-to-lookup-table, common code sinking and bonus threshold 1
+  Sroa,
+  EarlyCse,
+  SpeculativeExecution,
+  CorrelatedValuePropagation,
+  AggressiveInstCombine,
+  Reassociate,
+  Scalarizer,
+  LoadScalarizer,
+  IntrinsicSimplify,
+  MergedLoadStoreMotion,
+  Gvn,
+  Sccp,
+  BitTrackingDce,
+  AggressiveDce,
+  Float2Int,
+  LoopUnroll, // Parameter: optimization level
+  LoopSink,
+  DivRemPairs,
+  // Loop passes
+  LoopRotate,
+  Licm,
+  IndVarSimplify,
+  LoopIdiom,
+  LoopDeletion,
+  SimpleLoopUnroll, // Parameter: optimization level
+};
+
+// An entry in the curated optimization list
+struct OptimizationPassEntry {
+  OptimizationPass pass;
+  unsigned param;
+};
+
 // =====================================================================================================================
 // Represents the pass of LLVM patching operations, as the base class.
 class Patch : public llvm::ModulePass {
@@ -120,6 +181,8 @@ public:
 
   static llvm::GlobalVariable *getLdsVariable(PipelineState *pipelineState, llvm::Module *module);
 
+  static llvm::ArrayRef<OptimizationPassEntry> getOptimizationPasses();
+
 protected:
   void init(llvm::Module *module);
 
@@ -132,6 +195,7 @@ protected:
 
 private:
   static void addOptimizationPasses(llvm::legacy::PassManager &passMgr);
+  static void addFastOptimizationPasses(llvm::legacy::PassManager &passMgr);
 
   Patch() = delete;
   Patch(const Patch &) = delete;
@@ -36,6 +36,7 @@
 #include "lgc/state/ResourceUsage.h"
 #include "lgc/state/ShaderModes.h"
 #include "lgc/state/ShaderStage.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/Pass.h"
@@ -57,6 +58,8 @@ void initializePipelineStateWrapperPass(PassRegistry &);
 
 namespace lgc {
 
+class StateBlobReader;
+class StateBlobWriter;
 class TargetInfo;
 
 llvm::ModulePass *createPipelineStateClearer();
@@ -157,7 +160,8 @@ public:
 
   // Generate pipeline module
   void generate(std::unique_ptr<llvm::Module> pipelineModule, llvm::raw_pwrite_stream &outStream,
-                CheckShaderCacheFunc checkShaderCacheFunc, llvm::ArrayRef<llvm::Timer *> timers) override final;
+                CheckShaderCacheFunc checkShaderCacheFunc, llvm::ArrayRef<llvm::Timer *> timers,
+                llvm::raw_pwrite_stream *fragmentOutStream = nullptr) override final;
 
   // Compute the ExportFormat (as an opaque int) of the specified color export location with the specified output
   // type. Only the number of elements of the type is significant.
@@ -176,7 +180,7 @@ public:
   // Clear the pipeline state IR metadata.
   void clear(llvm::Module *module);
 
-  // Record pipeline state into IR metadata of specified module.
+  // Record pipeline state into IR metadata of specified module, as a binary blob unless -emit-lgc is on.
   void record(llvm::Module *module);
 
   // Accessors for shader stage mask
@@ -334,9 +338,25 @@ public:
   }
 
 private:
+  // Split the fragment shader out of the patched pipeline module, for parallel code generation
+  static std::unique_ptr<llvm::Module> splitFragmentModule(llvm::Module &pipelineModule);
+
+  // Run code generation on the fragment shader module split out of the pipeline module
+  static bool generateFragmentModule(llvm::StringRef bitcode, llvm::StringRef gpuName, unsigned palAbiVersion,
+                                     bool fastCompile, unsigned *passIndex, llvm::raw_pwrite_stream &outStream,
+                                     std::string &errorMessage);
+
   // Read shaderStageMask from IR
   void readShaderStageMask(llvm::Module *module);
 
+  // Recording state other than shader modes, as named metadata or as a binary blob
+  void recordMetadata(llvm::Module *module);
+  void recordBlob(llvm::Module *module);
+  void recordUserDataTableToBlob(llvm::ArrayRef<ResourceNode> nodes, StateBlobWriter &writer);
+  bool readBlob(llvm::Module *module);
+  void readUserDataTableFromBlob(llvm::MutableArrayRef<ResourceNode> destTable, ResourceNode *&destInnerTable,
+                                 StateBlobReader &reader);
+
   // Options handling
   void recordOptions(llvm::Module *module);
   void readOptions(llvm::Module *module);
@@ -347,6 +367,8 @@ private:
   void recordUserDataNodes(llvm::Module *module);
   void recordUserDataTable(llvm::ArrayRef<ResourceNode> nodes, llvm::NamedMDNode *userDataMetaNode);
   void readUserDataNodes(llvm::Module *module);
+  void buildResourceNodeIndex() const;
+  void invalidateResourceNodeIndex();
   llvm::ArrayRef<llvm::MDString *> getResourceTypeNames();
   llvm::MDString *getResourceTypeName(ResourceNodeType type);
   ResourceNodeType getResourceTypeFromName(llvm::MDString *typeName);
@@ -376,8 +398,13 @@ private:
   std::unique_ptr<ResourceNode[]> m_allocUserDataNodes; // Allocated buffer for user data
   llvm::ArrayRef<ResourceNode> m_userDataNodes;         // Top-level user data node table
   bool m_haveConvertingSampler = false;                 // Whether we have a converting sampler
-  llvm::MDString *m_resourceNodeTypeNames[unsigned(ResourceNodeType::Count)] = {};
   // Cached MDString for each resource node type
+  llvm::MDString *m_resourceNodeTypeNames[unsigned(ResourceNodeType::Count)] = {};
+  // Index of user data nodes by {set,binding}, each entry being {topNode, node} in user data node order. Built on
+  // first use by findResourceNode.
+  mutable llvm::DenseMap<uint64_t, llvm::SmallVector<std::pair<const ResourceNode *, const ResourceNode *>, 1>>
+      m_resourceNodeIndex;
+  mutable bool m_resourceNodeIndexValid = false; // Whether m_resourceNodeIndex is up to date
 
   bool m_gsOnChip = false;                                                     // Whether to use GS on-chip mode
   NggControl m_nggControl = {};                                                // NGG control settings
@@ -51,7 +51,7 @@ public:
 
   // Set the tessellation mode. This in fact merges the supplied values with any previously supplied values,
   // to allow the client to call this twice, once for TCS and once for TES.
-  void setTessellationMode(const TessellationMode &inMode);
+  void setTessellationMode(ShaderStage stage, const TessellationMode &inMode);
 
   // Get the tessellation state.
   const TessellationMode &getTessellationMode();
@@ -80,18 +80,22 @@ public:
   // Record modes to IR metadata
   void record(llvm::Module *module);
 
+  // Record the modes that apply to a single shader stage to IR metadata
+  void record(llvm::Module *module, ShaderStage stage);
+
   // Read shader modes (common and specific) from a shader IR module, but only if no modes have been set
-  // in this ShaderModes. This is used to handle the case that the shader module comes from an earlier
-  // shader compile, and it had its ShaderModes recorded into IR then.
+  // for that shader stage in this ShaderModes. This is used to handle the case that the shader module comes
+  // from an earlier shader compile, or from a front-end cache, and it had its ShaderModes recorded into IR then.
   void readModesFromShader(llvm::Module *module, ShaderStage stage);
 
   // Read shader modes from IR metadata in a pipeline
   void readModesFromPipeline(llvm::Module *module);
 
 private:
-  bool m_anySet = false;                                             // Whether any Set*Mode method called
+  unsigned m_setStageMask = 0;                                       // Mask of stages with common mode set
   CommonShaderMode m_commonShaderModes[ShaderStageCompute + 1] = {}; // Per-shader FP modes
-  TessellationMode m_tessellationMode = {};                          // Tessellation mode
+  TessellationMode m_tessellationMode = {};                          // Tessellation mode (merged TCS and TES)
+  TessellationMode m_stageTessellationModes[2] = {};                 // Tessellation mode as supplied by TCS and TES
   GeometryShaderMode m_geometryShaderMode = {};                      // Geometry shader mode
   FragmentShaderMode m_fragmentShaderMode = {};                      // Fragment shader mode
   ComputeShaderMode m_computeShaderMode = {};                        // Compute shader mode (workgroup size)
@@ -0,0 +1,100 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2017-2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  IntrinsicRegistry.h
+ * @brief LLPC header file: contains declaration of class lgc::IntrinsicRegistry.
+ ***********************************************************************************************************************
+ */
+#pragma once
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/ValueMap.h"
+
+namespace llvm {
+class Function;
+class Module;
+} // namespace llvm
+
+namespace lgc {
+
+// IDs of the lgc.* internal calls that the patch passes dispatch on. Where one name is a prefix of another (such as
+// lgc.buffer.load. and lgc.buffer.load.uniform.), each gets its own ID.
+enum class LgcIntrinsic : unsigned {
+  None = 0, // Not an lgc.* internal call that the patch passes dispatch on
+  InputImportGeneric,
+  InputImportBuiltIn,
+  InputImportInterpolant,
+  OutputImportGeneric,
+  OutputImportBuiltIn,
+  OutputExportGeneric,
+  OutputExportBuiltIn,
+  OutputExportXfb,
+  BufferLoad,
+  BufferLoadUniform,
+  BufferLoadScalarAligned,
+  PushConstLoad,
+  DescriptorIndex,
+  DescriptorLoadFromPtr,
+  DescriptorLoadBuffer,
+  DescriptorLoadSpillTable,
+  DescriptorGetResourcePtr,
+  DescriptorGetSamplerPtr,
+  DescriptorGetFmaskPtr,
+  DescriptorGetTexelBufferPtr,
+  Count
+};
+
+// =====================================================================================================================
+// Registry that maps the declarations of lgc.* internal calls in a module to LgcIntrinsic IDs, so that passes
+// classify a call with a map lookup and a switch, rather than by comparing name prefixes at every call.
+//
+// The declarations in the module are classified once, by init(). A declaration added later, for example by a pass
+// that emits new internal calls, is classified by name on first lookup. The map entry of a function goes away when
+// the function is deleted.
+class IntrinsicRegistry {
+public:
+  void init(llvm::Module &module);
+
+  LgcIntrinsic get(const llvm::Function *func);
+
+  // Get the declarations of the given ID, as found in the module by init(). The caller must not use this after
+  // erasing any of them.
+  llvm::ArrayRef<llvm::Function *> getDeclarations(LgcIntrinsic id) const {
+    return m_declarations[static_cast<unsigned>(id)];
+  }
+
+  static LgcIntrinsic classify(llvm::StringRef name);
+
+private:
+  // ID of each function looked up so far
+  llvm::ValueMap<const llvm::Function *, LgcIntrinsic> m_ids;
+  // Declarations found by init(), per ID
+  llvm::SmallVector<llvm::Function *, 4> m_declarations[static_cast<unsigned>(LgcIntrinsic::Count)];
+};
+
+} // namespace lgc
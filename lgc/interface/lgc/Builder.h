@@ -183,6 +183,10 @@ public:
   // Record shader modes into IR metadata if this is a shader compile (no PipelineState).
   virtual void recordShaderModes(llvm::Module *module) {}
 
+  // Record the shader modes of the current shader stage into IR metadata, even in a pipeline compile. This allows
+  // the front-end to cache the shader module and later link it into a different pipeline.
+  void recordCurrentShaderModes(llvm::Module *module);
+
   // -----------------------------------------------------------------------------------------------------------------
   // Base class operations
 
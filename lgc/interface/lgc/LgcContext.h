@@ -37,6 +37,7 @@ namespace llvm {
 class LLVMContext;
 class ModulePass;
 class raw_pwrite_stream;
+class TargetLibraryInfoImpl;
 class TargetMachine;
 class Timer;
 
@@ -103,8 +104,15 @@ public:
   // @param [in/out] passMgr : Pass manager
   void preparePassManager(llvm::legacy::PassManager *passMgr);
 
+  // Get the target library info that preparePassManager adds, for use with the new pass manager.
+  llvm::TargetLibraryInfoImpl getTargetLibraryInfo();
+
   // Adds target passes to pass manager, depending on "-filetype" and "-emit-llvm" options
-  void addTargetPasses(lgc::PassManager &passMgr, llvm::Timer *codeGenTimer, llvm::raw_pwrite_stream &outStream);
+  void addTargetPasses(lgc::PassManager &passMgr, llvm::Timer *codeGenTimer, llvm::raw_pwrite_stream &outStream,
+                       bool fastCompile = false);
+
+  // Returns true if the target passes emit an ELF object, rather than IR or assembly text.
+  static bool isEmittingElf();
 
   void setBuildRelocatableElf(bool buildRelocatableElf) { m_buildRelocatableElf = buildRelocatableElf; }
   bool buildingRelocatableElf() { return m_buildRelocatableElf; }
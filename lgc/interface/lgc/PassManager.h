@@ -30,10 +30,20 @@
  */
 #pragma once
 
+#include "llvm/ADT/StringRef.h"
 #include "llvm/IR/LegacyPassManager.h"
+#include <memory>
+
+namespace llvm {
+
+class raw_ostream;
+
+} // namespace llvm
 
 namespace lgc {
 
+class PassStatsTable;
+
 // =====================================================================================================================
 // Public interface of LLPC middle-end's legacy::PassManager override
 class PassManager : public llvm::legacy::PassManager {
@@ -42,6 +52,30 @@ public:
   virtual ~PassManager() {}
   virtual void stop() = 0;
   virtual void setPassIndex(unsigned *passIndex) = 0;
+
+  // Passes added between beginPassGroup and endPassGroup are measured (for the per-pass statistics and the trace)
+  // as one unit with the given name, rather than one by one.
+  virtual void beginPassGroup(llvm::StringRef name) = 0;
+  virtual void endPassGroup() = 0;
+
+  // Per-pass statistics: wall-clock time, and instruction and basic block counts before and after each pass. When
+  // enabled, every pass added to a PassManager created afterwards is measured, and the results are aggregated per
+  // pipeline (see finishPipelinePassStats) and across the run. Likewise, when tracing is enabled (see lgc/Trace.h),
+  // every pass is recorded as a trace event.
+  static void enablePassStats();
+  static bool isPassStatsEnabled();
+
+  // Finish the per-pass statistics of the pipeline compiled on this thread, recording them under the given name.
+  static void finishPipelinePassStats(llvm::StringRef pipelineName);
+
+  // Write the per-pass statistics gathered so far as JSON.
+  static void writePassStats(llvm::raw_ostream &outStream);
+
+  // Take the per-pass statistics gathered on this thread that are not yet finished. A helper thread of a pipeline
+  // compile uses this to hand its statistics to the thread that compiles the pipeline, which adds them to its own
+  // with mergeThreadPassStats.
+  static std::shared_ptr<PassStatsTable> takeThreadPassStats();
+  static void mergeThreadPassStats(const std::shared_ptr<PassStatsTable> &passStats);
 };
 
 } // namespace lgc
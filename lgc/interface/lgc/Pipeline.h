@@ -118,6 +118,10 @@ struct Options {
   unsigned nggPrimsPerSubgroup;        // How to determine NGG prims per subgroup
   ShadowDescriptorTableUsage shadowDescriptorTableUsage; // Shadow descriptor table setting
   unsigned shadowDescriptorTablePtrHigh;                 // High part of VA ptr.
+  unsigned fastCompile;                                  // If set, use the fast compile tier: reduced optimizations,
+                                                         //  fast instruction selection and register allocation
+  unsigned includeShaderStats;                           // If set, static statistics of each shader will be included
+                                                         //  in the pipeline ELF.
 };
 
 // Middle-end per-shader options to pass to SetShaderOptions.
@@ -165,6 +169,10 @@ struct ShaderOptions {
 
   /// Default unroll threshold for LLVM.
   unsigned unrollThreshold;
+
+  // Whether the load scalarizer decides for each load whether to scalarize it, by a cost model, rather than by
+  // loadScalarizerThreshold alone. Only has an effect when loadScalarizerThreshold is not 0.
+  bool loadScalarizerCostModel;
 };
 
 // =====================================================================================================================
@@ -568,7 +576,9 @@ public:
 
   // Typedef of function passed in to Generate to check the shader cache.
   // Returns the updated shader stage mask, allowing the client to decide not to compile shader stages
-  // that got a hit in the cache.
+  // that got a hit in the cache. The per-stage hash covers the in/out usage of the stage, and also the vertex input
+  // descriptions of the inputs read by the vertex shader and the color export formats of the outputs written by the
+  // fragment shader; the client need not hash that state itself.
   typedef std::function<unsigned(const llvm::Module *module,                         // [in] Module
                                  unsigned stageMask,                                 // Shader stage mask
                                  llvm::ArrayRef<llvm::ArrayRef<uint8_t>> stageHashes // Per-stage hash of in/out usage
@@ -581,12 +591,20 @@ public:
   // Like other Builder methods, on error, this calls report_fatal_error, which you can catch by setting
   // a diagnostic handler with LLVMContext::setDiagnosticHandler.
   //
+  // If fragmentOutStream is not nullptr, a graphics pipeline with a fragment shader and other shader stages is
+  // split after patching, and code for the fragment shader is generated on another thread, concurrently with the
+  // other hardware stages. The fragment shader ELF is then written to fragmentOutStream, and the front-end merges
+  // it into the ELF written to outStream. Nothing is written to fragmentOutStream if the pipeline is not split.
+  //
   // @param pipelineModule : IR pipeline module
   // @param [in/out] outStream : Stream to write ELF or IR disassembly output
   // @param checkShaderCacheFunc : Function to check shader cache in graphics pipeline
   // @param timers : Timers for: patch passes, llvm optimizations, codegen
+  // @param [in/out] fragmentOutStream : Stream to write fragment shader ELF to in parallel code generation mode, or
+  //                                     nullptr
   virtual void generate(std::unique_ptr<llvm::Module> pipelineModule, llvm::raw_pwrite_stream &outStream,
-                        CheckShaderCacheFunc checkShaderCacheFunc, llvm::ArrayRef<llvm::Timer *> timers) = 0;
+                        CheckShaderCacheFunc checkShaderCacheFunc, llvm::ArrayRef<llvm::Timer *> timers,
+                        llvm::raw_pwrite_stream *fragmentOutStream = nullptr) = 0;
 
   // -----------------------------------------------------------------------------------------------------------------
   // Non-compiling methods
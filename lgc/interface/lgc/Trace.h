@@ -0,0 +1,102 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2018-2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  Trace.h
+ * @brief LLPC header file: contains declaration of classes lgc::Trace and lgc::TraceScope.
+ ***********************************************************************************************************************
+ */
+#pragma once
+
+#include "llvm/ADT/StringRef.h"
+#include <atomic>
+#include <stdint.h>
+
+namespace llvm {
+
+class raw_ostream;
+
+} // namespace llvm
+
+namespace lgc {
+
+// =====================================================================================================================
+// Recorder of timed events, written out in the Chrome trace-event JSON format (viewable in chrome://tracing or
+// Perfetto). Tracing is enabled once at startup; until then, the only cost of a trace point is a test of a flag.
+// Each thread records into a buffer of its own, so recording only takes that thread's own lock, which is
+// contended only while the trace is being written.
+class Trace {
+public:
+  // Enable tracing. This must be called before any compile starts.
+  static void enable();
+
+  // Check whether tracing is enabled.
+  static bool isEnabled() { return s_enabled.load(std::memory_order_acquire); }
+
+  // Get the current time in microseconds since tracing was enabled.
+  static uint64_t getTime();
+
+  // Record a complete event on the current thread.
+  static void addEvent(llvm::StringRef name, llvm::StringRef category, uint64_t startTime, uint64_t endTime);
+
+  // Write all recorded events as trace-event JSON. Events recorded concurrently may or may not be included.
+  static void write(llvm::raw_ostream &outStream);
+
+private:
+  static std::atomic<bool> s_enabled; // Whether tracing is enabled
+};
+
+// =====================================================================================================================
+// Scoped trace event: records an event from construction to destruction, or to an earlier call of end().
+class TraceScope {
+public:
+  TraceScope(const char *name, const char *category = "llpc") {
+    if (Trace::isEnabled()) {
+      m_name = name;
+      m_category = category;
+      m_startTime = Trace::getTime();
+    }
+  }
+
+  ~TraceScope() { end(); }
+
+  // End the event now rather than at the end of the scope.
+  void end() {
+    if (m_name) {
+      Trace::addEvent(m_name, m_category, m_startTime, Trace::getTime());
+      m_name = nullptr;
+    }
+  }
+
+private:
+  TraceScope(const TraceScope &) = delete;
+  TraceScope &operator=(const TraceScope &) = delete;
+
+  const char *m_name = nullptr;     // Event name, nullptr if not recording
+  const char *m_category = nullptr; // Event category
+  uint64_t m_startTime = 0;         // Start time of the event
+};
+
+} // namespace lgc
@@ -76,6 +76,10 @@ opt<bool> DisablePatchOpt("disable-patch-opt", desc("Disable optimization for LL
 opt<bool> UseLlvmOpt("use-llvm-opt",
                      desc("Use LLVM's standard optimization set instead of the curated optimization set"), init(false));
 
+// -new-pm-patch-opt: Run the curated optimization set with the new pass manager
+opt<bool> NewPmPatchOpt("new-pm-patch-opt", desc("Run the curated optimization set with the new pass manager"),
+                        init(false));
+
 } // namespace cl
 
 } // namespace llvm
@@ -157,8 +161,12 @@ void Patch::addPasses(PipelineState *pipelineState, legacy::PassManager &passMgr
   // Need to run a first promote mem 2 reg to remove alloca's whose only args are lifetimes
   passMgr.add(createPromoteMemoryToRegisterPass());
 
-  if (!cl::DisablePatchOpt)
-    addOptimizationPasses(passMgr);
+  if (!cl::DisablePatchOpt) {
+    if (pipelineState->getOptions().fastCompile)
+      addFastOptimizationPasses(passMgr);
+    else
+      addOptimizationPasses(passMgr);
+  }
 
   // Stop timer for optimization passes and restart timer for patching passes.
   if (patchTimer) {
@@ -166,6 +174,10 @@ void Patch::addPasses(PipelineState *pipelineState, legacy::PassManager &passMgr
     passMgr.add(LgcContext::createStartStopTimer(patchTimer, true));
   }
 
+  // Remove waterfall loops whose index is uniform (must be after optimizations, for the divergence analysis to be
+  // as precise as possible)
+  passMgr.add(createPatchUniformWaterfall());
+
   // Patch buffer operations (must be after optimizations)
   passMgr.add(createPatchBufferOp());
   passMgr.add(createInstructionCombiningPass(2));
@@ -206,6 +218,10 @@ void Patch::addPasses(PipelineState *pipelineState, legacy::PassManager &passMgr
   if (pipelineState->getOptions().includeIr)
     passMgr.add(createPatchLlvmIrInclusion());
 
+  // Include static shader statistics as a separate section in the ELF binary
+  if (pipelineState->getOptions().includeShaderStats)
+    passMgr.add(createPatchShaderStats());
+
   // Stop timer for patching passes.
   if (patchTimer)
     passMgr.add(LgcContext::createStartStopTimer(patchTimer, false));
@@ -218,74 +234,171 @@ void Patch::addPasses(PipelineState *pipelineState, legacy::PassManager &passMgr
   }
 }
 
+// =====================================================================================================================
+// The curated optimization list, run by the legacy pass manager in addOptimizationPasses, or by the new pass manager
+// in PatchNewPmOptimizer.
+ArrayRef<OptimizationPassEntry> Patch::getOptimizationPasses() {
+  static const unsigned OptLevel = 3;
+  static const OptimizationPassEntry OptimizationPasses[] = {
+      {OptimizationPass::ForceFunctionAttrs, 0},
+      {OptimizationPass::IpSccp, 0},
+      {OptimizationPass::CalledValuePropagation, 0},
+      {OptimizationPass::GlobalOpt, 0},
+      {OptimizationPass::PromoteMemoryToRegister, 0},
+      {OptimizationPass::InstCombine, 5},
+      {OptimizationPass::PeepholeOpt, false},
+      {OptimizationPass::InstSimplify, 0},
+      {OptimizationPass::CfgSimplify, 0},
+      {OptimizationPass::Sroa, 0},
+      {OptimizationPass::EarlyCse, 0},
+      {OptimizationPass::SpeculativeExecution, 0},
+      {OptimizationPass::CorrelatedValuePropagation, 0},
+      {OptimizationPass::CfgSimplify, 0},
+      {OptimizationPass::AggressiveInstCombine, 0},
+      {OptimizationPass::InstCombine, 3},
+      {OptimizationPass::PeepholeOpt, false},
+      {OptimizationPass::InstSimplify, 0},
+      {OptimizationPass::CfgSimplify, 0},
+      {OptimizationPass::Reassociate, 0},
+      {OptimizationPass::LoopRotate, 0},
+      {OptimizationPass::Licm, 0},
+      {OptimizationPass::CfgSimplify, 0},
+      {OptimizationPass::InstCombine, 2},
+      {OptimizationPass::IndVarSimplify, 0},
+      {OptimizationPass::LoopIdiom, 0},
+      {OptimizationPass::LoopDeletion, 0},
+      {OptimizationPass::SimpleLoopUnroll, OptLevel},
+      {OptimizationPass::PeepholeOpt, false},
+      {OptimizationPass::Scalarizer, 0},
+      {OptimizationPass::LoadScalarizer, 0},
+      {OptimizationPass::InstSimplify, 0},
+      {OptimizationPass::IntrinsicSimplify, 0},
+      {OptimizationPass::MergedLoadStoreMotion, 0},
+      {OptimizationPass::Gvn, 0},
+      {OptimizationPass::Sccp, 0},
+      {OptimizationPass::BitTrackingDce, 0},
+      {OptimizationPass::InstCombine, 2},
+      {OptimizationPass::PeepholeOpt, false},
+      {OptimizationPass::CorrelatedValuePropagation, 0},
+      {OptimizationPass::AggressiveDce, 0},
+      {OptimizationPass::CfgSimplify, 0},
+      {OptimizationPass::InstSimplify, 0},
+      {OptimizationPass::Float2Int, 0},
+      {OptimizationPass::LoopRotate, 0},
+      {OptimizationPass::CfgSimplifyLate, 0},
+      {OptimizationPass::PeepholeOpt, true},
+      {OptimizationPass::InstSimplify, 0},
+      {OptimizationPass::LoopUnroll, OptLevel},
+      {OptimizationPass::InstCombine, 2},
+      {OptimizationPass::Licm, 0},
+      {OptimizationPass::StripDeadPrototypes, 0},
+      {OptimizationPass::GlobalDce, 0},
+      {OptimizationPass::ConstantMerge, 0},
+      {OptimizationPass::LoopSink, 0},
+      {OptimizationPass::InstSimplify, 0},
+      {OptimizationPass::DivRemPairs, 0},
+      {OptimizationPass::CfgSimplify, 0},
+  };
+  return OptimizationPasses;
+}
+
+// =====================================================================================================================
+// Create the legacy pass for an entry in the curated optimization list
+//
+// @param entry : Entry in the curated optimization list
+static Pass *createOptimizationPass(const OptimizationPassEntry &entry) {
+  switch (entry.pass) {
+  case OptimizationPass::ForceFunctionAttrs:
+    return createForceFunctionAttrsLegacyPass();
+  case OptimizationPass::IpSccp:
+    return createIPSCCPPass();
+  case OptimizationPass::CalledValuePropagation:
+    return createCalledValuePropagationPass();
+  case OptimizationPass::GlobalOpt:
+    return createGlobalOptimizerPass();
+  case OptimizationPass::StripDeadPrototypes:
+    return createStripDeadPrototypesPass();
+  case OptimizationPass::GlobalDce:
+    return createGlobalDCEPass();
+  case OptimizationPass::ConstantMerge:
+    return createConstantMergePass();
+  case OptimizationPass::PromoteMemoryToRegister:
+    return createPromoteMemoryToRegisterPass();
+  case OptimizationPass::InstCombine:
+    return createInstructionCombiningPass(entry.param);
+  case OptimizationPass::PeepholeOpt:
+    return createPatchPeepholeOpt(entry.param);
+  case OptimizationPass::InstSimplify:
+    return createInstSimplifyLegacyPass();
+  case OptimizationPass::CfgSimplify:
+    return createCFGSimplificationPass();
+  case OptimizationPass::CfgSimplifyLate:
+    return createCFGSimplificationPass(1, true, true, true, true);
+  case OptimizationPass::Sroa:
+    return createSROAPass();
+  case OptimizationPass::EarlyCse:
+    return createEarlyCSEPass(true);
+  case OptimizationPass::SpeculativeExecution:
+    return createSpeculativeExecutionIfHasBranchDivergencePass();
+  case OptimizationPass::CorrelatedValuePropagation:
+    return createCorrelatedValuePropagationPass();
+  case OptimizationPass::AggressiveInstCombine:
+    return createAggressiveInstCombinerPass();
+  case OptimizationPass::Reassociate:
+    return createReassociatePass();
+  case OptimizationPass::Scalarizer:
+    return createScalarizerPass();
+  case OptimizationPass::LoadScalarizer:
+    return createPatchLoadScalarizer();
+  case OptimizationPass::IntrinsicSimplify:
+    return createPatchIntrinsicSimplify();
+  case OptimizationPass::MergedLoadStoreMotion:
+    return createMergedLoadStoreMotionPass();
+  case OptimizationPass::Gvn:
+    return createGVNPass(/* disableGvnLoadPre = */ true);
+  case OptimizationPass::Sccp:
+    return createSCCPPass();
+  case OptimizationPass::BitTrackingDce:
+    return createBitTrackingDCEPass();
+  case OptimizationPass::AggressiveDce:
+    return createAggressiveDCEPass();
+  case OptimizationPass::Float2Int:
+    return createFloat2IntPass();
+  case OptimizationPass::LoopUnroll:
+    return createLoopUnrollPass(entry.param);
+  case OptimizationPass::LoopSink:
+    return createLoopSinkPass();
+  case OptimizationPass::DivRemPairs:
+    return createDivRemPairsPass();
+  case OptimizationPass::LoopRotate:
+    return createLoopRotatePass();
+  case OptimizationPass::Licm:
+    return createLICMPass();
+  case OptimizationPass::IndVarSimplify:
+    return createIndVarSimplifyPass();
+  case OptimizationPass::LoopIdiom:
+    return createLoopIdiomPass();
+  case OptimizationPass::LoopDeletion:
+    return createLoopDeletionPass();
+  case OptimizationPass::SimpleLoopUnroll:
+    return createSimpleLoopUnrollPass(entry.param);
+  }
+  llvm_unreachable("Unexpected optimization pass");
+}
+
 // =====================================================================================================================
 // Add optimization passes to pass manager
 //
 // @param [in/out] passMgr : Pass manager to add passes to
 void Patch::addOptimizationPasses(legacy::PassManager &passMgr) {
   // Set up standard optimization passes.
-  if (!cl::UseLlvmOpt) {
-    unsigned optLevel = 3;
-    bool disableGvnLoadPre = true;
-
-    passMgr.add(createForceFunctionAttrsLegacyPass());
-    passMgr.add(createIPSCCPPass());
-    passMgr.add(createCalledValuePropagationPass());
-    passMgr.add(createGlobalOptimizerPass());
-    passMgr.add(createPromoteMemoryToRegisterPass());
-    passMgr.add(createInstructionCombiningPass(5));
-    passMgr.add(createPatchPeepholeOpt());
-    passMgr.add(createInstSimplifyLegacyPass());
-    passMgr.add(createCFGSimplificationPass());
-    passMgr.add(createSROAPass());
-    passMgr.add(createEarlyCSEPass(true));
-    passMgr.add(createSpeculativeExecutionIfHasBranchDivergencePass());
-    passMgr.add(createCorrelatedValuePropagationPass());
-    passMgr.add(createCFGSimplificationPass());
-    passMgr.add(createAggressiveInstCombinerPass());
-    passMgr.add(createInstructionCombiningPass(3));
-    passMgr.add(createPatchPeepholeOpt());
-    passMgr.add(createInstSimplifyLegacyPass());
-    passMgr.add(createCFGSimplificationPass());
-    passMgr.add(createReassociatePass());
-    passMgr.add(createLoopRotatePass());
-    passMgr.add(createLICMPass());
-    passMgr.add(createCFGSimplificationPass());
-    passMgr.add(createInstructionCombiningPass(2));
-    passMgr.add(createIndVarSimplifyPass());
-    passMgr.add(createLoopIdiomPass());
-    passMgr.add(createLoopDeletionPass());
-    passMgr.add(createSimpleLoopUnrollPass(optLevel));
-    passMgr.add(createPatchPeepholeOpt());
-    passMgr.add(createScalarizerPass());
-    passMgr.add(createPatchLoadScalarizer());
-    passMgr.add(createInstSimplifyLegacyPass());
-    passMgr.add(createPatchIntrinsicSimplify());
-    passMgr.add(createMergedLoadStoreMotionPass());
-    passMgr.add(createGVNPass(disableGvnLoadPre));
-    passMgr.add(createSCCPPass());
-    passMgr.add(createBitTrackingDCEPass());
-    passMgr.add(createInstructionCombiningPass(2));
-    passMgr.add(createPatchPeepholeOpt());
-    passMgr.add(createCorrelatedValuePropagationPass());
-    passMgr.add(createAggressiveDCEPass());
-    passMgr.add(createCFGSimplificationPass());
-    passMgr.add(createInstSimplifyLegacyPass());
-    passMgr.add(createFloat2IntPass());
-    passMgr.add(createLoopRotatePass());
-    passMgr.add(createCFGSimplificationPass(1, true, true, true, true));
-    passMgr.add(createPatchPeepholeOpt(true));
-    passMgr.add(createInstSimplifyLegacyPass());
-    passMgr.add(createLoopUnrollPass(optLevel));
-    passMgr.add(createInstructionCombiningPass(2));
-    passMgr.add(createLICMPass());
-    passMgr.add(createStripDeadPrototypesPass());
-    passMgr.add(createGlobalDCEPass());
-    passMgr.add(createConstantMergePass());
-    passMgr.add(createLoopSinkPass());
-    passMgr.add(createInstSimplifyLegacyPass());
-    passMgr.add(createDivRemPairsPass());
-    passMgr.add(createCFGSimplificationPass());
+  if (!cl::UseLlvmOpt && cl::NewPmPatchOpt) {
+    // The same curated set, run by the new pass manager inside a single legacy pass so that analyses are cached
+    // across the optimizations.
+    passMgr.add(createPatchNewPmOptimizer());
+  } else if (!cl::UseLlvmOpt) {
+    for (const OptimizationPassEntry &entry : getOptimizationPasses())
+      passMgr.add(createOptimizationPass(entry));
   } else {
     PassManagerBuilder passBuilder;
     passBuilder.OptLevel = 3; // -O3
@@ -324,6 +437,23 @@ void Patch::addOptimizationPasses(legacy::PassManager &passMgr) {
   }
 }
 
+// =====================================================================================================================
+// Add the reduced optimization pass list of the fast compile tier to pass manager. This only cleans up what the
+// front-end and patching passes leave behind; loop optimizations and the more expensive scalar passes are left to the
+// full tier.
+//
+// @param [in/out] passMgr : Pass manager to add passes to
+void Patch::addFastOptimizationPasses(legacy::PassManager &passMgr) {
+  passMgr.add(createSROAPass());
+  passMgr.add(createEarlyCSEPass(true));
+  passMgr.add(createInstructionCombiningPass(1));
+  passMgr.add(createPatchPeepholeOpt());
+  passMgr.add(createInstSimplifyLegacyPass());
+  passMgr.add(createAggressiveDCEPass());
+  passMgr.add(createCFGSimplificationPass());
+  passMgr.add(createGlobalDCEPass());
+}
+
 // =====================================================================================================================
 // Initializes the pass according to the specified module.
 //
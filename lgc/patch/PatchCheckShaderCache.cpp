@@ -139,6 +139,27 @@ bool PatchCheckShaderCache::runOnModule(Module &module) {
       streamMapEntries(resUsage->inOutUsage.gs.builtInOutLocs, stream);
     }
 
+    // Update the state that the shader actually consumes: the vertex input descriptions of the vertex inputs that
+    // are read, and the color export formats of the fragment outputs that are written. The caller leaves the rest of
+    // the vertex input and color target state out of its hash, so pipelines that differ only in unused state share
+    // cache entries.
+    if (stage == ShaderStageVertex) {
+      for (const auto &locMap : resUsage->inOutUsage.inputLocMap) {
+        VertexInputDescription inputDesc = {};
+        if (const VertexInputDescription *foundDesc = pipelineState->findVertexInputDescription(locMap.first))
+          inputDesc = *foundDesc;
+        stream << StringRef(reinterpret_cast<const char *>(&inputDesc), sizeof(inputDesc));
+      }
+    } else if (stage == ShaderStageFragment) {
+      for (unsigned location = 0; location < MaxColorTargets; ++location) {
+        if (resUsage->inOutUsage.fs.outputTypes[location] == BasicType::Unknown)
+          continue;
+        const ColorExportFormat &format = pipelineState->getColorExportFormat(location);
+        stream << StringRef(reinterpret_cast<const char *>(&location), sizeof(location));
+        stream << StringRef(reinterpret_cast<const char *>(&format), sizeof(format));
+      }
+    }
+
     // Store the result of the hash for this shader stage.
     stream.flush();
     inOutUsageValues[stage] = ArrayRef<uint8_t>(reinterpret_cast<const uint8_t *>(inOutUsageStreams[stage].data()),
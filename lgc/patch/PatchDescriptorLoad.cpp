@@ -71,13 +71,31 @@ bool PatchDescriptorLoad::runOnModule(Module &module) {
   m_pipelineState = getAnalysis<PipelineStateWrapper>().getPipelineState(&module);
   m_pipelineSysValues.initialize(m_pipelineState);
 
-  // Invoke handling of "call" instruction
+  // Process the calls to the descriptor functions from the shader entry-points. Each call is replaced by code
+  // inserted at the call, so the order they are processed in does not matter; the users of each declaration are
+  // gathered first, as processing a call can add uses of other declarations.
+  m_intrinsics.init(module);
   auto pipelineShaders = &getAnalysis<PipelineShaders>();
-  for (unsigned shaderStage = 0; shaderStage < ShaderStageCountInternal; ++shaderStage) {
-    m_entryPoint = pipelineShaders->getEntryPoint(static_cast<ShaderStage>(shaderStage));
-    if (m_entryPoint) {
-      m_shaderStage = static_cast<ShaderStage>(shaderStage);
-      visit(*m_entryPoint);
+  static const LgcIntrinsic DescriptorIntrinsics[] = {
+      LgcIntrinsic::DescriptorGetResourcePtr, LgcIntrinsic::DescriptorGetSamplerPtr,
+      LgcIntrinsic::DescriptorGetFmaskPtr,    LgcIntrinsic::DescriptorGetTexelBufferPtr,
+      LgcIntrinsic::DescriptorIndex,          LgcIntrinsic::DescriptorLoadFromPtr,
+      LgcIntrinsic::DescriptorLoadSpillTable, LgcIntrinsic::DescriptorLoadBuffer,
+  };
+  for (LgcIntrinsic intrinsic : DescriptorIntrinsics) {
+    for (Function *func : m_intrinsics.getDeclarations(intrinsic)) {
+      SmallVector<CallInst *, 8> calls;
+      for (User *user : func->users()) {
+        auto call = dyn_cast<CallInst>(user);
+        if (call && call->getCalledFunction() == func)
+          calls.push_back(call);
+      }
+      for (CallInst *call : calls) {
+        m_entryPoint = call->getFunction();
+        m_shaderStage = pipelineShaders->getShaderStage(m_entryPoint);
+        if (m_shaderStage != ShaderStageInvalid)
+          processCall(*call, intrinsic);
+      }
     }
   }
 
@@ -100,10 +118,11 @@ bool PatchDescriptorLoad::runOnModule(Module &module) {
   // Remove dead llpc.descriptor.point* and llpc.descriptor.index calls that were not
   // processed by the code above. That happens if they were never used in llpc.descriptor.load.from.ptr.
   SmallVector<Function *, 4> deadDescFuncs;
-  for (Function &func : *m_module) {
-    if (func.isDeclaration() && (func.getName().startswith(lgcName::DescriptorGetPtrPrefix) ||
-                                 func.getName().startswith(lgcName::DescriptorIndex)))
-      deadDescFuncs.push_back(&func);
+  for (LgcIntrinsic intrinsic : {LgcIntrinsic::DescriptorGetResourcePtr, LgcIntrinsic::DescriptorGetSamplerPtr,
+                                 LgcIntrinsic::DescriptorGetFmaskPtr, LgcIntrinsic::DescriptorGetTexelBufferPtr,
+                                 LgcIntrinsic::DescriptorIndex}) {
+    ArrayRef<Function *> declarations = m_intrinsics.getDeclarations(intrinsic);
+    deadDescFuncs.append(declarations.begin(), declarations.end());
   }
   for (Function *func : deadDescFuncs) {
     while (!func->use_empty())
@@ -120,8 +139,8 @@ bool PatchDescriptorLoad::runOnModule(Module &module) {
 // This generates code to build a {ptr,stride} struct.
 //
 // @param descPtrCall : Call to llpc.descriptor.get.*.ptr
-// @param descPtrCallName : Name of that call
-void PatchDescriptorLoad::processDescriptorGetPtr(CallInst *descPtrCall, StringRef descPtrCallName) {
+// @param intrinsic : ID of the called function
+void PatchDescriptorLoad::processDescriptorGetPtr(CallInst *descPtrCall, LgcIntrinsic intrinsic) {
   m_entryPoint = descPtrCall->getFunction();
   BuilderBase builder(*m_context);
   builder.SetInsertPoint(descPtrCall);
@@ -131,11 +150,11 @@ void PatchDescriptorLoad::processDescriptorGetPtr(CallInst *descPtrCall, StringR
   unsigned binding = cast<ConstantInt>(descPtrCall->getArgOperand(1))->getZExtValue();
   auto resType = ResourceNodeType::DescriptorResource;
   bool shadow = false;
-  if (descPtrCallName.startswith(lgcName::DescriptorGetTexelBufferPtr))
+  if (intrinsic == LgcIntrinsic::DescriptorGetTexelBufferPtr)
     resType = ResourceNodeType::DescriptorTexelBuffer;
-  else if (descPtrCallName.startswith(lgcName::DescriptorGetSamplerPtr))
+  else if (intrinsic == LgcIntrinsic::DescriptorGetSamplerPtr)
     resType = ResourceNodeType::DescriptorSampler;
-  else if (descPtrCallName.startswith(lgcName::DescriptorGetFmaskPtr)) {
+  else if (intrinsic == LgcIntrinsic::DescriptorGetFmaskPtr) {
     shadow = m_pipelineSysValues.get(m_entryPoint)->isShadowDescTableEnabled();
     resType = ResourceNodeType::DescriptorFmask;
   }
@@ -381,32 +400,30 @@ void PatchDescriptorLoad::processLoadDescFromPtr(CallInst *loadFromPtr) {
 }
 
 // =====================================================================================================================
-// Visits "call" instruction.
+// Process a call to one of the descriptor functions.
 //
-// @param callInst : "Call" instruction
-void PatchDescriptorLoad::visitCallInst(CallInst &callInst) {
-  auto callee = callInst.getCalledFunction();
-  if (!callee)
-    return;
-
-  StringRef mangledName = callee->getName();
-
-  if (mangledName.startswith(lgcName::DescriptorGetPtrPrefix)) {
-    processDescriptorGetPtr(&callInst, mangledName);
-    return;
-  }
+// @param callInst : Call instruction
+// @param intrinsic : ID of the called function
+void PatchDescriptorLoad::processCall(CallInst &callInst, LgcIntrinsic intrinsic) {
+  Function *callee = callInst.getCalledFunction();
+
+  switch (intrinsic) {
+  case LgcIntrinsic::DescriptorGetResourcePtr:
+  case LgcIntrinsic::DescriptorGetSamplerPtr:
+  case LgcIntrinsic::DescriptorGetFmaskPtr:
+  case LgcIntrinsic::DescriptorGetTexelBufferPtr:
+    processDescriptorGetPtr(&callInst, intrinsic);
+    break;
 
-  if (mangledName.startswith(lgcName::DescriptorIndex)) {
+  case LgcIntrinsic::DescriptorIndex:
     processDescriptorIndex(&callInst);
-    return;
-  }
+    break;
 
-  if (mangledName.startswith(lgcName::DescriptorLoadFromPtr)) {
+  case LgcIntrinsic::DescriptorLoadFromPtr:
     processLoadDescFromPtr(&callInst);
-    return;
-  }
+    break;
 
-  if (mangledName.startswith(lgcName::DescriptorLoadSpillTable)) {
+  case LgcIntrinsic::DescriptorLoadSpillTable:
     // Descriptor loading should be inlined and stay in shader entry-point
     assert(callInst.getParent()->getParent() == m_entryPoint);
     m_changed = true;
@@ -419,10 +436,9 @@ void PatchDescriptorLoad::visitCallInst(CallInst &callInst) {
     }
     m_descLoadCalls.push_back(&callInst);
     m_descLoadFuncs.insert(callee);
-    return;
-  }
+    break;
 
-  if (mangledName.startswith(lgcName::DescriptorLoadBuffer)) {
+  case LgcIntrinsic::DescriptorLoadBuffer:
     // Descriptor loading should be inlined and stay in shader entry-point
     assert(callInst.getParent()->getParent() == m_entryPoint);
     m_changed = true;
@@ -436,7 +452,10 @@ void PatchDescriptorLoad::visitCallInst(CallInst &callInst) {
     }
     m_descLoadCalls.push_back(&callInst);
     m_descLoadFuncs.insert(callee);
-    return;
+    break;
+
+  default:
+    break;
   }
 }
 
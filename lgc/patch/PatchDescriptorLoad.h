@@ -34,14 +34,14 @@
 #include "lgc/patch/Patch.h"
 #include "lgc/state/PipelineShaders.h"
 #include "lgc/state/PipelineState.h"
-#include "llvm/IR/InstVisitor.h"
+#include "lgc/util/IntrinsicRegistry.h"
 #include <unordered_set>
 
 namespace lgc {
 
 // =====================================================================================================================
 // Represents the pass of LLVM patching opertions for descriptor load.
-class PatchDescriptorLoad : public Patch, public llvm::InstVisitor<PatchDescriptorLoad> {
+class PatchDescriptorLoad : public Patch {
 public:
   PatchDescriptorLoad();
 
@@ -52,7 +52,6 @@ public:
   }
 
   virtual bool runOnModule(llvm::Module &module) override;
-  virtual void visitCallInst(llvm::CallInst &callInst);
 
   // -----------------------------------------------------------------------------------------------------------------
 
@@ -62,7 +61,8 @@ private:
   PatchDescriptorLoad(const PatchDescriptorLoad &) = delete;
   PatchDescriptorLoad &operator=(const PatchDescriptorLoad &) = delete;
 
-  void processDescriptorGetPtr(llvm::CallInst *descPtrCall, llvm::StringRef descPtrCallName);
+  void processCall(llvm::CallInst &callInst, LgcIntrinsic intrinsic);
+  void processDescriptorGetPtr(llvm::CallInst *descPtrCall, LgcIntrinsic intrinsic);
   llvm::Value *getDescPtrAndStride(ResourceNodeType resType, unsigned descSet, unsigned binding,
                                    const ResourceNode *topNode, const ResourceNode *node, bool shadow,
                                    BuilderBase &builder);
@@ -88,6 +88,7 @@ private:
 
   bool m_changed;                                       // Whether the pass has modified the code
   PipelineSystemValues m_pipelineSysValues;             // Cache of ShaderValues object per shader
+  IntrinsicRegistry m_intrinsics;                       // IDs of the lgc.* internal calls in the module
   std::vector<llvm::CallInst *> m_descLoadCalls;        // List of instructions to load descriptors
   std::unordered_set<llvm::Function *> m_descLoadFuncs; // Set of descriptor load functions
 
@@ -95,6 +95,7 @@ bool PatchInOutImportExport::runOnModule(Module &module) {
   LLVM_DEBUG(dbgs() << "Run the pass Patch-In-Out-Import-Export\n");
 
   Patch::init(&module);
+  m_intrinsics.init(module);
 
   m_pipelineState = getAnalysis<PipelineStateWrapper>().getPipelineState(&module);
   m_gfxIp = m_pipelineState->getTargetInfo().getGfxIpVersion();
@@ -319,30 +320,19 @@ void PatchInOutImportExport::visitCallInst(CallInst &callInst) {
 
   auto resUsage = m_pipelineState->getShaderResourceUsage(m_shaderStage);
 
-  auto mangledName = callee->getName();
-
-  auto importGenericInput = lgcName::InputImportGeneric;
-  auto importBuiltInInput = lgcName::InputImportBuiltIn;
-  auto importInterpolantInput = lgcName::InputImportInterpolant;
-  auto importGenericOutput = lgcName::OutputImportGeneric;
-  auto importBuiltInOutput = lgcName::OutputImportBuiltIn;
-
-  const bool isGenericInputImport = mangledName.startswith(importGenericInput);
-  const bool isBuiltInInputImport = mangledName.startswith(importBuiltInInput);
-  const bool isInterpolantInputImport = mangledName.startswith(importInterpolantInput);
-  const bool isGenericOutputImport = mangledName.startswith(importGenericOutput);
-  const bool isBuiltInOutputImport = mangledName.startswith(importBuiltInOutput);
+  const LgcIntrinsic intrinsic = m_intrinsics.get(callee);
+  const bool isGenericInputImport = intrinsic == LgcIntrinsic::InputImportGeneric;
+  const bool isBuiltInInputImport = intrinsic == LgcIntrinsic::InputImportBuiltIn;
+  const bool isInterpolantInputImport = intrinsic == LgcIntrinsic::InputImportInterpolant;
+  const bool isGenericOutputImport = intrinsic == LgcIntrinsic::OutputImportGeneric;
+  const bool isBuiltInOutputImport = intrinsic == LgcIntrinsic::OutputImportBuiltIn;
 
   const bool isImport = (isGenericInputImport || isBuiltInInputImport || isInterpolantInputImport ||
                          isGenericOutputImport || isBuiltInOutputImport);
 
-  auto exportGenericOutput = lgcName::OutputExportGeneric;
-  auto exportBuiltInOutput = lgcName::OutputExportBuiltIn;
-  auto exportXfbOutput = lgcName::OutputExportXfb;
-
-  const bool isGenericOutputExport = mangledName.startswith(exportGenericOutput);
-  const bool isBuiltInOutputExport = mangledName.startswith(exportBuiltInOutput);
-  const bool isXfbOutputExport = mangledName.startswith(exportXfbOutput);
+  const bool isGenericOutputExport = intrinsic == LgcIntrinsic::OutputExportGeneric;
+  const bool isBuiltInOutputExport = intrinsic == LgcIntrinsic::OutputExportBuiltIn;
+  const bool isXfbOutputExport = intrinsic == LgcIntrinsic::OutputExportXfb;
 
   const bool isExport = (isGenericOutputExport || isBuiltInOutputExport || isXfbOutputExport);
 
@@ -1259,6 +1249,13 @@ void PatchInOutImportExport::visitReturnInst(ReturnInst &retInst) {
       // the export count.
       auto resUsage = m_pipelineState->getShaderResourceUsage(m_shaderStage);
       for (auto locMap : resUsage->inOutUsage.outputLocMap) {
+        if (m_shaderStage == ShaderStageCopyShader) {
+          // Only the outputs of the rasterization stream are exported from the copy shader.
+          GsOutLocInfo outLocInfo = {};
+          outLocInfo.u32All = locMap.first;
+          if (outLocInfo.streamId != resUsage->inOutUsage.gs.rasterStream)
+            continue;
+        }
         if (m_expLocs.count(locMap.second) != 0)
           continue;
         ++inOutUsage.expCount;
@@ -36,6 +36,7 @@
 #include "lgc/state/PipelineShaders.h"
 #include "lgc/state/PipelineState.h"
 #include "lgc/state/TargetInfo.h"
+#include "lgc/util/IntrinsicRegistry.h"
 #include "llvm/IR/InstVisitor.h"
 #include <set>
 
@@ -207,6 +208,7 @@ private:
 
   GfxIpVersion m_gfxIp;                     // Graphics IP version info
   PipelineSystemValues m_pipelineSysValues; // Cache of ShaderSystemValues objects, one per shader stage
+  IntrinsicRegistry m_intrinsics;           // IDs of the lgc.* internal calls in the module
 
   VertexFetch *m_vertexFetch;         // Vertex fetch manager
   FragColorExport *m_fragColorExport; // Fragment color export manager
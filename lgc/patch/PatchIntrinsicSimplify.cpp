@@ -80,14 +80,25 @@ void PatchIntrinsicSimplify::getAnalysisUsage(AnalysisUsage &analysisUsage) cons
 //
 // @param [in,out] func : LLVM function to be run on.
 bool PatchIntrinsicSimplify::runOnFunction(Function &func) {
+  GfxIpVersion gfxIp =
+      getAnalysis<PipelineStateWrapper>().getPipelineState(func.getParent())->getTargetInfo().getGfxIpVersion();
+  return runImpl(func, gfxIp, &getAnalysis<ScalarEvolutionWrapperPass>().getSE());
+}
+
+// =====================================================================================================================
+// Runs intrinsic simplifications on the specified LLVM function. This is shared by the legacy pass and the new pass
+// manager pipeline, which get the analyses it needs in their own way.
+//
+// @param [in,out] func : LLVM function to be run on.
+// @param gfxIp : Graphics IP version
+// @param scalarEvolution : Scalar evolution analysis of the function
+bool PatchIntrinsicSimplify::runImpl(Function &func, GfxIpVersion gfxIp, ScalarEvolution *scalarEvolution) {
   SmallVector<IntrinsicInst *, 32> candidateCalls;
   bool changed = false;
 
   m_module = func.getParent();
-
-  m_gfxIp = getAnalysis<PipelineStateWrapper>().getPipelineState(m_module)->getTargetInfo().getGfxIpVersion();
-
-  m_scalarEvolution = &getAnalysis<ScalarEvolutionWrapperPass>().getSE();
+  m_gfxIp = gfxIp;
+  m_scalarEvolution = scalarEvolution;
   m_context = &func.getContext();
 
   // We iterate over users of intrinsics which should be less work than
@@ -61,6 +61,8 @@ public:
   void getAnalysisUsage(llvm::AnalysisUsage &analysisUsage) const override;
   bool runOnFunction(llvm::Function &func) override;
 
+  bool runImpl(llvm::Function &func, GfxIpVersion gfxIp, llvm::ScalarEvolution *scalarEvolution);
+
   // -----------------------------------------------------------------------------------------------------------------
 
   static char ID; // ID of this pass
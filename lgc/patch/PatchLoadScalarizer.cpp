@@ -31,6 +31,8 @@
 #include "PatchLoadScalarizer.h"
 #include "lgc/state/PipelineShaders.h"
 #include "lgc/state/PipelineState.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/CFG.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/Support/Debug.h"
@@ -77,18 +79,33 @@ bool PatchLoadScalarizer::runOnFunction(Function &function) {
 
   auto pipelineState = getAnalysis<PipelineStateWrapper>().getPipelineState(function.getParent());
   auto pipelineShaders = &getAnalysis<PipelineShaders>();
-  auto shaderStage = pipelineShaders->getShaderStage(&function);
+  return runImpl(function, pipelineState, pipelineShaders->getShaderStage(&function));
+}
 
+// =====================================================================================================================
+// Runs the load scalarizer on the specified LLVM function. This is shared by the legacy pass and the new pass manager
+// pipeline.
+//
+// @param [in,out] function : Function that will run this optimization.
+// @param pipelineState : Pipeline state
+// @param shaderStage : Shader stage of the function, or ShaderStageInvalid if it is not a shader entry-point
+bool PatchLoadScalarizer::runImpl(Function &function, PipelineState *pipelineState, ShaderStage shaderStage) {
   // If the function is not a valid shader stage, or the optimization is disabled, bail.
   m_scalarThreshold = 0;
-  if (shaderStage != ShaderStageInvalid)
+  m_costModel = false;
+  if (shaderStage != ShaderStageInvalid) {
     m_scalarThreshold = pipelineState->getShaderOptions(shaderStage).loadScalarizerThreshold;
+    m_costModel = pipelineState->getShaderOptions(shaderStage).loadScalarizerCostModel;
+  }
   if (m_scalarThreshold == 0)
     return false;
 
   m_builder.reset(new IRBuilder<>(function.getContext()));
+  if (m_costModel)
+    computeRegPressure(function);
 
   visit(function);
+  m_regPressure.clear();
 
   const bool changed = (!m_instsToErase.empty());
 
@@ -132,6 +149,11 @@ void PatchLoadScalarizer::visitLoadInst(LoadInst &loadInst) {
     if (compCount > m_scalarThreshold)
       return;
 
+    // With the cost model, only scalarize if it is profitable, and then only load the components that are used.
+    SmallBitVector usedComps(compCount, true);
+    if (m_costModel && !isScalarizeProfitable(loadInst, usedComps))
+      return;
+
     Type *compTy = cast<VectorType>(loadTy)->getElementType();
     uint64_t compSize = loadInst.getModule()->getDataLayout().getTypeStoreSize(compTy);
 
@@ -150,6 +172,10 @@ void PatchLoadScalarizer::visitLoadInst(LoadInst &loadInst) {
                                                  loadInst.getPointerOperand()->getName() + ".i0");
 
     for (unsigned i = 0; i < compCount; i++) {
+      if (!usedComps[i]) {
+        loadComps[i] = UndefValue::get(compTy);
+        continue;
+      }
       Value *loadCompPtr = m_builder->CreateConstGEP1_32(compTy, newLoadPtr, i,
                                                          loadInst.getPointerOperand()->getName() + ".i" + Twine(i));
       // Calculate the alignment of component i
@@ -163,6 +189,8 @@ void PatchLoadScalarizer::visitLoadInst(LoadInst &loadInst) {
     }
 
     for (unsigned i = 0; i < compCount; i++) {
+      if (!usedComps[i])
+        continue;
       loadValue = m_builder->CreateInsertElement(loadValue, loadComps[i], m_builder->getInt32(i),
                                                  loadInst.getName() + ".u" + Twine(i));
     }
@@ -173,6 +201,159 @@ void PatchLoadScalarizer::visitLoadInst(LoadInst &loadInst) {
   }
 }
 
+// =====================================================================================================================
+// Estimate the register pressure at each instruction of the function, for the cost model. The pressure is the
+// number of dwords of the values live just after the instruction, from a backward liveness scan of each block. The
+// values live out of a block are those used in another block, or by a phi in a successor. Values that are live
+// through a block without being used in it are not counted, and neither is whether a value is in VGPRs or SGPRs.
+//
+// @param function : Function to estimate the register pressure of
+void PatchLoadScalarizer::computeRegPressure(Function &function) {
+  m_regPressure.clear();
+  m_peakRegPressure = 0;
+  const DataLayout &dataLayout = function.getParent()->getDataLayout();
+
+  for (BasicBlock &block : function) {
+    SmallPtrSet<Value *, 32> live;
+    unsigned liveDwords = 0;
+    auto addLive = [&](Value *value) {
+      if ((isa<Instruction>(value) || isa<Argument>(value)) && value->getType()->isSized() && live.insert(value).second)
+        liveDwords += divideCeil(dataLayout.getTypeStoreSize(value->getType()), 4);
+    };
+
+    for (Instruction &inst : block) {
+      for (User *user : inst.users()) {
+        if (cast<Instruction>(user)->getParent() != &block) {
+          addLive(&inst);
+          break;
+        }
+      }
+    }
+    for (BasicBlock *succ : successors(&block)) {
+      for (PHINode &phi : succ->phis())
+        addLive(phi.getIncomingValueForBlock(&block));
+    }
+
+    unsigned position = block.size();
+    for (Instruction &inst : reverse(block)) {
+      m_regPressure[&inst] = {--position, liveDwords};
+      m_peakRegPressure = std::max(m_peakRegPressure, liveDwords);
+      if (live.erase(&inst))
+        liveDwords -= divideCeil(dataLayout.getTypeStoreSize(inst.getType()), 4);
+      if (isa<PHINode>(inst))
+        continue;
+      for (Value *operand : inst.operands())
+        addLive(operand);
+    }
+  }
+}
+
+// =====================================================================================================================
+// Cost model for scalarizing a vector load. Returns true if splitting the load into component loads is expected to
+// be profitable, setting in usedComps the components that need to be loaded.
+//
+// The benefit is in registers. A component that is never used does not need to be loaded, and so needs no register.
+// And where the load is live across the peak register pressure of the function, splitting it can lower that peak:
+// a vector is live until the last use of any of its components, but each component load only until its own last
+// use. A dword off the peak can lower the VGPR count, and so raise occupancy, so it is weighted above an instruction.
+// The cost is in load instructions: the component loads, compared with the loads the backend issues for the vector
+// load, which depend on its alignment. (A vector load that is not aligned to its size is split by the backend anyway,
+// so scalarizing it costs little.)
+//
+// @param loadInst : The vector load
+// @param [out] usedComps : Bit per component, set if the component is used
+bool PatchLoadScalarizer::isScalarizeProfitable(LoadInst &loadInst, SmallBitVector &usedComps) const {
+  auto loadTy = cast<VectorType>(loadInst.getType());
+  unsigned compCount = loadTy->getNumElements();
+  const DataLayout &dataLayout = loadInst.getModule()->getDataLayout();
+  uint64_t compSize = dataLayout.getTypeStoreSize(loadTy->getElementType());
+  uint64_t loadSize = dataLayout.getTypeStoreSize(loadTy);
+
+  // Find which components are used, and the position of the last use of each in the block of the load, or UINT_MAX
+  // if it is used in another block. If any use is other than an extractelement with a constant index, all components
+  // are used, and the vector is rebuilt straight after the component loads, so no live range is shortened.
+  usedComps.reset();
+  SmallVector<unsigned, 4> compLastUses(compCount, 0);
+  bool allUsed = false;
+  for (User *user : loadInst.users()) {
+    auto extract = dyn_cast<ExtractElementInst>(user);
+    auto index = extract ? dyn_cast<ConstantInt>(extract->getIndexOperand()) : nullptr;
+    if (!index || index->getZExtValue() >= compCount) {
+      allUsed = true;
+      break;
+    }
+    unsigned comp = index->getZExtValue();
+    usedComps.set(comp);
+    unsigned position = UINT_MAX;
+    if (extract->getParent() == loadInst.getParent())
+      position = m_regPressure.lookup(extract).position;
+    compLastUses[comp] = std::max(compLastUses[comp], position);
+  }
+
+  unsigned pressureBenefit = 0;
+  if (allUsed)
+    usedComps.set();
+  else
+    pressureBenefit = getPressureBenefit(loadInst, usedComps, compLastUses, divideCeil(compSize, 4));
+
+  unsigned unusedDwords = divideCeil((compCount - usedComps.count()) * compSize, 4);
+  int benefit = unusedDwords + 2 * pressureBenefit;
+
+  // Extra load instructions. The backend loads at most a dwordx4 at once, and no more than the alignment allows.
+  uint64_t alignment = std::max(uint64_t(loadInst.getAlignment()), compSize);
+  uint64_t vectorLoadSize = std::min(uint64_t(16), std::max(uint64_t(4), alignment));
+  int vectorLoadCount = divideCeil(loadSize, vectorLoadSize);
+  int cost = int(usedComps.count()) - vectorLoadCount;
+
+  LLVM_DEBUG(dbgs() << "Load scalarizer cost model: benefit " << benefit << " (pressure " << pressureBenefit
+                    << "), cost " << cost << ": " << loadInst << "\n");
+  return benefit > cost;
+}
+
+// =====================================================================================================================
+// Get by how many dwords scalarizing a vector load lowers the estimated peak register pressure of the function.
+// This is 0 unless the pressure reaches the peak somewhere in the live range of the load within its block.
+//
+// @param loadInst : The vector load
+// @param usedComps : Bit per component, set if the component is used
+// @param compLastUses : Position of the last use of each used component in the block, or UINT_MAX if it is live out
+// @param compDwords : Dwords of a register for one component
+unsigned PatchLoadScalarizer::getPressureBenefit(LoadInst &loadInst, const SmallBitVector &usedComps,
+                                                 ArrayRef<unsigned> compLastUses, unsigned compDwords) const {
+  if (m_regPressure.count(&loadInst) == 0)
+    return 0;
+  unsigned vectorDwords = divideCeil(loadInst.getModule()->getDataLayout().getTypeStoreSize(loadInst.getType()), 4);
+  unsigned lastUse = 0;
+  for (unsigned comp : usedComps.set_bits())
+    lastUse = std::max(lastUse, compLastUses[comp]);
+
+  unsigned oldPeak = 0;
+  unsigned newPeak = 0;
+  for (Instruction *inst = &loadInst; inst; inst = inst->getNextNode()) {
+    // Skip the instructions this pass inserted for loads it has already scalarized.
+    auto pointIt = m_regPressure.find(inst);
+    if (pointIt == m_regPressure.end())
+      continue;
+    const RegPressurePoint &point = pointIt->second;
+    if (point.position > lastUse)
+      break;
+
+    // Once scalarized, a used component is live until its own last use, and the vector is not live at all.
+    unsigned liveCompDwords = 0;
+    for (unsigned comp : usedComps.set_bits()) {
+      if (compLastUses[comp] > point.position)
+        liveCompDwords += compDwords;
+    }
+    unsigned liveVectorDwords = point.position < lastUse ? vectorDwords : 0;
+    oldPeak = std::max(oldPeak, point.liveDwords);
+    newPeak = std::max(newPeak, point.liveDwords - liveVectorDwords + liveCompDwords);
+  }
+
+  if (oldPeak < m_peakRegPressure || newPeak >= oldPeak)
+    return 0;
+  return oldPeak - newPeak;
+}
+
 } // namespace lgc
 
 // =====================================================================================================================
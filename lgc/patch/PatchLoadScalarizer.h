@@ -32,6 +32,8 @@
 
 #include "lgc/Builder.h"
 #include "lgc/patch/Patch.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallBitVector.h"
 #include "llvm/IR/InstVisitor.h"
 
 namespace lgc {
@@ -45,6 +47,8 @@ public:
   void getAnalysisUsage(llvm::AnalysisUsage &analysisUsage) const override;
   bool runOnFunction(llvm::Function &function) override;
 
+  bool runImpl(llvm::Function &function, PipelineState *pipelineState, ShaderStage shaderStage);
+
   void visitLoadInst(llvm::LoadInst &loadInst);
 
   // -----------------------------------------------------------------------------------------------------------------
@@ -55,11 +59,26 @@ private:
   PatchLoadScalarizer(const PatchLoadScalarizer &) = delete;
   PatchLoadScalarizer &operator=(const PatchLoadScalarizer &) = delete;
 
+  // Estimated register pressure just after an instruction
+  struct RegPressurePoint {
+    unsigned position;   // Position of the instruction in its block
+    unsigned liveDwords; // Dwords of the values live just after the instruction
+  };
+
+  void computeRegPressure(llvm::Function &function);
+  bool isScalarizeProfitable(llvm::LoadInst &loadInst, llvm::SmallBitVector &usedComps) const;
+  unsigned getPressureBenefit(llvm::LoadInst &loadInst, const llvm::SmallBitVector &usedComps,
+                              llvm::ArrayRef<unsigned> compLastUses, unsigned compDwords) const;
+
   // -----------------------------------------------------------------------------------------------------------------
 
   llvm::SmallVector<llvm::Instruction *, 8> m_instsToErase; // Instructions to erase
   std::unique_ptr<llvm::IRBuilder<>> m_builder;             // The IRBuilder.
   unsigned m_scalarThreshold;                               // The threshold for load scalarizer
+  bool m_costModel = false;                                 // Whether to decide by the cost model
+  // Estimated register pressure at each instruction, for the cost model
+  llvm::DenseMap<const llvm::Instruction *, RegPressurePoint> m_regPressure;
+  unsigned m_peakRegPressure = 0; // Highest estimated register pressure in the function
 };
 
 } // namespace lgc
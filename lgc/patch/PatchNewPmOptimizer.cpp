@@ -0,0 +1,391 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  PatchNewPmOptimizer.cpp
+* @brief LLPC source file: contains declaration and implementation of class lgc::PatchNewPmOptimizer.
+***********************************************************************************************************************
+*/
+#include "PatchIntrinsicSimplify.h"
+#include "PatchLoadScalarizer.h"
+#include "PatchPeepholeOpt.h"
+#include "lgc/LgcContext.h"
+#include "lgc/patch/Patch.h"
+#include "lgc/state/PipelineShaders.h"
+#include "lgc/state/PipelineState.h"
+#include "lgc/state/TargetInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/AggressiveInstCombine/AggressiveInstCombine.h"
+#include "llvm/Transforms/IPO/CalledValuePropagation.h"
+#include "llvm/Transforms/IPO/ConstantMerge.h"
+#include "llvm/Transforms/IPO/ForceFunctionAttrs.h"
+#include "llvm/Transforms/IPO/GlobalDCE.h"
+#include "llvm/Transforms/IPO/GlobalOpt.h"
+#include "llvm/Transforms/IPO/SCCP.h"
+#include "llvm/Transforms/IPO/StripDeadPrototypes.h"
+#include "llvm/Transforms/InstCombine/InstCombine.h"
+#include "llvm/Transforms/Scalar/ADCE.h"
+#include "llvm/Transforms/Scalar/BDCE.h"
+#include "llvm/Transforms/Scalar/CorrelatedValuePropagation.h"
+#include "llvm/Transforms/Scalar/DivRemPairs.h"
+#include "llvm/Transforms/Scalar/EarlyCSE.h"
+#include "llvm/Transforms/Scalar/Float2Int.h"
+#include "llvm/Transforms/Scalar/GVN.h"
+#include "llvm/Transforms/Scalar/IndVarSimplify.h"
+#include "llvm/Transforms/Scalar/InstSimplifyPass.h"
+#include "llvm/Transforms/Scalar/LICM.h"
+#include "llvm/Transforms/Scalar/LoopDeletion.h"
+#include "llvm/Transforms/Scalar/LoopIdiomRecognize.h"
+#include "llvm/Transforms/Scalar/LoopPassManager.h"
+#include "llvm/Transforms/Scalar/LoopRotation.h"
+#include "llvm/Transforms/Scalar/LoopSink.h"
+#include "llvm/Transforms/Scalar/LoopUnrollPass.h"
+#include "llvm/Transforms/Scalar/MergedLoadStoreMotion.h"
+#include "llvm/Transforms/Scalar/Reassociate.h"
+#include "llvm/Transforms/Scalar/SCCP.h"
+#include "llvm/Transforms/Scalar/SROA.h"
+#include "llvm/Transforms/Scalar/Scalarizer.h"
+#include "llvm/Transforms/Scalar/SimplifyCFG.h"
+#include "llvm/Transforms/Scalar/SpeculativeExecution.h"
+#include "llvm/Transforms/Utils/Mem2Reg.h"
+
+#define DEBUG_TYPE "llpc-patch-new-pm-optimizer"
+
+using namespace llvm;
+using namespace lgc;
+
+namespace {
+
+// =====================================================================================================================
+// New pass manager form of PatchPeepholeOpt. The legacy pass does not use any analysis, so it is run as is.
+class PeepholeOptPass : public PassInfoMixin<PeepholeOptPass> {
+public:
+  explicit PeepholeOptPass(bool enableDiscardOpt = false) : m_enableDiscardOpt(enableDiscardOpt) {}
+
+  PreservedAnalyses run(Function &function, FunctionAnalysisManager &analysisMgr) {
+    PatchPeepholeOpt peepholeOpt(m_enableDiscardOpt);
+    if (!peepholeOpt.runOnFunction(function))
+      return PreservedAnalyses::all();
+    PreservedAnalyses preserved;
+    preserved.preserveSet<CFGAnalyses>();
+    return preserved;
+  }
+
+private:
+  bool m_enableDiscardOpt; // Whether to enable the optimization for "kill" intrinsic
+};
+
+// =====================================================================================================================
+// New pass manager form of PatchIntrinsicSimplify, using the cached scalar evolution of the function.
+class IntrinsicSimplifyPass : public PassInfoMixin<IntrinsicSimplifyPass> {
+public:
+  explicit IntrinsicSimplifyPass(GfxIpVersion gfxIp) : m_gfxIp(gfxIp) {}
+
+  PreservedAnalyses run(Function &function, FunctionAnalysisManager &analysisMgr) {
+    PatchIntrinsicSimplify intrinsicSimplify;
+    if (!intrinsicSimplify.runImpl(function, m_gfxIp, &analysisMgr.getResult<ScalarEvolutionAnalysis>(function)))
+      return PreservedAnalyses::all();
+    PreservedAnalyses preserved;
+    preserved.preserveSet<CFGAnalyses>();
+    preserved.preserve<ScalarEvolutionAnalysis>();
+    return preserved;
+  }
+
+private:
+  GfxIpVersion m_gfxIp; // Graphics IP version
+};
+
+// =====================================================================================================================
+// New pass manager form of PatchLoadScalarizer.
+class LoadScalarizerPass : public PassInfoMixin<LoadScalarizerPass> {
+public:
+  LoadScalarizerPass(PipelineState *pipelineState, PipelineShaders *pipelineShaders)
+      : m_pipelineState(pipelineState), m_pipelineShaders(pipelineShaders) {}
+
+  PreservedAnalyses run(Function &function, FunctionAnalysisManager &analysisMgr) {
+    PatchLoadScalarizer loadScalarizer;
+    if (!loadScalarizer.runImpl(function, m_pipelineState, m_pipelineShaders->getShaderStage(&function)))
+      return PreservedAnalyses::all();
+    PreservedAnalyses preserved;
+    preserved.preserveSet<CFGAnalyses>();
+    return preserved;
+  }
+
+private:
+  PipelineState *m_pipelineState;     // Pipeline state
+  PipelineShaders *m_pipelineShaders; // Shader entry-points of the pipeline
+};
+
+} // anonymous namespace
+
+namespace lgc {
+
+// =====================================================================================================================
+// Pass to run the curated optimization pipeline of Patch::addOptimizationPasses with the new pass manager, so that
+// function analyses such as the dominator tree, loop info and scalar evolution are cached across passes and only
+// recomputed when a pass invalidates them.
+class PatchNewPmOptimizer : public ModulePass {
+public:
+  static char ID;
+  PatchNewPmOptimizer() : ModulePass(ID) {}
+
+  void getAnalysisUsage(AnalysisUsage &analysisUsage) const override {
+    analysisUsage.addRequired<PipelineStateWrapper>();
+    analysisUsage.addRequired<PipelineShaders>();
+  }
+
+  bool runOnModule(Module &module) override;
+
+  PatchNewPmOptimizer(const PatchNewPmOptimizer &) = delete;
+  PatchNewPmOptimizer &operator=(const PatchNewPmOptimizer &) = delete;
+
+private:
+  void addPasses(ModulePassManager &passMgr, PipelineState *pipelineState, PipelineShaders *pipelineShaders);
+};
+
+char PatchNewPmOptimizer::ID = 0;
+
+} // namespace lgc
+
+// =====================================================================================================================
+// Create pass to run the optimization pipeline with the new pass manager
+ModulePass *lgc::createPatchNewPmOptimizer() {
+  return new PatchNewPmOptimizer();
+}
+
+// =====================================================================================================================
+// Run the pass on the specified LLVM module.
+//
+// @param [in,out] module : LLVM module to be run on
+bool PatchNewPmOptimizer::runOnModule(Module &module) {
+  LLVM_DEBUG(dbgs() << "Run the pass Patch-New-Pm-Optimizer\n");
+
+  PipelineState *pipelineState = getAnalysis<PipelineStateWrapper>().getPipelineState(&module);
+  PipelineShaders *pipelineShaders = &getAnalysis<PipelineShaders>();
+
+  // The analysis managers live for the whole pipeline, so analyses are shared between all the passes below.
+  LoopAnalysisManager loopAnalysisMgr;
+  FunctionAnalysisManager functionAnalysisMgr;
+  CGSCCAnalysisManager cgsccAnalysisMgr;
+  ModuleAnalysisManager moduleAnalysisMgr;
+
+  // Register the TLI that LgcContext::preparePassManager gives the legacy pass manager first, so that the default
+  // one registered by the pass builder does not replace it.
+  TargetLibraryInfoImpl targetLibInfo = pipelineState->getLgcContext()->getTargetLibraryInfo();
+  functionAnalysisMgr.registerPass([&] { return TargetLibraryAnalysis(targetLibInfo); });
+
+  PassBuilder passBuilder(pipelineState->getLgcContext()->getTargetMachine());
+  passBuilder.registerModuleAnalyses(moduleAnalysisMgr);
+  passBuilder.registerCGSCCAnalyses(cgsccAnalysisMgr);
+  passBuilder.registerFunctionAnalyses(functionAnalysisMgr);
+  passBuilder.registerLoopAnalyses(loopAnalysisMgr);
+  passBuilder.crossRegisterProxies(loopAnalysisMgr, functionAnalysisMgr, cgsccAnalysisMgr, moduleAnalysisMgr);
+
+  ModulePassManager passMgr;
+  addPasses(passMgr, pipelineState, pipelineShaders);
+  PreservedAnalyses preserved = passMgr.run(module, moduleAnalysisMgr);
+  return !preserved.areAllPreserved();
+}
+
+// =====================================================================================================================
+// Add the curated optimization list of Patch::getOptimizationPasses to the new pass manager. Consecutive function
+// passes share a function pass manager, and consecutive loop passes a loop pass manager.
+//
+// @param [in/out] passMgr : Pass manager to add passes to
+// @param pipelineState : Pipeline state
+// @param pipelineShaders : Shader entry-points of the pipeline
+void PatchNewPmOptimizer::addPasses(ModulePassManager &passMgr, PipelineState *pipelineState,
+                                    PipelineShaders *pipelineShaders) {
+  GfxIpVersion gfxIp = pipelineState->getTargetInfo().getGfxIpVersion();
+
+  FunctionPassManager fnPassMgr;
+  LoopPassManager loopPassMgr;
+  bool haveFnPasses = false;
+  bool haveLoopPasses = false;
+  bool loopPassesUseMemorySsa = false;
+
+  auto flushLoopPasses = [&] {
+    if (!haveLoopPasses)
+      return;
+    fnPassMgr.addPass(createFunctionToLoopPassAdaptor(std::move(loopPassMgr), loopPassesUseMemorySsa));
+    loopPassMgr = LoopPassManager();
+    haveLoopPasses = false;
+    loopPassesUseMemorySsa = false;
+    haveFnPasses = true;
+  };
+  auto flushFnPasses = [&] {
+    flushLoopPasses();
+    if (!haveFnPasses)
+      return;
+    passMgr.addPass(createModuleToFunctionPassAdaptor(std::move(fnPassMgr)));
+    fnPassMgr = FunctionPassManager();
+    haveFnPasses = false;
+  };
+  auto addFnPass = [&](auto &&pass) {
+    flushLoopPasses();
+    fnPassMgr.addPass(std::move(pass));
+    haveFnPasses = true;
+  };
+  auto addLoopPass = [&](auto &&pass) {
+    loopPassMgr.addPass(std::move(pass));
+    haveLoopPasses = true;
+  };
+  auto addModulePass = [&](auto &&pass) {
+    flushFnPasses();
+    passMgr.addPass(std::move(pass));
+  };
+
+  for (const OptimizationPassEntry &entry : Patch::getOptimizationPasses()) {
+    switch (entry.pass) {
+    case OptimizationPass::ForceFunctionAttrs:
+      addModulePass(ForceFunctionAttrsPass());
+      break;
+    case OptimizationPass::IpSccp:
+      addModulePass(IPSCCPPass());
+      break;
+    case OptimizationPass::CalledValuePropagation:
+      addModulePass(CalledValuePropagationPass());
+      break;
+    case OptimizationPass::GlobalOpt:
+      addModulePass(GlobalOptPass());
+      break;
+    case OptimizationPass::StripDeadPrototypes:
+      addModulePass(StripDeadPrototypesPass());
+      break;
+    case OptimizationPass::GlobalDce:
+      addModulePass(GlobalDCEPass());
+      break;
+    case OptimizationPass::ConstantMerge:
+      addModulePass(ConstantMergePass());
+      break;
+    case OptimizationPass::PromoteMemoryToRegister:
+      addFnPass(PromotePass());
+      break;
+    case OptimizationPass::InstCombine:
+      addFnPass(InstCombinePass(entry.param));
+      break;
+    case OptimizationPass::PeepholeOpt:
+      addFnPass(PeepholeOptPass(entry.param));
+      break;
+    case OptimizationPass::InstSimplify:
+      addFnPass(InstSimplifyPass());
+      break;
+    case OptimizationPass::CfgSimplify:
+      addFnPass(SimplifyCFGPass());
+      break;
+    case OptimizationPass::CfgSimplifyLate:
+      addFnPass(SimplifyCFGPass(SimplifyCFGOptions()
+                                    .bonusInstThreshold(1)
+                                    .forwardSwitchCondToPhi(true)
+                                    .convertSwitchToLookupTable(true)
+                                    .needCanonicalLoops(true)
+                                    .sinkCommonInsts(true)));
+      break;
+    case OptimizationPass::Sroa:
+      addFnPass(SROA());
+      break;
+    case OptimizationPass::EarlyCse:
+      addFnPass(EarlyCSEPass(/* UseMemorySSA = */ true));
+      break;
+    case OptimizationPass::SpeculativeExecution:
+      addFnPass(SpeculativeExecutionPass(/* OnlyIfDivergentTarget = */ true));
+      break;
+    case OptimizationPass::CorrelatedValuePropagation:
+      addFnPass(CorrelatedValuePropagationPass());
+      break;
+    case OptimizationPass::AggressiveInstCombine:
+      addFnPass(AggressiveInstCombinePass());
+      break;
+    case OptimizationPass::Reassociate:
+      addFnPass(ReassociatePass());
+      break;
+    case OptimizationPass::Scalarizer:
+      addFnPass(ScalarizerPass());
+      break;
+    case OptimizationPass::LoadScalarizer:
+      addFnPass(LoadScalarizerPass(pipelineState, pipelineShaders));
+      break;
+    case OptimizationPass::IntrinsicSimplify:
+      addFnPass(IntrinsicSimplifyPass(gfxIp));
+      break;
+    case OptimizationPass::MergedLoadStoreMotion:
+      addFnPass(MergedLoadStoreMotionPass());
+      break;
+    case OptimizationPass::Gvn:
+      addFnPass(GVN(GVNOptions().setLoadPRE(false)));
+      break;
+    case OptimizationPass::Sccp:
+      addFnPass(SCCPPass());
+      break;
+    case OptimizationPass::BitTrackingDce:
+      addFnPass(BDCEPass());
+      break;
+    case OptimizationPass::AggressiveDce:
+      addFnPass(ADCEPass());
+      break;
+    case OptimizationPass::Float2Int:
+      addFnPass(Float2IntPass());
+      break;
+    case OptimizationPass::LoopUnroll:
+      addFnPass(LoopUnrollPass(LoopUnrollOptions(entry.param)));
+      break;
+    case OptimizationPass::LoopSink:
+      addFnPass(LoopSinkPass());
+      break;
+    case OptimizationPass::DivRemPairs:
+      addFnPass(DivRemPairsPass());
+      break;
+    case OptimizationPass::LoopRotate:
+      addLoopPass(LoopRotatePass());
+      break;
+    case OptimizationPass::Licm:
+      addLoopPass(LICMPass());
+      loopPassesUseMemorySsa = true;
+      break;
+    case OptimizationPass::IndVarSimplify:
+      addLoopPass(IndVarSimplifyPass());
+      break;
+    case OptimizationPass::LoopIdiom:
+      addLoopPass(LoopIdiomRecognizePass());
+      break;
+    case OptimizationPass::LoopDeletion:
+      addLoopPass(LoopDeletionPass());
+      break;
+    case OptimizationPass::SimpleLoopUnroll:
+      addLoopPass(LoopFullUnrollPass(entry.param));
+      break;
+    }
+  }
+  flushFnPasses();
+}
+
+// =====================================================================================================================
+// Initializes the pass
+INITIALIZE_PASS(PatchNewPmOptimizer, DEBUG_TYPE, "Patch LLVM with optimizations run by the new pass manager", false,
+                false)
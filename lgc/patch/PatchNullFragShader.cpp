@@ -97,21 +97,32 @@ bool PatchNullFragShader::runOnModule(llvm::Module &module) {
 
   PipelineState *pipelineState = getAnalysis<PipelineStateWrapper>().getPipelineState(&module);
 
-  if (cl::DisableNullFragShader || pipelineState->getLgcContext()->buildingRelocatableElf()) {
+  if (cl::DisableNullFragShader) {
     // NOTE: If the option -disable-null-frag-shader is set to TRUE, we skip this pass. This is done by
     // standalone compiler.
     return false;
   }
 
-  const bool hasCs = pipelineState->hasShaderStage(ShaderStageCompute);
-  const bool hasVs = pipelineState->hasShaderStage(ShaderStageVertex);
-  const bool hasTes = pipelineState->hasShaderStage(ShaderStageTessEval);
-  const bool hasGs = pipelineState->hasShaderStage(ShaderStageGeometry);
-  const bool hasFs = pipelineState->hasShaderStage(ShaderStageFragment);
-  if (hasCs || hasFs || (!hasVs && !hasTes && !hasGs)) {
-    // This is an incomplete graphics pipeline from the amdllpc command-line tool, or a compute pipeline, or a
-    // graphics pipeline that already has a fragment shader. A null fragment shader is not required.
-    return false;
+  if (pipelineState->getLgcContext()->buildingRelocatableElf()) {
+    // When building relocatable ELF, the null fragment shader of a pipeline without one is built as a unit of its
+    // own: the stage mask has only the fragment stage, and the module has no shader in it yet.
+    if (pipelineState->getShaderStageMask() != shaderStageToMask(ShaderStageFragment))
+      return false;
+    for (const Function &func : module) {
+      if (!func.isDeclaration())
+        return false;
+    }
+  } else {
+    const bool hasCs = pipelineState->hasShaderStage(ShaderStageCompute);
+    const bool hasVs = pipelineState->hasShaderStage(ShaderStageVertex);
+    const bool hasTes = pipelineState->hasShaderStage(ShaderStageTessEval);
+    const bool hasGs = pipelineState->hasShaderStage(ShaderStageGeometry);
+    const bool hasFs = pipelineState->hasShaderStage(ShaderStageFragment);
+    if (hasCs || hasFs || (!hasVs && !hasTes && !hasGs)) {
+      // This is an incomplete graphics pipeline from the amdllpc command-line tool, or a compute pipeline, or a
+      // graphics pipeline that already has a fragment shader. A null fragment shader is not required.
+      return false;
+    }
   }
 
   // Create the null fragment shader:
@@ -83,6 +83,7 @@ bool PatchResourceCollect::runOnModule(Module &module) {
   LLVM_DEBUG(dbgs() << "Run the pass Patch-Resource-Collect\n");
 
   Patch::init(&module);
+  m_intrinsics.init(module);
   m_pipelineShaders = &getAnalysis<PipelineShaders>();
   m_pipelineState = getAnalysis<PipelineStateWrapper>().getPipelineState(&module);
 
@@ -1059,27 +1060,27 @@ void PatchResourceCollect::visitCallInst(CallInst &callInst) {
 
   bool isDeadCall = callInst.user_empty();
 
-  auto mangledName = callee->getName();
+  const LgcIntrinsic intrinsic = m_intrinsics.get(callee);
 
-  if (mangledName.startswith(lgcName::PushConstLoad) || mangledName.startswith(lgcName::DescriptorLoadSpillTable)) {
+  if (intrinsic == LgcIntrinsic::PushConstLoad || intrinsic == LgcIntrinsic::DescriptorLoadSpillTable) {
     // Push constant operations
     if (isDeadCall)
       m_deadCalls.insert(&callInst);
     else
       m_hasPushConstOp = true;
-  } else if (mangledName.startswith(lgcName::DescriptorLoadBuffer) ||
-             mangledName.startswith(lgcName::DescriptorGetTexelBufferPtr) ||
-             mangledName.startswith(lgcName::DescriptorGetResourcePtr) ||
-             mangledName.startswith(lgcName::DescriptorGetFmaskPtr) ||
-             mangledName.startswith(lgcName::DescriptorGetSamplerPtr)) {
+  } else if (intrinsic == LgcIntrinsic::DescriptorLoadBuffer ||
+             intrinsic == LgcIntrinsic::DescriptorGetTexelBufferPtr ||
+             intrinsic == LgcIntrinsic::DescriptorGetResourcePtr || intrinsic == LgcIntrinsic::DescriptorGetFmaskPtr ||
+             intrinsic == LgcIntrinsic::DescriptorGetSamplerPtr) {
     unsigned descSet = cast<ConstantInt>(callInst.getOperand(0))->getZExtValue();
     unsigned binding = cast<ConstantInt>(callInst.getOperand(1))->getZExtValue();
     DescriptorPair descPair = {descSet, binding};
     m_resUsage->descPairs.insert(descPair.u64All);
-  } else if (mangledName.startswith(lgcName::BufferLoad)) {
+  } else if (intrinsic == LgcIntrinsic::BufferLoad || intrinsic == LgcIntrinsic::BufferLoadUniform ||
+             intrinsic == LgcIntrinsic::BufferLoadScalarAligned) {
     if (isDeadCall)
       m_deadCalls.insert(&callInst);
-  } else if (mangledName.startswith(lgcName::InputImportGeneric)) {
+  } else if (intrinsic == LgcIntrinsic::InputImportGeneric) {
     // Generic input import
     if (isDeadCall)
       m_deadCalls.insert(&callInst);
@@ -1129,7 +1130,7 @@ void PatchResourceCollect::visitCallInst(CallInst &callInst) {
         }
       }
     }
-  } else if (mangledName.startswith(lgcName::InputImportInterpolant)) {
+  } else if (intrinsic == LgcIntrinsic::InputImportInterpolant) {
     // Interpolant input import
     assert(m_shaderStage == ShaderStageFragment);
 
@@ -1151,7 +1152,7 @@ void PatchResourceCollect::visitCallInst(CallInst &callInst) {
         m_hasDynIndexedInput = true;
       }
     }
-  } else if (mangledName.startswith(lgcName::InputImportBuiltIn)) {
+  } else if (intrinsic == LgcIntrinsic::InputImportBuiltIn) {
     // Built-in input import
     if (isDeadCall)
       m_deadCalls.insert(&callInst);
@@ -1159,7 +1160,7 @@ void PatchResourceCollect::visitCallInst(CallInst &callInst) {
       unsigned builtInId = cast<ConstantInt>(callInst.getOperand(0))->getZExtValue();
       m_activeInputBuiltIns.insert(builtInId);
     }
-  } else if (mangledName.startswith(lgcName::OutputImportGeneric)) {
+  } else if (intrinsic == LgcIntrinsic::OutputImportGeneric) {
     // Generic output import
     assert(m_shaderStage == ShaderStageTessControl);
 
@@ -1197,13 +1198,13 @@ void PatchResourceCollect::visitCallInst(CallInst &callInst) {
       // NOTE: If location offset is not constant, we treat this as dynamic indexing.
       m_hasDynIndexedOutput = true;
     }
-  } else if (mangledName.startswith(lgcName::OutputImportBuiltIn)) {
+  } else if (intrinsic == LgcIntrinsic::OutputImportBuiltIn) {
     // Built-in output import
     assert(m_shaderStage == ShaderStageTessControl);
 
     unsigned builtInId = cast<ConstantInt>(callInst.getOperand(0))->getZExtValue();
     m_importedOutputBuiltIns.insert(builtInId);
-  } else if (mangledName.startswith(lgcName::OutputExportGeneric)) {
+  } else if (intrinsic == LgcIntrinsic::OutputExportGeneric) {
     // Generic output export
     if (m_shaderStage == ShaderStageTessControl) {
       auto output = callInst.getOperand(callInst.getNumArgOperands() - 1);
@@ -1226,7 +1227,7 @@ void PatchResourceCollect::visitCallInst(CallInst &callInst) {
         m_hasDynIndexedOutput = true;
       }
     }
-  } else if (mangledName.startswith(lgcName::OutputExportBuiltIn)) {
+  } else if (intrinsic == LgcIntrinsic::OutputExportBuiltIn) {
     // NOTE: If output value is undefined one, we can safely drop it and remove the output export call.
     // Currently, do this for geometry shader.
     if (m_shaderStage == ShaderStageGeometry) {
@@ -1243,12 +1244,12 @@ void PatchResourceCollect::visitCallInst(CallInst &callInst) {
   if (canPackInOut()) {
     if (m_shaderStage == ShaderStageFragment && !isDeadCall) {
       // Collect LocationSpans according to each FS' input call
-      bool isInput = m_locationMapManager->addSpan(&callInst);
+      bool isInput = m_locationMapManager->addSpan(&callInst, intrinsic);
       if (isInput) {
         m_inOutCalls.push_back(&callInst);
         m_deadCalls.insert(&callInst);
       }
-    } else if (m_shaderStage == ShaderStageVertex && mangledName.startswith(lgcName::OutputExportGeneric)) {
+    } else if (m_shaderStage == ShaderStageVertex && intrinsic == LgcIntrinsic::OutputExportGeneric) {
       m_inOutCalls.push_back(&callInst);
       m_deadCalls.insert(&callInst);
     }
@@ -1559,7 +1560,10 @@ void PatchResourceCollect::matchGenericInOut() {
   auto &perPatchOutLocMap = inOutUsage.perPatchOutputLocMap;
 
   // Do input/output matching
-  if (!m_pipelineState->getLgcContext()->buildingRelocatableElf() && m_shaderStage != ShaderStageFragment) {
+  // NOTE: When building relocatable ELF, the fragment shader is compiled separately, so the next stage of the last
+  // pre-rasterization stage is invalid and its outputs are kept. The pre-rasterization stages are compiled together,
+  // so the outputs of the others are matched as usual.
+  if (m_shaderStage != ShaderStageFragment) {
     const auto nextStage = m_pipelineState->getNextShaderStage(m_shaderStage);
 
     // Do normal input/output matching
@@ -2725,11 +2729,10 @@ void PatchResourceCollect::scalarizeForInOutPacking(Module *module) {
   // First gather the input/output calls that need scalarizing.
   SmallVector<CallInst *, 4> vsOutputCalls;
   SmallVector<CallInst *, 4> fsInputCalls;
-  for (Function &func : *module) {
-    if (func.getName().startswith(lgcName::InputImportGeneric) ||
-        func.getName().startswith(lgcName::InputImportInterpolant)) {
+  for (LgcIntrinsic intrinsic : {LgcIntrinsic::InputImportGeneric, LgcIntrinsic::InputImportInterpolant}) {
+    for (Function *func : m_intrinsics.getDeclarations(intrinsic)) {
       // This is a generic (possibly interpolated) input. Find its uses in FS.
-      for (User *user : func.users()) {
+      for (User *user : func->users()) {
         auto call = cast<CallInst>(user);
         if (m_pipelineShaders->getShaderStage(call->getFunction()) != ShaderStageFragment)
           continue;
@@ -2737,18 +2740,19 @@ void PatchResourceCollect::scalarizeForInOutPacking(Module *module) {
         if (isa<VectorType>(call->getType()) || call->getType()->getPrimitiveSizeInBits() == 64)
           fsInputCalls.push_back(call);
       }
-    } else if (func.getName().startswith(lgcName::OutputExportGeneric)) {
-      // This is a generic output. Find its uses in the last vertex processing stage.
-      for (User *user : func.users()) {
-        auto call = cast<CallInst>(user);
-        if (m_pipelineShaders->getShaderStage(call->getFunction()) != m_pipelineState->getLastVertexProcessingStage())
-          continue;
-        // We have a use the last vertex processing stage. See if it needs scalarizing. The output value is
-        // always the final argument.
-        Type *valueTy = call->getArgOperand(call->getNumArgOperands() - 1)->getType();
-        if (isa<VectorType>(valueTy) || valueTy->getPrimitiveSizeInBits() == 64)
-          vsOutputCalls.push_back(call);
-      }
+    }
+  }
+  for (Function *func : m_intrinsics.getDeclarations(LgcIntrinsic::OutputExportGeneric)) {
+    // This is a generic output. Find its uses in the last vertex processing stage.
+    for (User *user : func->users()) {
+      auto call = cast<CallInst>(user);
+      if (m_pipelineShaders->getShaderStage(call->getFunction()) != m_pipelineState->getLastVertexProcessingStage())
+        continue;
+      // We have a use the last vertex processing stage. See if it needs scalarizing. The output value is
+      // always the final argument.
+      Type *valueTy = call->getArgOperand(call->getNumArgOperands() - 1)->getType();
+      if (isa<VectorType>(valueTy) || valueTy->getPrimitiveSizeInBits() == 64)
+        vsOutputCalls.push_back(call);
     }
   }
 
@@ -2915,11 +2919,11 @@ void PatchResourceCollect::scalarizeGenericOutput(CallInst *call) {
 // Fill the locationSpan container by constructing a LocationSpan from each input import call
 //
 // @param call : Call to process
-bool InOutLocationMapManager::addSpan(CallInst *call) {
+// @param intrinsic : ID of the called function
+bool InOutLocationMapManager::addSpan(CallInst *call, LgcIntrinsic intrinsic) {
   auto callee = call->getCalledFunction();
-  auto mangledName = callee->getName();
   bool isInput = false;
-  if (mangledName.startswith(lgcName::InputImportGeneric)) {
+  if (intrinsic == LgcIntrinsic::InputImportGeneric) {
     LocationSpan span = {};
 
     span.firstLocation.locationInfo.location = cast<ConstantInt>(call->getOperand(0))->getZExtValue();
@@ -2939,7 +2943,7 @@ bool InOutLocationMapManager::addSpan(CallInst *call) {
 
     isInput = true;
   }
-  if (mangledName.startswith(lgcName::InputImportInterpolant)) {
+  if (intrinsic == LgcIntrinsic::InputImportInterpolant) {
     auto locOffset = call->getOperand(1);
     assert(isa<ConstantInt>(locOffset));
 
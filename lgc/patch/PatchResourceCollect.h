@@ -33,6 +33,7 @@
 #include "lgc/patch/Patch.h"
 #include "lgc/state/PipelineShaders.h"
 #include "lgc/state/PipelineState.h"
+#include "lgc/util/IntrinsicRegistry.h"
 #include "llvm/IR/InstVisitor.h"
 #include <unordered_set>
 
@@ -100,6 +101,7 @@ private:
 
   PipelineShaders *m_pipelineShaders; // Pipeline shaders
   PipelineState *m_pipelineState;     // Pipeline state
+  IntrinsicRegistry m_intrinsics;     // IDs of the lgc.* internal calls in the module
 
   std::unordered_set<llvm::CallInst *> m_deadCalls; // Dead calls
 
@@ -158,7 +160,7 @@ class InOutLocationMapManager {
 public:
   InOutLocationMapManager() {}
 
-  bool addSpan(llvm::CallInst *call);
+  bool addSpan(llvm::CallInst *call, LgcIntrinsic intrinsic);
   void buildLocationMap();
 
   bool findMap(const InOutLocation &originalLocation, const InOutLocation *&newLocation);
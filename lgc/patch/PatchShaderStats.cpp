@@ -0,0 +1,341 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  PatchShaderStats.cpp
+ * @brief LLPC source file: contains implementation of class lgc::PatchShaderStats.
+ ***********************************************************************************************************************
+ */
+#include "PatchShaderStats.h"
+#include "AbiMetadata.h"
+#include "lgc/state/Abi.h"
+#include "lgc/state/IntrinsDefs.h"
+#include "llvm/Analysis/LegacyDivergenceAnalysis.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Support/Debug.h"
+
+#define DEBUG_TYPE "llpc-patch-shader-stats"
+
+using namespace llvm;
+using namespace lgc;
+
+// Version of the layout of the shader statistics
+static const unsigned ShaderStatsVersion = 1;
+
+// Assumed trip count of a loop, and the maximum loop depth it is applied to, for estimating cycles
+static const unsigned LoopTripCount = 8;
+static const unsigned MaxLoopDepth = 3;
+
+// Hardware stage names used in PAL metadata, by shader entry-point name
+static const std::pair<const char *, const char *> EntryHwStageNames[] = {
+    {Util::Abi::AmdGpuLsEntryName, ".ls"}, {Util::Abi::AmdGpuHsEntryName, ".hs"},
+    {Util::Abi::AmdGpuEsEntryName, ".es"}, {Util::Abi::AmdGpuGsEntryName, ".gs"},
+    {Util::Abi::AmdGpuVsEntryName, ".vs"}, {Util::Abi::AmdGpuPsEntryName, ".ps"},
+    {Util::Abi::AmdGpuCsEntryName, ".cs"},
+};
+
+// Unit an instruction is issued to
+enum class IssueUnit : unsigned {
+  Salu,         // Scalar ALU
+  Valu,         // Vector ALU
+  Trans,        // Vector ALU, transcendental
+  Smem,         // Scalar memory
+  VmemLoad,     // Vector memory load
+  VmemStore,    // Vector memory store or atomic
+  Sample,       // Sampler
+  Lds,          // LDS
+  Export,       // Export
+  Branch,       // Conditional branch
+  Count,        // Count of units
+  None = Count, // Not issued
+};
+
+// Statistic names and estimated issue cycles, in IssueUnit order. The cycles are those of a wave64 on GCN; only their
+// relative sizes matter.
+static const struct {
+  const char *name;
+  unsigned cycles;
+} IssueUnitInfos[] = {
+    {".salu", 1}, {".valu", 4}, {".trans", 16}, {".smem", 4}, {".vmem_load", 16}, {".vmem_store", 16},
+    {".sample", 32}, {".lds", 8}, {".export", 8}, {".branch", 4},
+};
+
+static_assert(sizeof(IssueUnitInfos) / sizeof(IssueUnitInfos[0]) == static_cast<unsigned>(IssueUnit::Count),
+              "mismatch");
+
+// =====================================================================================================================
+// Get the unit a call is issued to, from the name of the callee.
+//
+// @param call : Call instruction
+// @param divergence : Divergence analysis of the function
+static IssueUnit getCallIssueUnit(CallInst &call, LegacyDivergenceAnalysis &divergence) {
+  Function *callee = call.getCalledFunction();
+  if (!callee || !callee->isIntrinsic())
+    return IssueUnit::None;
+  if (isa<DbgInfoIntrinsic>(call) || callee->getIntrinsicID() == Intrinsic::assume ||
+      callee->getIntrinsicID() == Intrinsic::lifetime_start || callee->getIntrinsicID() == Intrinsic::lifetime_end)
+    return IssueUnit::None;
+
+  StringRef name = callee->getName();
+  if (name.startswith("llvm.amdgcn.image.sample") || name.startswith("llvm.amdgcn.image.gather4"))
+    return IssueUnit::Sample;
+  if (name.startswith("llvm.amdgcn.image.") || name.startswith("llvm.amdgcn.buffer.") ||
+      name.startswith("llvm.amdgcn.raw.") || name.startswith("llvm.amdgcn.struct.") ||
+      name.startswith("llvm.amdgcn.tbuffer."))
+    return call.mayWriteToMemory() ? IssueUnit::VmemStore : IssueUnit::VmemLoad;
+  if (name.startswith("llvm.amdgcn.s.buffer.load"))
+    return IssueUnit::Smem;
+  if (name.startswith("llvm.amdgcn.ds.") || name.startswith("llvm.amdgcn.interp.") ||
+      name.startswith("llvm.amdgcn.lds."))
+    return IssueUnit::Lds;
+  if (name.startswith("llvm.amdgcn.exp"))
+    return IssueUnit::Export;
+  if (name.startswith("llvm.sqrt.") || name.startswith("llvm.exp2.") || name.startswith("llvm.log2.") ||
+      name.startswith("llvm.sin.") || name.startswith("llvm.cos.") || name.startswith("llvm.amdgcn.rcp.") ||
+      name.startswith("llvm.amdgcn.rsq.") || name.startswith("llvm.amdgcn.sqrt."))
+    return IssueUnit::Trans;
+  return divergence.isDivergent(&call) ? IssueUnit::Valu : IssueUnit::Salu;
+}
+
+// =====================================================================================================================
+// Get the unit an instruction is issued to.
+//
+// @param inst : Instruction
+// @param divergence : Divergence analysis of the function
+static IssueUnit getIssueUnit(Instruction &inst, LegacyDivergenceAnalysis &divergence) {
+  if (isa<PHINode>(inst) || isa<BitCastInst>(inst) || isa<ReturnInst>(inst) || isa<UnreachableInst>(inst))
+    return IssueUnit::None;
+  if (auto branch = dyn_cast<BranchInst>(&inst))
+    return branch->isConditional() ? IssueUnit::Branch : IssueUnit::None;
+  if (isa<SwitchInst>(inst))
+    return IssueUnit::Branch;
+  if (auto call = dyn_cast<CallInst>(&inst))
+    return getCallIssueUnit(*call, divergence);
+
+  if (auto load = dyn_cast<LoadInst>(&inst)) {
+    unsigned addrSpace = load->getPointerAddressSpace();
+    if (addrSpace == ADDR_SPACE_LOCAL)
+      return IssueUnit::Lds;
+    if ((addrSpace == ADDR_SPACE_CONST || addrSpace == ADDR_SPACE_CONST_32BIT) &&
+        !divergence.isDivergent(load->getPointerOperand()))
+      return IssueUnit::Smem;
+    return IssueUnit::VmemLoad;
+  }
+  if (auto store = dyn_cast<StoreInst>(&inst))
+    return store->getPointerAddressSpace() == ADDR_SPACE_LOCAL ? IssueUnit::Lds : IssueUnit::VmemStore;
+  if (auto atomic = dyn_cast<AtomicRMWInst>(&inst))
+    return atomic->getPointerAddressSpace() == ADDR_SPACE_LOCAL ? IssueUnit::Lds : IssueUnit::VmemStore;
+  if (auto cmpXchg = dyn_cast<AtomicCmpXchgInst>(&inst))
+    return cmpXchg->getPointerAddressSpace() == ADDR_SPACE_LOCAL ? IssueUnit::Lds : IssueUnit::VmemStore;
+
+  if (inst.getOpcode() == Instruction::FDiv || inst.getOpcode() == Instruction::FRem)
+    return IssueUnit::Trans;
+  return divergence.isDivergent(&inst) ? IssueUnit::Valu : IssueUnit::Salu;
+}
+
+// =====================================================================================================================
+// Check whether a value is used by an instruction in the given function, directly or through constant expressions.
+//
+// @param value : Value to check
+// @param func : Function
+static bool isUsedInFunction(Value *value, Function *func) {
+  for (User *user : value->users()) {
+    if (auto inst = dyn_cast<Instruction>(user)) {
+      if (inst->getFunction() == func)
+        return true;
+    } else if (isa<ConstantExpr>(user) && isUsedInFunction(user, func))
+      return true;
+  }
+  return false;
+}
+
+namespace lgc {
+
+// =====================================================================================================================
+// Initializes static members.
+char PatchShaderStats::ID = 0;
+
+// =====================================================================================================================
+// Pass creator, creates the pass of LLVM patching operations of including shader statistics as a separate section in
+// the ELF.
+ModulePass *createPatchShaderStats() {
+  return new PatchShaderStats();
+}
+
+// =====================================================================================================================
+PatchShaderStats::PatchShaderStats() : Patch(ID) {
+}
+
+// =====================================================================================================================
+// Get the analysis usage of this pass.
+//
+// @param [out] analysisUsage : The analysis usage.
+void PatchShaderStats::getAnalysisUsage(AnalysisUsage &analysisUsage) const {
+  analysisUsage.addRequired<LegacyDivergenceAnalysis>();
+  analysisUsage.addRequired<LoopInfoWrapperPass>();
+  analysisUsage.setPreservesAll();
+}
+
+// =====================================================================================================================
+// Executes this patching pass on the specified LLVM module.
+//
+// This pass includes static statistics of each hardware shader stage as a separate section in the ELF binary, by
+// inserting a new global variable with explicit section.
+//
+// @param [in,out] module : LLVM module to be run on
+bool PatchShaderStats::runOnModule(Module &module) {
+  Patch::init(&module);
+
+  msgpack::Document document;
+  auto root = document.getRoot().getMap(true);
+  root[".version"] = document.getNode(ShaderStatsVersion);
+  auto hwStages = root[".hardware_stages"].getMap(true);
+
+  // Get the hardware stages from the PAL metadata that the ConfigBuilder has written into the module, for their LDS
+  // sizes.
+  msgpack::Document palDocument;
+  msgpack::DocNode palHwStages;
+  NamedMDNode *palMetadata = m_module->getNamedMetadata("amdgpu.pal.metadata.msgpack");
+  if (palMetadata && palMetadata->getNumOperands() != 0) {
+    auto blob = cast<MDString>(palMetadata->getOperand(0)->getOperand(0))->getString();
+    if (palDocument.readFromBlob(blob, false)) {
+      auto pipelines = palDocument.getRoot().getMap(true)[Util::Abi::PalCodeObjectMetadataKey::Pipelines];
+      if (pipelines.getKind() == msgpack::Type::Array && pipelines.getArray().size() != 0)
+        palHwStages = pipelines.getArray()[0].getMap(true)[Util::Abi::PipelineMetadataKey::HardwareStages];
+    }
+  }
+
+  for (const auto &entryHwStageName : EntryHwStageNames) {
+    Function *entryPoint = m_module->getFunction(entryHwStageName.first);
+    if (!entryPoint || entryPoint->isDeclaration())
+      continue;
+    msgpack::DocNode palHwStage;
+    if (palHwStages.getKind() == msgpack::Type::Map) {
+      auto it = palHwStages.getMap().find(StringRef(entryHwStageName.second));
+      if (it != palHwStages.getMap().end())
+        palHwStage = it->second;
+    }
+    collectShaderStats(*entryPoint, palHwStage, hwStages[entryHwStageName.second].getMap(true));
+  }
+
+  std::string blob;
+  document.writeToBlob(blob);
+
+  auto initializer = ConstantDataArray::getString(*m_context, blob, false);
+  auto global = new GlobalVariable(*m_module, initializer->getType(), true, GlobalValue::ExternalLinkage, initializer,
+                                   "shaderstats", nullptr, GlobalValue::NotThreadLocal, false);
+
+  std::string namePrefix = Util::Abi::AmdGpuCommentName;
+  global->setSection(namePrefix + "shaderstats");
+
+  return true;
+}
+
+// =====================================================================================================================
+// Collect the statistics of the shader entry-point of one hardware stage.
+//
+// @param func : Shader entry-point
+// @param palHwStage : PAL metadata of the hardware stage, or an empty node if there is none
+// @param [out] stats : Map to put the statistics in
+void PatchShaderStats::collectShaderStats(Function &func, msgpack::DocNode palHwStage, msgpack::MapDocNode stats) {
+  auto &divergence = getAnalysis<LegacyDivergenceAnalysis>(func);
+  auto &loopInfo = getAnalysis<LoopInfoWrapperPass>(func).getLoopInfo();
+
+  unsigned counts[static_cast<unsigned>(IssueUnit::Count)] = {};
+  unsigned instCount = 0;
+  uint64_t cycles = 0;
+  for (BasicBlock &block : func) {
+    // Assume each loop runs a fixed number of iterations.
+    uint64_t weight = 1;
+    for (unsigned depth = std::min(loopInfo.getLoopDepth(&block), MaxLoopDepth); depth != 0; --depth)
+      weight *= LoopTripCount;
+
+    for (Instruction &inst : block) {
+      IssueUnit unit = getIssueUnit(inst, divergence);
+      if (unit == IssueUnit::None)
+        continue;
+      ++instCount;
+      ++counts[static_cast<unsigned>(unit)];
+      cycles += IssueUnitInfos[static_cast<unsigned>(unit)].cycles * weight;
+    }
+  }
+
+  msgpack::Document &document = *stats.getDocument();
+  stats[".instructions"] = document.getNode(instCount);
+  for (unsigned unit = 0; unit != static_cast<unsigned>(IssueUnit::Count); ++unit)
+    stats[IssueUnitInfos[unit].name] = document.getNode(counts[unit]);
+
+  unsigned scalarCount = counts[static_cast<unsigned>(IssueUnit::Salu)];
+  unsigned aluCount = scalarCount + counts[static_cast<unsigned>(IssueUnit::Valu)] +
+                      counts[static_cast<unsigned>(IssueUnit::Trans)];
+  stats[".scalar_alu_percent"] = document.getNode(aluCount != 0 ? scalarCount * 100 / aluCount : 0);
+  stats[".estimated_cycles"] = document.getNode(cycles);
+  stats[".lds_size"] = document.getNode(getLdsSize(func, palHwStage));
+
+  LLVM_DEBUG(dbgs() << "Shader stats of " << func.getName() << ": " << instCount << " instructions, " << cycles
+                    << " estimated cycles\n");
+}
+
+// =====================================================================================================================
+// Get the size in bytes of the LDS allocated for a hardware stage.
+//
+// For the stages that LGC lays out LDS for itself (tessellation, on-chip GS and NGG), the ConfigBuilder sets the LDS
+// size in the PAL metadata of the hardware stage, and that is used. Those stages access LDS through the "lds"
+// variable, which covers the whole of the CU's LDS, so its size says nothing about the allocation. Otherwise, the
+// size is that of the other LDS variables the entry-point uses, such as compute shader shared variables.
+//
+// @param func : Shader entry-point
+// @param palHwStage : PAL metadata of the hardware stage, or an empty node if there is none
+unsigned PatchShaderStats::getLdsSize(Function &func, msgpack::DocNode palHwStage) const {
+  if (palHwStage.getKind() == msgpack::Type::Map) {
+    auto it = palHwStage.getMap().find(StringRef(Util::Abi::HardwareStageMetadataKey::LdsSize));
+    if (it != palHwStage.getMap().end() && it->second.getKind() == msgpack::Type::UInt)
+      return it->second.getUInt();
+  }
+
+  const DataLayout &dataLayout = m_module->getDataLayout();
+  unsigned ldsSize = 0;
+  for (GlobalVariable &global : m_module->globals()) {
+    if (global.getAddressSpace() == ADDR_SPACE_LOCAL && global.getName() != "lds" &&
+        isUsedInFunction(&global, &func))
+      ldsSize += dataLayout.getTypeAllocSize(global.getValueType());
+  }
+  return ldsSize;
+}
+
+} // namespace lgc
+
+// =====================================================================================================================
+// Initializes the pass of LLVM patching operations of including shader statistics as a separate section in the ELF.
+INITIALIZE_PASS_BEGIN(PatchShaderStats, DEBUG_TYPE, "Include shader statistics as a separate section in the ELF binary",
+                      false, false)
+INITIALIZE_PASS_DEPENDENCY(LegacyDivergenceAnalysis)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_END(PatchShaderStats, DEBUG_TYPE, "Include shader statistics as a separate section in the ELF binary",
+                    false, false)
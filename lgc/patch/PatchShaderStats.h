@@ -0,0 +1,69 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  PatchShaderStats.h
+ * @brief LLPC header file: contains declaration of class lgc::PatchShaderStats.
+ ***********************************************************************************************************************
+ */
+#pragma once
+
+#include "lgc/patch/Patch.h"
+#include "llvm/BinaryFormat/MsgPackDocument.h"
+
+namespace lgc {
+
+// =====================================================================================================================
+// Represents the pass of LLVM patching operations of including static shader statistics as a separate section in the
+// ELF binary.
+//
+// For each hardware shader stage, the pass counts the IR instructions, split by the unit that would execute them:
+// scalar or vector ALU (by divergence analysis), scalar memory, vector memory, sampler, LDS and export. The counts
+// are a proxy for the ISA: an IR instruction is not one machine instruction, and instructions such as
+// getelementptr, extractelement and insertvalue are counted as ALU, although they often generate no code. It weights
+// each instruction by a static cost model to estimate the cycles taken, assuming a fixed trip count for each loop,
+// and records the LDS size allocated. The statistics are written as a msgpack map keyed by hardware stage name, like
+// the PAL metadata, so tools can compare compile variants without running them.
+class PatchShaderStats : public Patch {
+public:
+  PatchShaderStats();
+
+  bool runOnModule(llvm::Module &module) override;
+
+  void getAnalysisUsage(llvm::AnalysisUsage &analysisUsage) const override;
+
+  // -----------------------------------------------------------------------------------------------------------------
+
+  static char ID; // ID of this pass
+
+private:
+  PatchShaderStats(const PatchShaderStats &) = delete;
+  PatchShaderStats &operator=(const PatchShaderStats &) = delete;
+
+  void collectShaderStats(llvm::Function &func, llvm::msgpack::DocNode palHwStage, llvm::msgpack::MapDocNode stats);
+  unsigned getLdsSize(llvm::Function &func, llvm::msgpack::DocNode palHwStage) const;
+};
+
+} // namespace lgc
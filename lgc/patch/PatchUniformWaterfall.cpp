@@ -0,0 +1,161 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  PatchUniformWaterfall.cpp
+ * @brief LLPC source file: contains implementation of class lgc::PatchUniformWaterfall.
+ ***********************************************************************************************************************
+ */
+#include "PatchUniformWaterfall.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/Analysis/LegacyDivergenceAnalysis.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/IntrinsicsAMDGPU.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Utils/Local.h"
+
+#define DEBUG_TYPE "llpc-patch-uniform-waterfall"
+
+using namespace lgc;
+using namespace llvm;
+
+// -remove-uniform-waterfall: Remove waterfall loops whose index divergence analysis proves uniform
+static cl::opt<bool> RemoveUniformWaterfall("remove-uniform-waterfall",
+                                            cl::desc("Remove waterfall loops whose index divergence analysis proves "
+                                                     "uniform"),
+                                            cl::init(true));
+
+namespace lgc {
+
+// =====================================================================================================================
+// Define static members (no initializer needed as LLVM only cares about the address of ID, never its value).
+char PatchUniformWaterfall::ID;
+
+// =====================================================================================================================
+// Pass creator, creates the pass of LLVM patching operations for removing uniform waterfall loops.
+ModulePass *createPatchUniformWaterfall() {
+  return new PatchUniformWaterfall();
+}
+
+// =====================================================================================================================
+PatchUniformWaterfall::PatchUniformWaterfall() : ModulePass(ID) {
+}
+
+// =====================================================================================================================
+// Get the analysis usage of this pass.
+//
+// @param [out] analysisUsage : The analysis usage.
+void PatchUniformWaterfall::getAnalysisUsage(AnalysisUsage &analysisUsage) const {
+  analysisUsage.addRequired<LegacyDivergenceAnalysis>();
+  analysisUsage.setPreservesCFG();
+}
+
+// =====================================================================================================================
+// Executes this LLVM pass on the specified LLVM module.
+//
+// @param [in,out] module : LLVM module to be run on
+bool PatchUniformWaterfall::runOnModule(Module &module) {
+  if (!RemoveUniformWaterfall)
+    return false;
+
+  LLVM_DEBUG(dbgs() << "Run the pass Patch-Uniform-Waterfall\n");
+
+  // Gather the waterfall loops by function from the uses of the llvm.amdgcn.waterfall.begin declarations. A module
+  // that does not declare it has no waterfall loops, and no divergence analysis is run.
+  MapVector<Function *, SmallVector<IntrinsicInst *, 4>> waterfallBegins;
+  for (Function &decl : module) {
+    if (!decl.isDeclaration() || decl.getIntrinsicID() != Intrinsic::amdgcn_waterfall_begin)
+      continue;
+    for (User *user : decl.users()) {
+      auto waterfallBegin = cast<IntrinsicInst>(user);
+      waterfallBegins[waterfallBegin->getFunction()].push_back(waterfallBegin);
+    }
+  }
+
+  bool changed = false;
+  for (auto &funcWaterfallBegins : waterfallBegins)
+    changed |= processFunction(*funcWaterfallBegins.first, funcWaterfallBegins.second);
+  return changed;
+}
+
+// =====================================================================================================================
+// Remove the waterfall loops in a function whose index is uniform.
+//
+// @param [in,out] function : Function containing the waterfall loops
+// @param waterfallBegins : The llvm.amdgcn.waterfall.begin calls in the function
+bool PatchUniformWaterfall::processFunction(Function &function, ArrayRef<IntrinsicInst *> waterfallBegins) {
+  // The divergence analysis is only valid until the IR changes, so collect the uniform waterfall loops before
+  // removing any.
+  auto &divergenceAnalysis = getAnalysis<LegacyDivergenceAnalysis>(function);
+  SmallVector<IntrinsicInst *, 4> uniformWaterfalls;
+  for (IntrinsicInst *waterfallBegin : waterfallBegins) {
+    if (!divergenceAnalysis.isDivergent(waterfallBegin->getArgOperand(0)))
+      uniformWaterfalls.push_back(waterfallBegin);
+  }
+
+  for (IntrinsicInst *waterfallBegin : uniformWaterfalls)
+    removeWaterfall(waterfallBegin);
+  return !uniformWaterfalls.empty();
+}
+
+// =====================================================================================================================
+// Remove a waterfall loop, given its llvm.amdgcn.waterfall.begin. As the index is uniform, the values that the loop
+// reads the first lane of are already uniform, and the loop would only ever iterate once.
+//
+// @param waterfallBegin : The llvm.amdgcn.waterfall.begin call
+void PatchUniformWaterfall::removeWaterfall(IntrinsicInst *waterfallBegin) {
+  LLVM_DEBUG(dbgs() << "Removing uniform waterfall: " << *waterfallBegin << "\n");
+
+  SmallVector<IntrinsicInst *, 4> waterfallUsers;
+  for (User *user : waterfallBegin->users())
+    waterfallUsers.push_back(cast<IntrinsicInst>(user));
+
+  for (IntrinsicInst *waterfallUser : waterfallUsers) {
+    // llvm.amdgcn.waterfall.readfirstlane, llvm.amdgcn.waterfall.last.use and llvm.amdgcn.waterfall.end all pass
+    // through their second operand.
+    assert(waterfallUser->getIntrinsicID() == Intrinsic::amdgcn_waterfall_readfirstlane ||
+           waterfallUser->getIntrinsicID() == Intrinsic::amdgcn_waterfall_last_use ||
+           waterfallUser->getIntrinsicID() == Intrinsic::amdgcn_waterfall_end);
+    waterfallUser->replaceAllUsesWith(waterfallUser->getArgOperand(1));
+    waterfallUser->eraseFromParent();
+  }
+
+  // Remove the waterfall.begin, and the code joining the indices into a struct if it is now dead.
+  Value *waterfallIndex = waterfallBegin->getArgOperand(0);
+  waterfallBegin->eraseFromParent();
+  RecursivelyDeleteTriviallyDeadInstructions(waterfallIndex);
+}
+
+} // namespace lgc
+
+// =====================================================================================================================
+// Initializes the pass of LLVM patching operations for removing uniform waterfall loops.
+INITIALIZE_PASS_BEGIN(PatchUniformWaterfall, DEBUG_TYPE, "Patch LLVM for removing uniform waterfall loops", false,
+                      false)
+INITIALIZE_PASS_DEPENDENCY(LegacyDivergenceAnalysis)
+INITIALIZE_PASS_END(PatchUniformWaterfall, DEBUG_TYPE, "Patch LLVM for removing uniform waterfall loops", false,
+                    false)
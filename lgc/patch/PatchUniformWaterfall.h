@@ -0,0 +1,71 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  PatchUniformWaterfall.h
+ * @brief LLPC header file: contains declaration of class lgc::PatchUniformWaterfall.
+ ***********************************************************************************************************************
+ */
+#pragma once
+
+#include "lgc/patch/Patch.h"
+
+namespace llvm {
+
+class IntrinsicInst;
+
+} // namespace llvm
+
+namespace lgc {
+
+// =====================================================================================================================
+// Represents the pass of LLVM patching operations for removing waterfall loops whose index is uniform.
+//
+// The Builder puts an image operation in a waterfall loop when its descriptor index is marked non-uniform. That
+// marking only says that the index may be divergent. Where divergence analysis proves the index uniform, the loop
+// is removed, so the descriptor is loaded once on the scalar unit and the operation is done once.
+//
+// This is a module pass, so divergence analysis is only run on the functions that contain a waterfall loop, rather
+// than being required for every function.
+class PatchUniformWaterfall final : public llvm::ModulePass {
+public:
+  explicit PatchUniformWaterfall();
+
+  void getAnalysisUsage(llvm::AnalysisUsage &analysisUsage) const override;
+  bool runOnModule(llvm::Module &module) override;
+
+  // -----------------------------------------------------------------------------------------------------------------
+
+  static char ID; // ID of this pass
+
+private:
+  PatchUniformWaterfall(const PatchUniformWaterfall &) = delete;
+  PatchUniformWaterfall &operator=(const PatchUniformWaterfall &) = delete;
+
+  bool processFunction(llvm::Function &function, llvm::ArrayRef<llvm::IntrinsicInst *> waterfallBegins);
+  void removeWaterfall(llvm::IntrinsicInst *waterfallBegin);
+};
+
+} // namespace lgc
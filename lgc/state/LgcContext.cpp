@@ -184,6 +184,13 @@ Builder *LgcContext::createBuilder(Pipeline *pipeline, bool useBuilderRecorder)
 //
 // @param [in/out] passMgr : Pass manager
 void LgcContext::preparePassManager(legacy::PassManager *passMgr) {
+  auto targetLibInfoPass = new TargetLibraryInfoWrapperPass(getTargetLibraryInfo());
+  passMgr->add(targetLibInfoPass);
+}
+
+// =====================================================================================================================
+// Get the target library info that preparePassManager adds, for use with the new pass manager.
+TargetLibraryInfoImpl LgcContext::getTargetLibraryInfo() {
   TargetLibraryInfoImpl targetLibInfo(getTargetMachine()->getTargetTriple());
 
   // Adjust it to allow memcpy and memset.
@@ -200,8 +207,14 @@ void LgcContext::preparePassManager(legacy::PassManager *passMgr) {
   targetLibInfo.setUnavailable(LibFunc_tanf);
   targetLibInfo.setUnavailable(LibFunc_tanl);
 
-  auto targetLibInfoPass = new TargetLibraryInfoWrapperPass(targetLibInfo);
-  passMgr->add(targetLibInfoPass);
+  return targetLibInfo;
+}
+
+// =====================================================================================================================
+// Returns true if the target passes emit an ELF object, rather than IR or assembly text, that is, if none of the
+// "-emit-llvm", "-emit-llvm-bc" and "-filetype=asm" options is used.
+bool LgcContext::isEmittingElf() {
+  return !EmitLlvm && !EmitLlvmBc && codegen::getFileType() == CGFT_ObjectFile;
 }
 
 // =====================================================================================================================
@@ -210,7 +223,9 @@ void LgcContext::preparePassManager(legacy::PassManager *passMgr) {
 // @param [in/out] passMgr : pass manager to add passes to
 // @param codeGenTimer : Timer to time target passes with, nullptr if not timing
 // @param [out] outStream : Output stream
-void LgcContext::addTargetPasses(lgc::PassManager &passMgr, Timer *codeGenTimer, raw_pwrite_stream &outStream) {
+// @param fastCompile : Whether to use the fast compile tier, i.e. fast instruction selection and register allocation
+void LgcContext::addTargetPasses(lgc::PassManager &passMgr, Timer *codeGenTimer, raw_pwrite_stream &outStream,
+                                 bool fastCompile) {
   // Start timer for codegen passes.
   if (codeGenTimer)
     passMgr.add(createStartStopTimer(codeGenTimer, true));
@@ -246,8 +261,17 @@ void LgcContext::addTargetPasses(lgc::PassManager &passMgr, Timer *codeGenTimer,
   // CLANG. So we avoid the warning by referencing it here.
   (void(&codegen::InitTargetOptionsFromCodeGenFlags)); // unused
 
+  // The codegen opt level selects the instruction selector and register allocator. CodeGenOpt::None gives the fast
+  // ones, and skips most machine-level optimizations. The target machine is shared by all compiles in this context,
+  // so set it every time.
+  getTargetMachine()->setOptLevel(fastCompile ? CodeGenOpt::None : CodeGenOpt::Default);
+
+  // The codegen passes are measured as one group, as the marker passes used to measure a single pass would split up
+  // the machine function passes.
+  passMgr.beginPassGroup("Code generation");
   if (getTargetMachine()->addPassesToEmitFile(passMgr, outStream, nullptr, codegen::getFileType()))
     report_fatal_error("Target machine cannot emit a file of this type");
+  passMgr.endPassGroup();
 
   // Stop timer for codegen passes.
   if (codeGenTimer)
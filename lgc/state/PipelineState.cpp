@@ -35,15 +35,25 @@
 #include "lgc/patch/Patch.h"
 #include "lgc/state/TargetInfo.h"
 #include "lgc/util/Internal.h"
+#include "lgc/Trace.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/DiagnosticPrinter.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/IRPrintingPasses.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Linker/Linker.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include <exception>
+#include <thread>
+#include <type_traits>
 
 #define DEBUG_TYPE "llpc-pipeline-state"
 
@@ -65,9 +75,155 @@ static const char RsStateMetadataName[] = "llpc.rasterizer.state";
 static const char ColorExportFormatsMetadataName[] = "llpc.color.export.formats";
 static const char ColorExportStateMetadataName[] = "llpc.color.export.state";
 
+// Name of the named metadata node for the binary encoding of pipeline state, and the version of that encoding.
+// Bump the version whenever the layout written by PipelineState::recordBlob changes other than by a struct, or the
+// field list of visitShaderOptionsFields, growing at the end.
+static const char StateBlobMetadataName[] = "llpc.pipeline.state";
+static const unsigned StateBlobVersion = 2;
+
 namespace lgc {
 // Create BuilderReplayer pass
 ModulePass *createBuilderReplayer(Pipeline *pipeline);
+
+// =====================================================================================================================
+// Writer of the binary encoding of pipeline state: an array of dwords. A struct is written as its size in dwords
+// followed by its contents, so a reader built with a different version of the struct can zero-fill or skip the
+// difference.
+class StateBlobWriter {
+public:
+  // Write a single dword
+  void writeInt(unsigned value) { m_data.push_back(value); }
+
+  // Write a struct with its size. This copies the object representation, so it is only for structs made of dword
+  // fields, such as the state structs in Pipeline.h. A struct with padding, whose contents would not be
+  // deterministic, is written field by field with beginStruct, writeField and endStruct instead.
+  template <typename T> void write(const T &value) {
+    static_assert(sizeof(T) % sizeof(unsigned) == 0, "Struct size must be a multiple of a dword");
+#if defined(__GNUC__) || defined(_MSC_VER)
+    static_assert(__has_unique_object_representations(T), "Struct must not have padding");
+#endif
+    ArrayRef<unsigned> values(reinterpret_cast<const unsigned *>(&value), sizeof(value) / sizeof(unsigned));
+    writeInt(values.size());
+    m_data.append(values.begin(), values.end());
+  }
+
+  // Start a struct written field by field. Returns the value to pass to endStruct.
+  unsigned beginStruct() {
+    writeInt(0);
+    return m_data.size();
+  }
+
+  // Write one field of a struct written field by field
+  void writeField(unsigned value) { writeInt(value); }
+  void writeField(bool value) { writeInt(value); }
+  void writeField(uint64_t value) {
+    writeInt(static_cast<unsigned>(value));
+    writeInt(static_cast<unsigned>(value >> 32));
+  }
+  template <typename T> typename std::enable_if<std::is_enum<T>::value>::type writeField(T value) {
+    writeInt(static_cast<unsigned>(value));
+  }
+
+  // End a struct written field by field, filling in its size
+  void endStruct(unsigned start) { m_data[start - 1] = m_data.size() - start; }
+
+  ArrayRef<unsigned> getData() const { return m_data; }
+
+private:
+  SmallVector<unsigned, 256> m_data; // Encoded dwords
+};
+
+// =====================================================================================================================
+// Reader of the binary encoding of pipeline state written by StateBlobWriter. Reading past the end yields zeros and
+// sets the error flag.
+class StateBlobReader {
+public:
+  StateBlobReader(ArrayRef<unsigned> data) : m_data(data) {}
+
+  // Read a single dword
+  unsigned readInt() {
+    if (m_data.empty()) {
+      m_error = true;
+      return 0;
+    }
+    unsigned value = m_data.front();
+    m_data = m_data.drop_front();
+    return value;
+  }
+
+  // Read a struct written with its size into a zero-initialized value
+  template <typename T> void read(T &value) {
+    MutableArrayRef<unsigned> values(reinterpret_cast<unsigned *>(&value), sizeof(value) / sizeof(unsigned));
+    unsigned count = readInt();
+    for (unsigned index = 0; index != count; ++index) {
+      unsigned dword = readInt();
+      if (index < values.size())
+        values[index] = dword;
+    }
+  }
+
+  // Start reading a struct written field by field
+  void beginStruct() { m_structDwords = readInt(); }
+
+  // Read one field of a struct written field by field. A field that the writer did not know about reads as zero.
+  void readField(unsigned &value) { value = readFieldDword(); }
+  void readField(bool &value) { value = readFieldDword() != 0; }
+  void readField(uint64_t &value) {
+    value = readFieldDword();
+    value |= uint64_t(readFieldDword()) << 32;
+  }
+  template <typename T> typename std::enable_if<std::is_enum<T>::value>::type readField(T &value) {
+    value = static_cast<T>(readFieldDword());
+  }
+
+  // End reading a struct written field by field, skipping fields that this reader does not know about
+  void endStruct() {
+    for (; m_structDwords != 0; --m_structDwords)
+      readInt();
+  }
+
+  bool hasError() const { return m_error; }
+
+private:
+  unsigned readFieldDword() {
+    if (m_structDwords == 0)
+      return 0;
+    --m_structDwords;
+    return readInt();
+  }
+
+  ArrayRef<unsigned> m_data;   // Dwords not yet read
+  unsigned m_structDwords = 0; // Dwords left in the struct being read field by field
+  bool m_error = false;        // Whether a read went past the end
+};
+
+// =====================================================================================================================
+// Call a visitor on each field of ShaderOptions, in the order they are encoded in the state blob. ShaderOptions has
+// bool fields, so it has padding, and is written field by field. New fields go at the end of this list.
+//
+// @param shaderOptions : Shader options, const for writing
+// @param visit : Visitor to call on each field
+template <typename ShaderOptionsT, typename Visitor>
+static void visitShaderOptionsFields(ShaderOptionsT &shaderOptions, Visitor visit) {
+  visit(shaderOptions.hash[0]);
+  visit(shaderOptions.hash[1]);
+  visit(shaderOptions.trapPresent);
+  visit(shaderOptions.debugMode);
+  visit(shaderOptions.allowReZ);
+  visit(shaderOptions.vgprLimit);
+  visit(shaderOptions.sgprLimit);
+  visit(shaderOptions.maxThreadGroupsPerComputeUnit);
+  visit(shaderOptions.waveSize);
+  visit(shaderOptions.subgroupSize);
+  visit(shaderOptions.wgpMode);
+  visit(shaderOptions.waveBreakSize);
+  visit(shaderOptions.loadScalarizerThreshold);
+  visit(shaderOptions.useSiScheduler);
+  visit(shaderOptions.updateDescInElf);
+  visit(shaderOptions.unrollThreshold);
+  visit(shaderOptions.loadScalarizerCostModel);
+}
+
 } // namespace lgc
 
 // =====================================================================================================================
@@ -176,7 +332,8 @@ Module *PipelineState::link(ArrayRef<Module *> modules) {
 // @param checkShaderCacheFunc : Function to check shader cache in graphics pipeline
 // @param timers : Timers for: patch passes, llvm optimizations, codegen
 void PipelineState::generate(std::unique_ptr<Module> pipelineModule, raw_pwrite_stream &outStream,
-                             Pipeline::CheckShaderCacheFunc checkShaderCacheFunc, ArrayRef<Timer *> timers) {
+                             Pipeline::CheckShaderCacheFunc checkShaderCacheFunc, ArrayRef<Timer *> timers,
+                             raw_pwrite_stream *fragmentOutStream) {
   unsigned passIndex = 1000;
   Timer *patchTimer = timers.size() >= 1 ? timers[0] : nullptr;
   Timer *optTimer = timers.size() >= 2 ? timers[1] : nullptr;
@@ -229,15 +386,229 @@ void PipelineState::generate(std::unique_ptr<Module> pipelineModule, raw_pwrite_
   if (m_emitLgc)
     return;
 
+  // In parallel code generation mode, split the fragment shader out of the pipeline module, and generate code for it
+  // on another thread.
+  // NOTE: The split is skipped if IR or assembly text is being output, or if LLPC_OUTS is enabled, as the dump of the
+  // final pipeline module would be split up and interleaved between the threads.
+  std::string fragmentBitcode;
+  unsigned fragmentPassIndex = passIndex;
+  std::shared_ptr<PassStatsTable> fragmentPassStats;
+  std::string fragmentError;
+#if __cpp_exceptions
+  std::exception_ptr fragmentException;
+#endif
+  std::thread fragmentCodeGenThread;
+  // Join the thread on every way out of this function, including an exception thrown by a fatal error handler, as
+  // destroying a joinable std::thread terminates the process.
+  struct ThreadJoiner {
+    ~ThreadJoiner() {
+      if (thread.joinable())
+        thread.join();
+    }
+    std::thread &thread;
+  } fragmentCodeGenJoiner{fragmentCodeGenThread};
+
+  if (fragmentOutStream && LgcContext::isEmittingElf() && !LgcContext::getLgcOuts()) {
+    if (std::unique_ptr<Module> fragmentModule = splitFragmentModule(*pipelineModule)) {
+      // The fragment module is passed to the thread as bitcode, as it needs its own LLVMContext.
+      raw_string_ostream bitcodeStream(fragmentBitcode);
+      WriteBitcodeToFile(*fragmentModule, bitcodeStream);
+      bitcodeStream.flush();
+      fragmentModule.reset();
+
+      LgcContext *lgcContext = getLgcContext();
+      std::string gpuName = lgcContext->getTargetMachine()->getTargetCPU().str();
+      unsigned palAbiVersion = lgcContext->getPalAbiVersion();
+      bool fastCompile = getOptions().fastCompile;
+      fragmentCodeGenThread = std::thread([&, fragmentOutStream, gpuName, palAbiVersion, fastCompile]() {
+        // An error cannot propagate out of this thread, so it is recorded here and raised again on the compiling
+        // thread once this one has been joined.
+#if __cpp_exceptions
+        try
+#endif
+        {
+          generateFragmentModule(fragmentBitcode, gpuName, palAbiVersion, fastCompile, &fragmentPassIndex,
+                                 *fragmentOutStream, fragmentError);
+        }
+#if __cpp_exceptions
+        catch (...) {
+          fragmentException = std::current_exception();
+        }
+#endif
+        // The per-pass statistics are gathered per thread, so hand those of this thread to the compiling thread.
+        if (PassManager::isPassStatsEnabled())
+          fragmentPassStats = PassManager::takeThreadPassStats();
+      });
+    }
+  }
+
   // A separate "whole pipeline" pass manager for code generation.
   std::unique_ptr<PassManager> codeGenPassMgr(PassManager::Create());
   codeGenPassMgr->setPassIndex(&passIndex);
 
   // Code generation.
-  getLgcContext()->addTargetPasses(*codeGenPassMgr, codeGenTimer, outStream);
+  getLgcContext()->addTargetPasses(*codeGenPassMgr, codeGenTimer, outStream, getOptions().fastCompile);
 
   // Run the target backend codegen passes.
   codeGenPassMgr->run(*pipelineModule);
+
+  if (fragmentCodeGenThread.joinable()) {
+    fragmentCodeGenThread.join();
+    PassManager::mergeThreadPassStats(fragmentPassStats);
+#if __cpp_exceptions
+    if (fragmentException)
+      std::rethrow_exception(fragmentException);
+#endif
+    if (!fragmentError.empty())
+      report_fatal_error(Twine("Fragment shader code generation failed: ") + fragmentError);
+  }
+}
+
+// =====================================================================================================================
+// Remove functions and global variables that are no longer used, after an entry-point has been removed from a module.
+//
+// @param [in/out] module : Module to clean up
+static void removeUnusedGlobals(Module &module) {
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto funcIt = module.begin(); funcIt != module.end();) {
+      Function &func = *funcIt++;
+      func.removeDeadConstantUsers();
+      if (func.use_empty() && !func.isIntrinsic() && (func.isDeclaration() || func.hasLocalLinkage())) {
+        func.eraseFromParent();
+        changed = true;
+      }
+    }
+    for (auto globalIt = module.global_begin(); globalIt != module.global_end();) {
+      GlobalVariable &global = *globalIt++;
+      global.removeDeadConstantUsers();
+      if (global.use_empty() && (global.isDeclaration() || global.hasLocalLinkage())) {
+        global.eraseFromParent();
+        changed = true;
+      }
+    }
+  }
+}
+
+// =====================================================================================================================
+// Split the fragment shader out of the patched pipeline module into a module of its own, for parallel code
+// generation. The split is only done if the pipeline has both a fragment shader and other hardware stages, and no
+// constant data is used outside the fragment shader, as constant data is placed after the code of the last shader,
+// and the front-end ELF merge only keeps that of the fragment shader.
+// Returns the fragment shader module, or nullptr if the pipeline module was not split.
+//
+// @param [in/out] pipelineModule : Patched pipeline module; the fragment shader is removed from it if it is split
+std::unique_ptr<Module> PipelineState::splitFragmentModule(Module &pipelineModule) {
+  Function *psEntry = nullptr;
+  bool hasOtherEntry = false;
+  for (Function &func : pipelineModule) {
+    if (func.isDeclaration() || func.hasLocalLinkage())
+      continue;
+    if (func.getCallingConv() == CallingConv::AMDGPU_PS)
+      psEntry = &func;
+    else
+      hasOtherEntry = true;
+  }
+  if (!psEntry || !hasOtherEntry)
+    return nullptr;
+
+  // Gather the functions called (directly or indirectly) from the fragment shader entry-point.
+  SmallPtrSet<const Function *, 8> fragmentFuncs;
+  SmallVector<const Function *, 8> worklist;
+  fragmentFuncs.insert(psEntry);
+  worklist.push_back(psEntry);
+  while (!worklist.empty()) {
+    const Function *func = worklist.pop_back_val();
+    for (const Instruction &inst : instructions(func)) {
+      if (auto call = dyn_cast<CallBase>(&inst)) {
+        const Function *callee = call->getCalledFunction();
+        if (callee && !callee->isDeclaration() && fragmentFuncs.insert(callee).second)
+          worklist.push_back(callee);
+      }
+    }
+  }
+
+  // Check that constant data is used only by the fragment shader.
+  for (const GlobalVariable &global : pipelineModule.globals()) {
+    if (!global.isConstant())
+      continue;
+    SmallVector<const Value *, 4> vals;
+    vals.push_back(&global);
+    for (unsigned i = 0; i != vals.size(); ++i) {
+      for (const User *user : vals[i]->users()) {
+        if (isa<Constant>(user)) {
+          vals.push_back(user);
+          continue;
+        }
+        if (!fragmentFuncs.count(cast<Instruction>(user)->getFunction()))
+          return nullptr;
+      }
+    }
+  }
+
+  // Clone the fragment shader functions into a new module, then remove the fragment shader entry-point from the
+  // pipeline module.
+  ValueToValueMapTy valueMap;
+  std::unique_ptr<Module> fragmentModule = CloneModule(pipelineModule, valueMap, [&](const GlobalValue *globalValue) {
+    auto func = dyn_cast<Function>(globalValue);
+    return !func || fragmentFuncs.count(func);
+  });
+  removeUnusedGlobals(*fragmentModule);
+
+  psEntry->eraseFromParent();
+  removeUnusedGlobals(pipelineModule);
+  return fragmentModule;
+}
+
+// =====================================================================================================================
+// Run code generation on the fragment shader module split out of the pipeline module, on a thread of its own. The
+// module is passed as bitcode and read into an LLVMContext and LgcContext of its own, as a context cannot be used by
+// more than one thread.
+//
+// @param bitcode : Bitcode of the fragment shader module
+// @param gpuName : LLVM GPU name
+// @param palAbiVersion : PAL pipeline ABI version to compile for
+// @param fastCompile : Whether to use the fast compile tier
+// @param [in/out] passIndex : Pass index for the code generation passes
+// @param [out] outStream : Stream to write the ELF to
+// @param [out] errorMessage : Description of the error, if code generation fails
+// @returns : True on success
+bool PipelineState::generateFragmentModule(StringRef bitcode, StringRef gpuName, unsigned palAbiVersion,
+                                           bool fastCompile, unsigned *passIndex, raw_pwrite_stream &outStream,
+                                           std::string &errorMessage) {
+  // Diagnostic handler that records backend errors rather than exiting, as this runs on a thread of its own.
+  class FragmentDiagnosticHandler : public DiagnosticHandler {
+  public:
+    FragmentDiagnosticHandler(std::string &errorMessage) : m_errorMessage(errorMessage) {}
+    bool handleDiagnostics(const DiagnosticInfo &diagInfo) override {
+      if (diagInfo.getSeverity() == DS_Error && m_errorMessage.empty()) {
+        raw_string_ostream errorStream(m_errorMessage);
+        DiagnosticPrinterRawOStream printer(errorStream);
+        diagInfo.print(printer);
+      }
+      return true;
+    }
+
+  private:
+    std::string &m_errorMessage;
+  };
+
+  TraceScope traceScope("FragmentCodeGen");
+  LLVMContext context;
+  context.setDiagnosticHandler(std::make_unique<FragmentDiagnosticHandler>(errorMessage));
+  Expected<std::unique_ptr<Module>> module = parseBitcodeFile(MemoryBufferRef(bitcode, "llpcFragment"), context);
+  if (!module) {
+    errorMessage = toString(module.takeError());
+    return false;
+  }
+
+  std::unique_ptr<LgcContext> lgcContext(LgcContext::Create(context, gpuName, palAbiVersion));
+  std::unique_ptr<PassManager> codeGenPassMgr(PassManager::Create());
+  codeGenPassMgr->setPassIndex(passIndex);
+  lgcContext->addTargetPasses(*codeGenPassMgr, nullptr, outStream, fastCompile);
+  codeGenPassMgr->run(**module);
+  return errorMessage.empty();
 }
 
 // =====================================================================================================================
@@ -248,6 +619,7 @@ void PipelineState::clear(Module *module) {
   getShaderModes()->clear();
   m_options = {};
   m_userDataNodes = {};
+  invalidateResourceNodeIndex();
   m_deviceIndex = 0;
   m_vertexInputDescriptions.clear();
   m_colorExportFormats.clear();
@@ -255,15 +627,33 @@ void PipelineState::clear(Module *module) {
   m_inputAssemblyState = {};
   m_viewportState = {};
   m_rasterizerState = {};
-  record(module);
+  getShaderModes()->record(module);
+  recordMetadata(module);
+  if (auto blobMetaNode = module->getNamedMetadata(StateBlobMetadataName))
+    module->eraseNamedMetadata(blobMetaNode);
 }
 
 // =====================================================================================================================
 // Record pipeline state into IR metadata of specified module.
 //
+// Shader modes are always recorded as named metadata, as they are also read per shader when linking. The rest of
+// the state is recorded as a single binary blob, unless -emit-lgc is on, in which case it is recorded as readable
+// named metadata.
+//
 // @param [in/out] module : Module to record the IR metadata in
 void PipelineState::record(Module *module) {
   getShaderModes()->record(module);
+  if (m_emitLgc)
+    recordMetadata(module);
+  else
+    recordBlob(module);
+}
+
+// =====================================================================================================================
+// Record pipeline state other than shader modes as named metadata nodes that are arrays of i32.
+//
+// @param [in/out] module : Module to record the IR metadata in
+void PipelineState::recordMetadata(Module *module) {
   recordOptions(module);
   recordUserDataNodes(module);
   recordDeviceIndex(module);
@@ -279,6 +669,8 @@ void PipelineState::record(Module *module) {
 void PipelineState::readState(Module *module) {
   getShaderModes()->readModesFromPipeline(module);
   readShaderStageMask(module);
+  if (readBlob(module))
+    return;
   readOptions(module);
   readUserDataNodes(module);
   readDeviceIndex(module);
@@ -287,6 +679,220 @@ void PipelineState::readState(Module *module) {
   readGraphicsState(module);
 }
 
+// =====================================================================================================================
+// Record pipeline state other than shader modes as a binary blob: a named metadata node whose single operand is a
+// constant array of i32. That takes a handful of IR objects, where recording it as named metadata takes a uniqued
+// MDNode and a ConstantInt for each dword.
+//
+// The blob is: the version, options, per-shader options, device index, vertex input descriptions, color export
+// formats and state, input-assembly, viewport and rasterizer state, then the user data nodes.
+//
+// @param [in/out] module : Module to record the IR metadata in
+void PipelineState::recordBlob(Module *module) {
+  StateBlobWriter writer;
+  writer.writeInt(StateBlobVersion);
+  writer.write(m_options);
+  writer.writeInt(m_shaderOptions.size());
+  for (const ShaderOptions &shaderOptions : m_shaderOptions) {
+    unsigned start = writer.beginStruct();
+    visitShaderOptionsFields(shaderOptions, [&writer](auto field) { writer.writeField(field); });
+    writer.endStruct(start);
+  }
+  writer.writeInt(m_deviceIndex);
+  writer.writeInt(m_vertexInputDescriptions.size());
+  for (const VertexInputDescription &input : m_vertexInputDescriptions)
+    writer.write(input);
+  writer.writeInt(m_colorExportFormats.size());
+  for (const ColorExportFormat &target : m_colorExportFormats)
+    writer.write(target);
+  writer.write(m_colorExportState);
+  writer.write(m_inputAssemblyState);
+  writer.write(m_viewportState);
+  writer.write(m_rasterizerState);
+
+  // User data nodes: the total node count including inner tables, so the reader can allocate them in one go, then
+  // the top-level table.
+  unsigned nodeCount = m_userDataNodes.size();
+  for (const ResourceNode &node : m_userDataNodes) {
+    if (node.type == ResourceNodeType::DescriptorTableVaPtr)
+      nodeCount += node.innerTable.size();
+  }
+  writer.writeInt(nodeCount);
+  writer.writeInt(m_userDataNodes.size());
+  recordUserDataTableToBlob(m_userDataNodes, writer);
+
+  Constant *blob = ConstantDataArray::get(getContext(), writer.getData());
+  auto blobMetaNode = module->getOrInsertNamedMetadata(StateBlobMetadataName);
+  blobMetaNode->clearOperands();
+  blobMetaNode->addOperand(MDNode::get(getContext(), ConstantAsMetadata::get(blob)));
+}
+
+// =====================================================================================================================
+// Write one table of user data nodes into the binary blob, calling itself recursively for inner tables.
+//
+// @param nodes : Table of user data nodes
+// @param [in/out] writer : Blob writer
+void PipelineState::recordUserDataTableToBlob(ArrayRef<ResourceNode> nodes, StateBlobWriter &writer) {
+  for (const ResourceNode &node : nodes) {
+    writer.writeInt(static_cast<unsigned>(node.type));
+    writer.writeInt(node.offsetInDwords);
+    writer.writeInt(node.sizeInDwords);
+
+    switch (node.type) {
+    case ResourceNodeType::DescriptorTableVaPtr:
+      writer.writeInt(node.innerTable.size());
+      recordUserDataTableToBlob(node.innerTable, writer);
+      break;
+    case ResourceNodeType::IndirectUserDataVaPtr:
+    case ResourceNodeType::StreamOutTableVaPtr:
+      writer.writeInt(node.indirectSizeInDwords);
+      break;
+    default: {
+      writer.writeInt(node.set);
+      writer.writeInt(node.binding);
+      // The immutable descriptor constant, if any, as its element count then the i32 components of each sampler
+      // (<4 x i32>) or converting sampler (<8 x i32>) descriptor.
+      if (!node.immutableValue) {
+        writer.writeInt(0);
+        break;
+      }
+      unsigned samplerDescriptorSize = 4;
+      if (node.type == ResourceNodeType::DescriptorYCbCrSampler)
+        samplerDescriptorSize = 8;
+      unsigned elemCount = node.immutableValue->getType()->getArrayNumElements();
+      writer.writeInt(elemCount);
+      for (unsigned elemIdx = 0; elemIdx != elemCount; ++elemIdx) {
+        Constant *vectorValue = node.immutableValue->getAggregateElement(elemIdx);
+        for (unsigned compIdx = 0; compIdx != samplerDescriptorSize; ++compIdx)
+          writer.writeInt(cast<ConstantInt>(vectorValue->getAggregateElement(compIdx))->getZExtValue());
+      }
+      break;
+    }
+    }
+  }
+}
+
+// =====================================================================================================================
+// Read pipeline state other than shader modes from the binary blob, if there is one.
+// Returns false if the module has no blob, in which case the state is read from named metadata instead.
+//
+// @param module : LLVM module
+bool PipelineState::readBlob(Module *module) {
+  auto blobMetaNode = module->getNamedMetadata(StateBlobMetadataName);
+  if (!blobMetaNode || blobMetaNode->getNumOperands() == 0)
+    return false;
+
+  auto blob = mdconst::extract<ConstantDataArray>(blobMetaNode->getOperand(0)->getOperand(0));
+  SmallVector<unsigned, 256> data;
+  data.reserve(blob->getNumElements());
+  for (unsigned index = 0; index != blob->getNumElements(); ++index)
+    data.push_back(blob->getElementAsInteger(index));
+
+  StateBlobReader reader(data);
+  if (reader.readInt() != StateBlobVersion)
+    report_fatal_error("Unsupported version of pipeline state in IR");
+
+  m_options = {};
+  reader.read(m_options);
+  m_shaderOptions.clear();
+  m_shaderOptions.resize(reader.readInt());
+  for (ShaderOptions &shaderOptions : m_shaderOptions) {
+    reader.beginStruct();
+    visitShaderOptionsFields(shaderOptions, [&reader](auto &field) { reader.readField(field); });
+    reader.endStruct();
+  }
+  m_deviceIndex = reader.readInt();
+  m_vertexInputDescriptions.clear();
+  m_vertexInputDescriptions.resize(reader.readInt());
+  for (VertexInputDescription &input : m_vertexInputDescriptions)
+    reader.read(input);
+  m_colorExportFormats.clear();
+  m_colorExportFormats.resize(reader.readInt());
+  for (ColorExportFormat &target : m_colorExportFormats)
+    reader.read(target);
+  m_colorExportState = {};
+  reader.read(m_colorExportState);
+  m_inputAssemblyState = {};
+  reader.read(m_inputAssemblyState);
+  m_viewportState = {};
+  reader.read(m_viewportState);
+  m_rasterizerState = {};
+  reader.read(m_rasterizerState);
+
+  // User data nodes, with the outer table at the start of a single buffer, and inner tables allocated from the end
+  // backwards, as in setUserDataNodes.
+  unsigned nodeCount = reader.readInt();
+  unsigned outerNodeCount = reader.readInt();
+  m_userDataNodes = {};
+  m_allocUserDataNodes.reset();
+  invalidateResourceNodeIndex();
+  if (nodeCount != 0 && outerNodeCount <= nodeCount) {
+    m_allocUserDataNodes = std::make_unique<ResourceNode[]>(nodeCount);
+    ResourceNode *destTable = m_allocUserDataNodes.get();
+    ResourceNode *destInnerTable = destTable + nodeCount;
+    readUserDataTableFromBlob(MutableArrayRef<ResourceNode>(destTable, outerNodeCount), destInnerTable, reader);
+    m_userDataNodes = ArrayRef<ResourceNode>(destTable, outerNodeCount);
+  }
+
+  if (reader.hasError())
+    report_fatal_error("Malformed pipeline state in IR");
+  return true;
+}
+
+// =====================================================================================================================
+// Read one table of user data nodes from the binary blob, calling itself recursively for inner tables.
+//
+// @param [out] destTable : Where to write nodes
+// @param [in/out] destInnerTable : End of space available for inner tables
+// @param [in/out] reader : Blob reader
+void PipelineState::readUserDataTableFromBlob(MutableArrayRef<ResourceNode> destTable, ResourceNode *&destInnerTable,
+                                              StateBlobReader &reader) {
+  for (ResourceNode &node : destTable) {
+    node.type = static_cast<ResourceNodeType>(reader.readInt());
+    node.offsetInDwords = reader.readInt();
+    node.sizeInDwords = reader.readInt();
+
+    switch (node.type) {
+    case ResourceNodeType::DescriptorTableVaPtr: {
+      unsigned innerNodeCount = reader.readInt();
+      assert(innerNodeCount <= static_cast<unsigned>(destInnerTable - destTable.end()));
+      destInnerTable -= innerNodeCount;
+      node.innerTable = ArrayRef<ResourceNode>(destInnerTable, innerNodeCount);
+      readUserDataTableFromBlob(MutableArrayRef<ResourceNode>(destInnerTable, innerNodeCount), destInnerTable,
+                                reader);
+      break;
+    }
+    case ResourceNodeType::IndirectUserDataVaPtr:
+    case ResourceNodeType::StreamOutTableVaPtr:
+      node.indirectSizeInDwords = reader.readInt();
+      break;
+    default: {
+      node.set = reader.readInt();
+      node.binding = reader.readInt();
+      node.immutableValue = nullptr;
+      unsigned elemCount = reader.readInt();
+      if (elemCount == 0)
+        break;
+      // The descriptor is either a sampler (<4 x i32>) or converting sampler (<8 x i32>).
+      unsigned samplerDescriptorSize = 4;
+      if (node.type == ResourceNodeType::DescriptorYCbCrSampler) {
+        samplerDescriptorSize = 8;
+        m_haveConvertingSampler = true;
+      }
+      SmallVector<Constant *, 8> descriptors;
+      for (unsigned elemIdx = 0; elemIdx != elemCount; ++elemIdx) {
+        SmallVector<unsigned, 8> compValues;
+        for (unsigned compIdx = 0; compIdx != samplerDescriptorSize; ++compIdx)
+          compValues.push_back(reader.readInt());
+        descriptors.push_back(ConstantDataVector::get(getContext(), compValues));
+      }
+      node.immutableValue = ConstantArray::get(ArrayType::get(descriptors[0]->getType(), elemCount), descriptors);
+      break;
+    }
+    }
+  }
+}
+
 // =====================================================================================================================
 // Read shaderStageMask from IR. This consists of checking what shader stage functions are present in the IR.
 //
@@ -450,6 +1056,7 @@ void PipelineState::setUserDataNodes(ArrayRef<ResourceNode> nodes) {
   ResourceNode *destInnerTable = destTable + nodeCount;
   m_userDataNodes = ArrayRef<ResourceNode>(destTable, nodes.size());
   setUserDataNodesTable(nodes, destTable, destInnerTable);
+  invalidateResourceNodeIndex();
   assert(destInnerTable == destTable + nodes.size());
 }
 
@@ -647,6 +1254,56 @@ void PipelineState::readUserDataNodes(Module *module) {
     }
   }
   m_userDataNodes = ArrayRef<ResourceNode>(m_allocUserDataNodes.get(), nextOuterNode);
+  invalidateResourceNodeIndex();
+}
+
+// =====================================================================================================================
+// Get the key of the resource node index for the given {set,binding}.
+//
+// @param descSet : ID of descriptor set
+// @param binding : ID of descriptor binding
+static uint64_t getResourceNodeKey(unsigned descSet, unsigned binding) {
+  return (uint64_t(descSet) << 32) | binding;
+}
+
+// =====================================================================================================================
+// Check whether the key of the resource node index for the given {set,binding} is one that DenseMap reserves, so
+// cannot be used in the index.
+//
+// @param key : Key from getResourceNodeKey
+static bool isReservedResourceNodeKey(uint64_t key) {
+  return key == DenseMapInfo<uint64_t>::getEmptyKey() || key == DenseMapInfo<uint64_t>::getTombstoneKey();
+}
+
+// =====================================================================================================================
+// Check whether a user data node has a {set,binding} that findResourceNode can match. A descriptor table pointer,
+// indirect user data pointer or stream-out table pointer does not: its set and binding fields share storage with
+// other fields, so they are not compared.
+//
+// @param node : User data node
+static bool hasResourceNodeBinding(const ResourceNode &node) {
+  return node.type != ResourceNodeType::DescriptorTableVaPtr && node.type != ResourceNodeType::IndirectUserDataVaPtr &&
+         node.type != ResourceNodeType::StreamOutTableVaPtr;
+}
+
+// =====================================================================================================================
+// Check whether a user data node with the {set,binding} being searched for matches the resource node type being
+// searched for. See findResourceNode.
+//
+// @param nodeType : Type of the resource mapping node being searched for
+// @param node : User data node
+// @param inInnerTable : Whether the node is in an inner table
+static bool isResourceNodeMatch(ResourceNodeType nodeType, const ResourceNode &node, bool inInnerTable) {
+  if (nodeType == ResourceNodeType::Unknown || nodeType == node.type)
+    return true;
+  if (nodeType == ResourceNodeType::DescriptorBuffer &&
+      (node.type == ResourceNodeType::DescriptorBufferCompact ||
+       (inInnerTable && node.type == ResourceNodeType::PushConst)))
+    return true;
+  return (node.type == ResourceNodeType::DescriptorCombinedTexture ||
+          node.type == ResourceNodeType::DescriptorYCbCrSampler) &&
+         (nodeType == ResourceNodeType::DescriptorResource || nodeType == ResourceNodeType::DescriptorTexelBuffer ||
+          nodeType == ResourceNodeType::DescriptorSampler);
 }
 
 // =====================================================================================================================
@@ -656,43 +1313,79 @@ void PipelineState::readUserDataNodes(Module *module) {
 // For nodeType == Sampler, it matches Sampler or CombinedTexture.
 // For nodeType == Buffer, it matches Buffer, BufferCompact or PushConst (the latter in an inner table only).
 // For other nodeType, only a node of the specified type is returned.
+// Descriptor table, indirect user data and stream-out table pointers are never returned, as they have no
+// {set,binding} (see hasResourceNodeBinding).
 // Returns {topNode, node} where "node" is the found user data node, and "topNode" is the top-level user data
 // node that contains it (or is equal to it).
 //
+// The nodes are looked up in an index by {set,binding}, built on the first call, so a pipeline with many bindings
+// does not search the whole user data node tree for each descriptor access.
+//
 // @param nodeType : Type of the resource mapping node
 // @param descSet : ID of descriptor set
 // @param binding : ID of descriptor binding
 std::pair<const ResourceNode *, const ResourceNode *>
 PipelineState::findResourceNode(ResourceNodeType nodeType, unsigned descSet, unsigned binding) const {
-  for (const ResourceNode &node : getUserDataNodes()) {
-    if (node.type == ResourceNodeType::DescriptorTableVaPtr) {
-      for (const ResourceNode &innerNode : node.innerTable) {
-        if (innerNode.set == descSet && innerNode.binding == binding) {
-          if (nodeType == ResourceNodeType::Unknown || nodeType == innerNode.type ||
-              (nodeType == ResourceNodeType::DescriptorBuffer &&
-               (innerNode.type == ResourceNodeType::DescriptorBufferCompact ||
-                innerNode.type == ResourceNodeType::PushConst)) ||
-              ((innerNode.type == ResourceNodeType::DescriptorCombinedTexture ||
-                innerNode.type == ResourceNodeType::DescriptorYCbCrSampler) &&
-               (nodeType == ResourceNodeType::DescriptorResource ||
-                nodeType == ResourceNodeType::DescriptorTexelBuffer ||
-                nodeType == ResourceNodeType::DescriptorSampler)))
+  uint64_t key = getResourceNodeKey(descSet, binding);
+  if (isReservedResourceNodeKey(key)) {
+    // Not in the index; search the nodes.
+    for (const ResourceNode &node : getUserDataNodes()) {
+      if (node.type == ResourceNodeType::DescriptorTableVaPtr) {
+        for (const ResourceNode &innerNode : node.innerTable) {
+          if (hasResourceNodeBinding(innerNode) && innerNode.set == descSet && innerNode.binding == binding &&
+              isResourceNodeMatch(nodeType, innerNode, /*inInnerTable=*/true))
             return {&node, &innerNode};
         }
-      }
-    } else if (node.set == descSet && node.binding == binding) {
-      if (nodeType == ResourceNodeType::Unknown || nodeType == node.type ||
-          (nodeType == ResourceNodeType::DescriptorBuffer && node.type == ResourceNodeType::DescriptorBufferCompact) ||
-          ((node.type == ResourceNodeType::DescriptorCombinedTexture ||
-            node.type == ResourceNodeType::DescriptorYCbCrSampler) &&
-           (nodeType == ResourceNodeType::DescriptorResource || nodeType == ResourceNodeType::DescriptorTexelBuffer ||
-            nodeType == ResourceNodeType::DescriptorSampler)))
+      } else if (hasResourceNodeBinding(node) && node.set == descSet && node.binding == binding &&
+                 isResourceNodeMatch(nodeType, node, /*inInnerTable=*/false))
         return {&node, &node};
     }
+    return {nullptr, nullptr};
+  }
+
+  if (!m_resourceNodeIndexValid)
+    buildResourceNodeIndex();
+
+  auto it = m_resourceNodeIndex.find(key);
+  if (it == m_resourceNodeIndex.end())
+    return {nullptr, nullptr};
+  for (const auto &nodes : it->second) {
+    if (isResourceNodeMatch(nodeType, *nodes.second, /*inInnerTable=*/nodes.first != nodes.second))
+      return nodes;
   }
   return {nullptr, nullptr};
 }
 
+// =====================================================================================================================
+// Build the index of user data nodes by {set,binding} used by findResourceNode. The nodes with the same {set,binding}
+// are kept in user data node order, so the first match is the same as it would be when searching the nodes.
+void PipelineState::buildResourceNodeIndex() const {
+  m_resourceNodeIndex.clear();
+  auto addNode = [this](const ResourceNode &topNode, const ResourceNode &node) {
+    uint64_t key = getResourceNodeKey(node.set, node.binding);
+    if (!isReservedResourceNodeKey(key))
+      m_resourceNodeIndex[key].push_back({&topNode, &node});
+  };
+
+  for (const ResourceNode &node : getUserDataNodes()) {
+    if (node.type == ResourceNodeType::DescriptorTableVaPtr) {
+      for (const ResourceNode &innerNode : node.innerTable) {
+        if (hasResourceNodeBinding(innerNode))
+          addNode(node, innerNode);
+      }
+    } else if (hasResourceNodeBinding(node))
+      addNode(node, node);
+  }
+  m_resourceNodeIndexValid = true;
+}
+
+// =====================================================================================================================
+// Invalidate the index of user data nodes by {set,binding}, when the user data nodes change.
+void PipelineState::invalidateResourceNodeIndex() {
+  m_resourceNodeIndex.clear();
+  m_resourceNodeIndexValid = false;
+}
+
 // =====================================================================================================================
 // Get the cached MDString for the name of a resource mapping node type, as used in IR metadata for user data nodes.
 //
@@ -59,7 +59,7 @@ void ShaderModes::clear() {
 void ShaderModes::setCommonShaderMode(ShaderStage stage, const CommonShaderMode &commonShaderMode) {
   auto modes = MutableArrayRef<CommonShaderMode>(m_commonShaderModes);
   modes[stage] = commonShaderMode;
-  m_anySet = true;
+  m_setStageMask |= 1U << stage;
 }
 
 // =====================================================================================================================
@@ -82,11 +82,16 @@ bool ShaderModes::getAnyUseSubgroupSize() {
 
 // =====================================================================================================================
 // Set the tessellation mode. This in fact merges the supplied values with any previously supplied values,
-// to allow the client to call this twice, once for TCS and once for TES.
+// to allow the client to call this twice, once for TCS and once for TES. The values supplied by each stage are also
+// kept separately, so that they can be recorded into that stage's IR without the other stage's values.
 //
+// @param stage : Shader stage (TCS or TES) supplying the mode
 // @param inMode : Tessellation mode
-void ShaderModes::setTessellationMode(const TessellationMode &inMode) {
+void ShaderModes::setTessellationMode(ShaderStage stage, const TessellationMode &inMode) {
   assert(inMode.outputVertices <= MaxTessPatchVertices);
+  assert(stage == ShaderStageTessControl || stage == ShaderStageTessEval);
+
+  m_stageTessellationModes[stage - ShaderStageTessControl] = inMode;
 
   m_tessellationMode.vertexSpacing =
       inMode.vertexSpacing != static_cast<VertexSpacing>(0) ? inMode.vertexSpacing : m_tessellationMode.vertexSpacing;
@@ -178,37 +183,96 @@ void ShaderModes::record(Module *module) {
   PipelineState::setNamedMetadataToArrayOfInt32(module, m_computeShaderMode, ComputeShaderModeMetadataName);
 }
 
+// =====================================================================================================================
+// Record the modes that apply to a single shader stage (its common mode and its specific mode, if any) into IR
+// metadata. This is used by a front-end that wants to cache a shader module from a pipeline compile and later link
+// it into another pipeline.
+//
+// @param [in/out] module : Module to record the IR metadata in
+// @param stage : Shader stage
+void ShaderModes::record(Module *module, ShaderStage stage) {
+  std::string metadataName =
+      std::string(CommonShaderModeMetadataPrefix) + getShaderStageAbbreviation(static_cast<ShaderStage>(stage));
+  PipelineState::setNamedMetadataToArrayOfInt32(module, getCommonShaderMode(stage), metadataName);
+
+  switch (stage) {
+  case ShaderStageTessControl:
+  case ShaderStageTessEval:
+    // Only the values this stage supplied, so that the IR can be linked with a different partner stage.
+    PipelineState::setNamedMetadataToArrayOfInt32(module, m_stageTessellationModes[stage - ShaderStageTessControl],
+                                                  TessellationModeMetadataName);
+    break;
+  case ShaderStageGeometry:
+    PipelineState::setNamedMetadataToArrayOfInt32(module, m_geometryShaderMode, GeometryShaderModeMetadataName);
+    break;
+  case ShaderStageFragment:
+    PipelineState::setNamedMetadataToArrayOfInt32(module, m_fragmentShaderMode, FragmentShaderModeMetadataName);
+    break;
+  case ShaderStageCompute:
+    PipelineState::setNamedMetadataToArrayOfInt32(module, m_computeShaderMode, ComputeShaderModeMetadataName);
+    break;
+  default:
+    break;
+  }
+}
+
+// =====================================================================================================================
+// Remove a named metadata node from a module if it is there
+//
+// @param [in/out] module : LLVM module
+// @param metadataName : Name of the named metadata node
+static void eraseNamedMetadata(Module *module, StringRef metadataName) {
+  if (auto namedMetaNode = module->getNamedMetadata(metadataName))
+    module->eraseNamedMetadata(namedMetaNode);
+}
+
 // =====================================================================================================================
 // Read shader modes (common and specific) from a shader IR module, but only if no modes have been set
-// in this ShaderModes. This is used to handle the case that the shader module comes from an earlier
-// shader compile, and it had its ShaderModes recorded into IR then.
+// for that shader stage in this ShaderModes. This is used to handle the case that the shader module comes
+// from an earlier shader compile, or from a front-end cache, and it had its ShaderModes recorded into IR then.
+// The metadata is removed from the shader module either way, as the modes for the whole pipeline get recorded
+// again into the linked pipeline module.
 //
 // @param module : LLVM module
 // @param stage : Shader stage
 void ShaderModes::readModesFromShader(Module *module, ShaderStage stage) {
-  // Bail if any modes have been set, which would mean that this is a full pipeline compile.
-  if (m_anySet)
-    return;
+  // If modes have been set for this stage, it was translated in this pipeline compile, and the IR metadata (if any)
+  // is just a copy of them.
+  bool readModes = (m_setStageMask & (1U << stage)) == 0;
 
   // First the common state.
   std::string metadataName =
       std::string(CommonShaderModeMetadataPrefix) + getShaderStageAbbreviation(static_cast<ShaderStage>(stage));
-  PipelineState::readNamedMetadataArrayOfInt32(module, metadataName, m_commonShaderModes[stage]);
+  if (readModes)
+    PipelineState::readNamedMetadataArrayOfInt32(module, metadataName, m_commonShaderModes[stage]);
+  eraseNamedMetadata(module, metadataName);
 
   // Then the specific shader modes.
   switch (stage) {
   case ShaderStageTessControl:
-  case ShaderStageTessEval:
-    PipelineState::readNamedMetadataArrayOfInt32(module, TessellationModeMetadataName, m_tessellationMode);
+  case ShaderStageTessEval: {
+    // The tessellation mode can come from both TCS and TES, so merge it in as the front-end would have done.
+    TessellationMode tessellationMode = {};
+    if (readModes &&
+        PipelineState::readNamedMetadataArrayOfInt32(module, TessellationModeMetadataName, tessellationMode))
+      setTessellationMode(stage, tessellationMode);
+    eraseNamedMetadata(module, TessellationModeMetadataName);
     break;
+  }
   case ShaderStageGeometry:
-    PipelineState::readNamedMetadataArrayOfInt32(module, GeometryShaderModeMetadataName, m_geometryShaderMode);
+    if (readModes)
+      PipelineState::readNamedMetadataArrayOfInt32(module, GeometryShaderModeMetadataName, m_geometryShaderMode);
+    eraseNamedMetadata(module, GeometryShaderModeMetadataName);
     break;
   case ShaderStageFragment:
-    PipelineState::readNamedMetadataArrayOfInt32(module, FragmentShaderModeMetadataName, m_fragmentShaderMode);
+    if (readModes)
+      PipelineState::readNamedMetadataArrayOfInt32(module, FragmentShaderModeMetadataName, m_fragmentShaderMode);
+    eraseNamedMetadata(module, FragmentShaderModeMetadataName);
     break;
   case ShaderStageCompute:
-    PipelineState::readNamedMetadataArrayOfInt32(module, ComputeShaderModeMetadataName, m_computeShaderMode);
+    if (readModes)
+      PipelineState::readNamedMetadataArrayOfInt32(module, ComputeShaderModeMetadataName, m_computeShaderMode);
+    eraseNamedMetadata(module, ComputeShaderModeMetadataName);
     break;
   default:
     break;
@@ -0,0 +1,113 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2017-2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  IntrinsicRegistry.cpp
+ * @brief LLPC source file: contains implementation of class lgc::IntrinsicRegistry.
+ ***********************************************************************************************************************
+ */
+#include "lgc/util/IntrinsicRegistry.h"
+#include "lgc/state/Defs.h"
+#include "llvm/IR/Module.h"
+
+using namespace lgc;
+using namespace llvm;
+
+namespace {
+
+// Name prefix of each LgcIntrinsic ID. Where one prefix is a prefix of another, the longer one comes first.
+const struct {
+  const char *prefix;
+  LgcIntrinsic id;
+} IntrinsicPrefixes[] = {
+    {lgcName::InputImportGeneric, LgcIntrinsic::InputImportGeneric},
+    {lgcName::InputImportBuiltIn, LgcIntrinsic::InputImportBuiltIn},
+    {lgcName::InputImportInterpolant, LgcIntrinsic::InputImportInterpolant},
+    {lgcName::OutputImportGeneric, LgcIntrinsic::OutputImportGeneric},
+    {lgcName::OutputImportBuiltIn, LgcIntrinsic::OutputImportBuiltIn},
+    {lgcName::OutputExportGeneric, LgcIntrinsic::OutputExportGeneric},
+    {lgcName::OutputExportBuiltIn, LgcIntrinsic::OutputExportBuiltIn},
+    {lgcName::OutputExportXfb, LgcIntrinsic::OutputExportXfb},
+    {lgcName::BufferLoadUniform, LgcIntrinsic::BufferLoadUniform},
+    {lgcName::BufferLoadScalarAligned, LgcIntrinsic::BufferLoadScalarAligned},
+    {lgcName::BufferLoad, LgcIntrinsic::BufferLoad},
+    {lgcName::PushConstLoad, LgcIntrinsic::PushConstLoad},
+    {lgcName::DescriptorIndex, LgcIntrinsic::DescriptorIndex},
+    {lgcName::DescriptorLoadFromPtr, LgcIntrinsic::DescriptorLoadFromPtr},
+    {lgcName::DescriptorLoadBuffer, LgcIntrinsic::DescriptorLoadBuffer},
+    {lgcName::DescriptorLoadSpillTable, LgcIntrinsic::DescriptorLoadSpillTable},
+    {lgcName::DescriptorGetResourcePtr, LgcIntrinsic::DescriptorGetResourcePtr},
+    {lgcName::DescriptorGetSamplerPtr, LgcIntrinsic::DescriptorGetSamplerPtr},
+    {lgcName::DescriptorGetFmaskPtr, LgcIntrinsic::DescriptorGetFmaskPtr},
+    {lgcName::DescriptorGetTexelBufferPtr, LgcIntrinsic::DescriptorGetTexelBufferPtr},
+};
+
+} // anonymous namespace
+
+// =====================================================================================================================
+// Classify the declarations in the module.
+//
+// @param module : Module to classify the declarations of
+void IntrinsicRegistry::init(Module &module) {
+  m_ids.clear();
+  for (auto &declarations : m_declarations)
+    declarations.clear();
+
+  for (Function &func : module) {
+    if (!func.isDeclaration())
+      continue;
+    LgcIntrinsic id = classify(func.getName());
+    m_ids[&func] = id;
+    if (id != LgcIntrinsic::None)
+      m_declarations[static_cast<unsigned>(id)].push_back(&func);
+  }
+}
+
+// =====================================================================================================================
+// Get the ID of a called function, classifying it by name if it was not seen before.
+//
+// @param func : Called function
+LgcIntrinsic IntrinsicRegistry::get(const Function *func) {
+  auto it = m_ids.find(func);
+  if (it != m_ids.end())
+    return it->second;
+  LgcIntrinsic id = func->isDeclaration() ? classify(func->getName()) : LgcIntrinsic::None;
+  m_ids[func] = id;
+  return id;
+}
+
+// =====================================================================================================================
+// Classify a function by its name.
+//
+// @param name : Function name
+LgcIntrinsic IntrinsicRegistry::classify(StringRef name) {
+  if (!name.startswith("lgc."))
+    return LgcIntrinsic::None;
+  for (const auto &entry : IntrinsicPrefixes) {
+    if (name.startswith(entry.prefix))
+      return entry.id;
+  }
+  return LgcIntrinsic::None;
+}
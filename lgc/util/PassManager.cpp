@@ -29,10 +29,22 @@
  ***********************************************************************************************************************
  */
 #include "lgc/PassManager.h"
+#include "lgc/Trace.h"
 #include "lgc/util/Debug.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Analysis/CFGPrinter.h"
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/Analysis/CallGraphSCCPass.h"
+#include "llvm/Analysis/LoopPass.h"
+#include "llvm/IR/Module.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/Mutex.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
 
 namespace llvm {
 namespace cl {
@@ -58,8 +70,144 @@ static cl::list<unsigned> DisablePassIndices("disable-pass-indices", cl::ZeroOrM
 using namespace lgc;
 using namespace llvm;
 
+namespace lgc {
+
+// Statistics of one pass, summed over all its runs. A run is one invocation of the pass on the unit of IR it works on:
+// a module, a function, a loop or a call graph SCC. The IR sizes are those of that unit.
+struct PassStats {
+  std::string name;      // Pass name
+  unsigned runCount;     // Number of runs
+  double seconds;        // Wall-clock time spent in the pass
+  uint64_t instsBefore;  // Instruction count before the pass
+  uint64_t instsAfter;   // Instruction count after the pass
+  uint64_t blocksBefore; // Basic block count before the pass
+  uint64_t blocksAfter;  // Basic block count after the pass
+};
+
+// =====================================================================================================================
+// Table of per-pass statistics, keyed by pass name, in order of first run
+class PassStatsTable {
+public:
+  void add(const PassStats &stats);
+  void merge(const PassStatsTable &other);
+  bool empty() const { return m_passes.empty(); }
+  void clear();
+  void writeJson(json::OStream &jsonStream) const;
+
+private:
+  std::vector<PassStats> m_passes;  // Statistics per pass name
+  StringMap<unsigned> m_passIndices; // Map from pass name to index in m_passes
+};
+
+} // namespace lgc
+
 namespace {
 
+// Global state of per-pass statistics
+struct PassStatsState {
+  std::atomic<bool> enabled{false};                              // Whether statistics are gathered
+  sys::Mutex mutex;                                              // Mutex guarding the fields below
+  std::vector<std::pair<std::string, PassStatsTable>> pipelines; // Statistics per finished pipeline
+  PassStatsTable total;                                          // Statistics across the run
+};
+
+// =====================================================================================================================
+// Get the global state of per-pass statistics
+static PassStatsState &getPassStatsState() {
+  static PassStatsState state;
+  return state;
+}
+
+// Statistics of the pipeline being compiled on this thread
+static thread_local PassStatsTable CurrentPipelinePassStats;
+
+// One run of a pass (or group of passes) being measured, shared by the pair of marker passes around it
+struct PassRun {
+  PassStats stats;                                  // Statistics of this run
+  std::chrono::steady_clock::time_point startTime; // Time the pass started
+  uint64_t traceStartTime;                          // Time the pass started, for the trace
+};
+
+// =====================================================================================================================
+// State and behavior shared by the marker passes, which are inserted before and after a measured pass to record the
+// time and the IR size for the per-pass statistics, and an event for the trace.
+//
+// Each marker is the same kind of pass as the measured pass, so that inserting markers does not change how the legacy
+// pass manager batches passes: a measured function pass still runs function by function together with its
+// neighbours, and a loop pass loop by loop. The marker before the pass requires the same analyses as the pass, so
+// that the pass manager schedules them ahead of the marker rather than between the marker and the pass.
+class PassMarkerBase {
+protected:
+  PassMarkerBase(std::shared_ptr<PassRun> run, bool starting, Pass *measuredPass);
+
+  void addAnalysisUsage(AnalysisUsage &analysisUsage) const;
+  void mark(uint64_t instCount, uint64_t blockCount);
+
+  std::shared_ptr<PassRun> m_run;        // The run being measured
+  bool m_starting;                       // True if this marker is before the pass, false if after
+  SmallVector<AnalysisID, 8> m_required; // Analyses required by the measured pass, if this marker is before it
+};
+
+// =====================================================================================================================
+// Marker for a module pass, or for a pass group
+class ModulePassMarker : public ModulePass, PassMarkerBase {
+public:
+  static char ID;
+  ModulePassMarker(std::shared_ptr<PassRun> run, bool starting, Pass *measuredPass)
+      : ModulePass(ID), PassMarkerBase(std::move(run), starting, measuredPass) {}
+
+  void getAnalysisUsage(AnalysisUsage &analysisUsage) const override { addAnalysisUsage(analysisUsage); }
+  bool runOnModule(Module &module) override;
+  StringRef getPassName() const override { return "LLPC pass marker"; }
+};
+
+// =====================================================================================================================
+// Marker for a function pass
+class FunctionPassMarker : public FunctionPass, PassMarkerBase {
+public:
+  static char ID;
+  FunctionPassMarker(std::shared_ptr<PassRun> run, bool starting, Pass *measuredPass)
+      : FunctionPass(ID), PassMarkerBase(std::move(run), starting, measuredPass) {}
+
+  void getAnalysisUsage(AnalysisUsage &analysisUsage) const override { addAnalysisUsage(analysisUsage); }
+  bool runOnFunction(Function &func) override;
+  StringRef getPassName() const override { return "LLPC function pass marker"; }
+};
+
+// =====================================================================================================================
+// Marker for a loop pass
+class LoopPassMarker : public LoopPass, PassMarkerBase {
+public:
+  static char ID;
+  LoopPassMarker(std::shared_ptr<PassRun> run, bool starting, Pass *measuredPass)
+      : LoopPass(ID), PassMarkerBase(std::move(run), starting, measuredPass) {}
+
+  void getAnalysisUsage(AnalysisUsage &analysisUsage) const override { addAnalysisUsage(analysisUsage); }
+  bool runOnLoop(Loop *loop, LPPassManager &loopPassMgr) override;
+  StringRef getPassName() const override { return "LLPC loop pass marker"; }
+};
+
+// =====================================================================================================================
+// Marker for a call graph SCC pass
+class CallGraphSccPassMarker : public CallGraphSCCPass, PassMarkerBase {
+public:
+  static char ID;
+  CallGraphSccPassMarker(std::shared_ptr<PassRun> run, bool starting, Pass *measuredPass)
+      : CallGraphSCCPass(ID), PassMarkerBase(std::move(run), starting, measuredPass) {}
+
+  void getAnalysisUsage(AnalysisUsage &analysisUsage) const override {
+    CallGraphSCCPass::getAnalysisUsage(analysisUsage);
+    addAnalysisUsage(analysisUsage);
+  }
+  bool runOnSCC(CallGraphSCC &scc) override;
+  StringRef getPassName() const override { return "LLPC call graph SCC pass marker"; }
+};
+
+char ModulePassMarker::ID = 0;
+char FunctionPassMarker::ID = 0;
+char LoopPassMarker::ID = 0;
+char CallGraphSccPassMarker::ID = 0;
+
 // =====================================================================================================================
 // LLPC's legacy::PassManager override.
 // This is the implementation subclass of the PassManager class declared in PassManager.h
@@ -71,6 +219,8 @@ public:
   void setPassIndex(unsigned *passIndex) override { m_passIndex = passIndex; }
   void add(llvm::Pass *pass) override;
   void stop() override;
+  void beginPassGroup(llvm::StringRef name) override;
+  void endPassGroup() override;
 
 private:
   bool m_stopped = false;                     // Whether we have already stopped adding new passes.
@@ -78,6 +228,8 @@ private:
   llvm::AnalysisID m_printModule = nullptr;   // Pass id of dump pass "Print Module IR"
   llvm::AnalysisID m_jumpThreading = nullptr; // Pass id of opt pass "Jump Threading"
   unsigned *m_passIndex = nullptr;            // Pass Index
+  bool m_measurePasses = false;               // Whether to measure each pass, for statistics or the trace
+  std::shared_ptr<PassRun> m_groupRun;        // Run of the pass group being added, if any
 };
 
 } // namespace
@@ -120,6 +272,26 @@ PassManagerImpl::PassManagerImpl() : PassManager() {
 
   m_jumpThreading = getPassIdFromName("jump-threading");
   m_printModule = getPassIdFromName("print-module");
+  m_measurePasses = getPassStatsState().enabled || Trace::isEnabled();
+}
+
+// =====================================================================================================================
+// Create a marker pass of the same kind as the measured pass.
+//
+// @param run : The run being measured
+// @param starting : True if the marker goes before the measured pass, false if after
+// @param measuredPass : The measured pass
+static Pass *createPassMarker(std::shared_ptr<PassRun> run, bool starting, Pass *measuredPass) {
+  switch (measuredPass->getPassKind()) {
+  case PT_Function:
+    return new FunctionPassMarker(std::move(run), starting, measuredPass);
+  case PT_Loop:
+    return new LoopPassMarker(std::move(run), starting, measuredPass);
+  case PT_CallGraphSCC:
+    return new CallGraphSccPassMarker(std::move(run), starting, measuredPass);
+  default:
+    return new ModulePassMarker(std::move(run), starting, measuredPass);
+  }
 }
 
 // =====================================================================================================================
@@ -151,8 +323,17 @@ void PassManagerImpl::add(Pass *pass) {
       LLPC_OUTS("Pass[" << passIndex << "] = " << pass->getPassName() << "\n");
   }
 
-  // Add the pass to the superclass pass manager.
-  legacy::PassManager::add(pass);
+  // Add the pass to the superclass pass manager, between a pair of markers if measuring passes and not inside a
+  // pass group.
+  if (m_measurePasses && !m_groupRun && passId != m_printModule && !pass->getAsImmutablePass()) {
+    auto run = std::make_shared<PassRun>();
+    run->stats = {};
+    run->stats.name = pass->getPassName().str();
+    legacy::PassManager::add(createPassMarker(run, true, pass));
+    legacy::PassManager::add(pass);
+    legacy::PassManager::add(createPassMarker(run, false, pass));
+  } else
+    legacy::PassManager::add(pass);
 
   if (cl::VerifyIr) {
     // Add a verify pass after it.
@@ -170,3 +351,266 @@ void PassManagerImpl::add(Pass *pass) {
 void PassManagerImpl::stop() {
   m_stopped = true;
 }
+
+// =====================================================================================================================
+// Begin a group of passes that are measured as one unit, rather than one by one. This is needed for passes that must
+// stay in the same function pass manager as each other, such as the codegen passes.
+//
+// @param name : Name of the group in the per-pass statistics and the trace
+void PassManagerImpl::beginPassGroup(StringRef name) {
+  if (!m_measurePasses || m_stopped || m_groupRun)
+    return;
+  m_groupRun = std::make_shared<PassRun>();
+  m_groupRun->stats = {};
+  m_groupRun->stats.name = name.str();
+  legacy::PassManager::add(new ModulePassMarker(m_groupRun, true, nullptr));
+}
+
+// =====================================================================================================================
+// End the group of passes begun by beginPassGroup.
+void PassManagerImpl::endPassGroup() {
+  if (!m_groupRun)
+    return;
+  legacy::PassManager::add(new ModulePassMarker(m_groupRun, false, nullptr));
+  m_groupRun = nullptr;
+}
+
+// =====================================================================================================================
+// Enable per-pass statistics for pass managers created from now on.
+void lgc::PassManager::enablePassStats() {
+  getPassStatsState().enabled = true;
+}
+
+// =====================================================================================================================
+// Check whether per-pass statistics are enabled.
+bool lgc::PassManager::isPassStatsEnabled() {
+  return getPassStatsState().enabled;
+}
+
+// =====================================================================================================================
+// Finish the per-pass statistics of the pipeline compiled on this thread.
+//
+// @param pipelineName : Name to record the statistics under
+void lgc::PassManager::finishPipelinePassStats(StringRef pipelineName) {
+  if (CurrentPipelinePassStats.empty())
+    return;
+
+  PassStatsState &state = getPassStatsState();
+  std::lock_guard<sys::Mutex> lock(state.mutex);
+  state.total.merge(CurrentPipelinePassStats);
+  state.pipelines.emplace_back(pipelineName.str(), std::move(CurrentPipelinePassStats));
+  CurrentPipelinePassStats.clear();
+}
+
+// =====================================================================================================================
+// Take the per-pass statistics gathered on this thread that are not yet finished.
+std::shared_ptr<PassStatsTable> lgc::PassManager::takeThreadPassStats() {
+  auto passStats = std::make_shared<PassStatsTable>(std::move(CurrentPipelinePassStats));
+  CurrentPipelinePassStats.clear();
+  return passStats;
+}
+
+// =====================================================================================================================
+// Add per-pass statistics taken from another thread to those of this thread.
+//
+// @param passStats : Statistics from takeThreadPassStats, or nullptr
+void lgc::PassManager::mergeThreadPassStats(const std::shared_ptr<PassStatsTable> &passStats) {
+  if (passStats)
+    CurrentPipelinePassStats.merge(*passStats);
+}
+
+// =====================================================================================================================
+// Write the per-pass statistics gathered so far as JSON.
+//
+// @param [out] outStream : Stream to write to
+void lgc::PassManager::writePassStats(raw_ostream &outStream) {
+  PassStatsState &state = getPassStatsState();
+  std::lock_guard<sys::Mutex> lock(state.mutex);
+
+  json::OStream jsonStream(outStream, 2);
+  jsonStream.object([&] {
+    jsonStream.attributeArray("pipelines", [&] {
+      for (const auto &pipeline : state.pipelines) {
+        jsonStream.object([&] {
+          jsonStream.attribute("name", pipeline.first);
+          jsonStream.attributeArray("passes", [&] { pipeline.second.writeJson(jsonStream); });
+        });
+      }
+    });
+    jsonStream.attributeArray("total", [&] { state.total.writeJson(jsonStream); });
+  });
+  outStream << "\n";
+}
+
+// =====================================================================================================================
+// Set up a marker pass.
+//
+// @param run : The run being measured
+// @param starting : True if this marker is before the measured pass, false if after
+// @param measuredPass : The measured pass, or nullptr for a pass group
+PassMarkerBase::PassMarkerBase(std::shared_ptr<PassRun> run, bool starting, Pass *measuredPass)
+    : m_run(std::move(run)), m_starting(starting) {
+  if (m_starting && measuredPass) {
+    AnalysisUsage measuredUsage;
+    measuredPass->getAnalysisUsage(measuredUsage);
+    m_required.append(measuredUsage.getRequiredSet().begin(), measuredUsage.getRequiredSet().end());
+    m_required.append(measuredUsage.getRequiredTransitiveSet().begin(),
+                      measuredUsage.getRequiredTransitiveSet().end());
+  }
+}
+
+// =====================================================================================================================
+// Add the analysis usage of a marker pass: it requires what the measured pass requires, and preserves everything.
+//
+// @param [in/out] analysisUsage : Analysis usage
+void PassMarkerBase::addAnalysisUsage(AnalysisUsage &analysisUsage) const {
+  for (AnalysisID id : m_required)
+    analysisUsage.addRequiredID(id);
+  analysisUsage.setPreservesAll();
+}
+
+// =====================================================================================================================
+// Record the time and the IR size of the unit of IR the measured pass runs on, before or after the pass.
+//
+// @param instCount : Instruction count of the unit of IR
+// @param blockCount : Basic block count of the unit of IR
+void PassMarkerBase::mark(uint64_t instCount, uint64_t blockCount) {
+  auto endTime = std::chrono::steady_clock::now();
+  uint64_t traceEndTime = Trace::isEnabled() ? Trace::getTime() : 0;
+
+  PassStats &stats = m_run->stats;
+  bool passStats = getPassStatsState().enabled;
+  if (passStats) {
+    if (m_starting) {
+      stats.instsBefore = instCount;
+      stats.blocksBefore = blockCount;
+    } else {
+      stats.instsAfter = instCount;
+      stats.blocksAfter = blockCount;
+    }
+  }
+
+  if (m_starting) {
+    // Start the clocks after counting, so that counting is not included in the time of the pass.
+    m_run->startTime = std::chrono::steady_clock::now();
+    m_run->traceStartTime = Trace::isEnabled() ? Trace::getTime() : 0;
+    return;
+  }
+
+  if (passStats) {
+    stats.runCount = 1;
+    stats.seconds = std::chrono::duration<double>(endTime - m_run->startTime).count();
+    CurrentPipelinePassStats.add(stats);
+  }
+  if (Trace::isEnabled())
+    Trace::addEvent(stats.name, "pass", m_run->traceStartTime, traceEndTime);
+}
+
+// =====================================================================================================================
+// Run the module marker pass.
+//
+// @param [in] module : LLVM module
+bool ModulePassMarker::runOnModule(Module &module) {
+  uint64_t instCount = 0;
+  uint64_t blockCount = 0;
+  if (getPassStatsState().enabled) {
+    for (const Function &func : module) {
+      instCount += func.getInstructionCount();
+      blockCount += func.size();
+    }
+  }
+  mark(instCount, blockCount);
+  return false;
+}
+
+// =====================================================================================================================
+// Run the function marker pass.
+//
+// @param [in] func : LLVM function
+bool FunctionPassMarker::runOnFunction(Function &func) {
+  mark(func.getInstructionCount(), func.size());
+  return false;
+}
+
+// =====================================================================================================================
+// Run the loop marker pass.
+//
+// @param [in] loop : LLVM loop
+// @param loopPassMgr : Loop pass manager
+bool LoopPassMarker::runOnLoop(Loop *loop, LPPassManager &loopPassMgr) {
+  uint64_t instCount = 0;
+  for (const BasicBlock *block : loop->blocks())
+    instCount += block->size();
+  mark(instCount, loop->getNumBlocks());
+  return false;
+}
+
+// =====================================================================================================================
+// Run the call graph SCC marker pass.
+//
+// @param [in] scc : Call graph SCC
+bool CallGraphSccPassMarker::runOnSCC(CallGraphSCC &scc) {
+  uint64_t instCount = 0;
+  uint64_t blockCount = 0;
+  for (CallGraphNode *node : scc) {
+    if (const Function *func = node->getFunction()) {
+      instCount += func->getInstructionCount();
+      blockCount += func->size();
+    }
+  }
+  mark(instCount, blockCount);
+  return false;
+}
+
+// =====================================================================================================================
+// Add the statistics of a pass to the table, summing them with earlier runs of the same pass.
+//
+// @param stats : Statistics to add
+void PassStatsTable::add(const PassStats &stats) {
+  auto it = m_passIndices.insert({stats.name, m_passes.size()});
+  if (it.second) {
+    m_passes.push_back(stats);
+    return;
+  }
+  PassStats &entry = m_passes[it.first->second];
+  entry.runCount += stats.runCount;
+  entry.seconds += stats.seconds;
+  entry.instsBefore += stats.instsBefore;
+  entry.instsAfter += stats.instsAfter;
+  entry.blocksBefore += stats.blocksBefore;
+  entry.blocksAfter += stats.blocksAfter;
+}
+
+// =====================================================================================================================
+// Add all statistics of another table to this one.
+//
+// @param other : Table to merge
+void PassStatsTable::merge(const PassStatsTable &other) {
+  for (const PassStats &stats : other.m_passes)
+    add(stats);
+}
+
+// =====================================================================================================================
+// Clear the table.
+void PassStatsTable::clear() {
+  m_passes.clear();
+  m_passIndices.clear();
+}
+
+// =====================================================================================================================
+// Write the table as JSON array elements.
+//
+// @param [in/out] jsonStream : JSON stream, inside an array
+void PassStatsTable::writeJson(json::OStream &jsonStream) const {
+  for (const PassStats &stats : m_passes) {
+    jsonStream.object([&] {
+      jsonStream.attribute("name", stats.name);
+      jsonStream.attribute("runs", stats.runCount);
+      jsonStream.attribute("seconds", stats.seconds);
+      jsonStream.attribute("instsBefore", static_cast<int64_t>(stats.instsBefore));
+      jsonStream.attribute("instsAfter", static_cast<int64_t>(stats.instsAfter));
+      jsonStream.attribute("blocksBefore", static_cast<int64_t>(stats.blocksBefore));
+      jsonStream.attribute("blocksAfter", static_cast<int64_t>(stats.blocksAfter));
+    });
+  }
+}
@@ -0,0 +1,147 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2018-2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  Trace.cpp
+ * @brief LLPC source file: contains implementation of class lgc::Trace.
+ ***********************************************************************************************************************
+ */
+#include "lgc/Trace.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/Process.h"
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace lgc;
+using namespace llvm;
+
+namespace {
+
+// One complete trace event
+struct TraceEvent {
+  std::string name;     // Event name
+  std::string category; // Event category
+  uint64_t startTime;   // Start time in microseconds
+  uint64_t duration;    // Duration in microseconds
+};
+
+// Events recorded by one thread
+struct TraceThreadEvents {
+  unsigned threadId;              // Thread ID in the trace, counted from 1 in order of first event
+  sys::Mutex mutex;               // Mutex guarding events, only contended while the trace is written
+  std::vector<TraceEvent> events; // Events in order of completion
+};
+
+// Global state of tracing
+struct TraceState {
+  std::chrono::steady_clock::time_point startTime;         // Time tracing was enabled
+  sys::Mutex mutex;                                         // Mutex guarding threads
+  std::vector<std::unique_ptr<TraceThreadEvents>> threads; // Events per thread
+};
+
+} // anonymous namespace
+
+std::atomic<bool> Trace::s_enabled(false);
+
+// Events of the current thread, owned by the global state
+static thread_local TraceThreadEvents *CurrentThreadEvents = nullptr;
+
+// =====================================================================================================================
+// Get the global state of tracing
+static TraceState &getTraceState() {
+  static TraceState state;
+  return state;
+}
+
+// =====================================================================================================================
+// Enable tracing.
+void Trace::enable() {
+  if (isEnabled())
+    return;
+  getTraceState().startTime = std::chrono::steady_clock::now();
+  s_enabled.store(true, std::memory_order_release);
+}
+
+// =====================================================================================================================
+// Get the current time in microseconds since tracing was enabled.
+uint64_t Trace::getTime() {
+  auto elapsed = std::chrono::steady_clock::now() - getTraceState().startTime;
+  return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+// =====================================================================================================================
+// Record a complete event on the current thread.
+//
+// @param name : Event name
+// @param category : Event category
+// @param startTime : Start time, from getTime()
+// @param endTime : End time, from getTime()
+void Trace::addEvent(StringRef name, StringRef category, uint64_t startTime, uint64_t endTime) {
+  if (!CurrentThreadEvents) {
+    TraceState &state = getTraceState();
+    std::lock_guard<sys::Mutex> lock(state.mutex);
+    state.threads.push_back(std::make_unique<TraceThreadEvents>());
+    CurrentThreadEvents = state.threads.back().get();
+    CurrentThreadEvents->threadId = state.threads.size();
+  }
+  std::lock_guard<sys::Mutex> lock(CurrentThreadEvents->mutex);
+  CurrentThreadEvents->events.push_back({name.str(), category.str(), startTime, endTime - startTime});
+}
+
+// =====================================================================================================================
+// Write all recorded events as trace-event JSON. Threads may still be recording; each thread's events are locked
+// while they are written.
+//
+// @param [out] outStream : Stream to write to
+void Trace::write(raw_ostream &outStream) {
+  TraceState &state = getTraceState();
+  std::lock_guard<sys::Mutex> lock(state.mutex);
+  int64_t processId = sys::Process::getProcessId();
+
+  json::OStream jsonStream(outStream);
+  jsonStream.object([&] {
+    jsonStream.attributeArray("traceEvents", [&] {
+      for (const auto &thread : state.threads) {
+        std::lock_guard<sys::Mutex> threadLock(thread->mutex);
+        for (const TraceEvent &event : thread->events) {
+          jsonStream.object([&] {
+            jsonStream.attribute("name", event.name);
+            jsonStream.attribute("cat", event.category);
+            jsonStream.attribute("ph", "X");
+            jsonStream.attribute("ts", static_cast<int64_t>(event.startTime));
+            jsonStream.attribute("dur", static_cast<int64_t>(event.duration));
+            jsonStream.attribute("pid", processId);
+            jsonStream.attribute("tid", static_cast<int64_t>(thread->threadId));
+          });
+        }
+      }
+    });
+    jsonStream.attribute("displayTimeUnit", "ms");
+  });
+  outStream << "\n";
+}
@@ -35,9 +35,12 @@
 #include "llpcContext.h"
 #include "llpcDebug.h"
 #include "llpcGraphicsContext.h"
+#include "llpcOccupancyTuner.h"
+#include "llpcPipelineSpeculator.h"
 #include "spirvExt.h"
 #include "lgc/Builder.h"
 #include "llvm/BinaryFormat/MsgPackDocument.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/Bitcode/BitcodeWriterPass.h"
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/DiagnosticPrinter.h"
@@ -47,6 +50,8 @@
 #include "llvm/Support/Format.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/IPO/AlwaysInliner.h"
@@ -56,10 +61,12 @@
 #include "llpcSpirvLower.h"
 #include "llpcSpirvLowerResourceCollect.h"
 #include "llpcSpirvLowerUtil.h"
+#include "llpcSpirvModuleCache.h"
 #include "llpcTimerProfiler.h"
 #include "vkgcElfReader.h"
 #include "vkgcPipelineDumper.h"
 #include "lgc/PassManager.h"
+#include "lgc/Trace.h"
 #include <mutex>
 #include <set>
 #include <unordered_set>
@@ -147,6 +154,81 @@ opt<bool> TrimDebugInfo("trim-debug-info", cl::desc("Trim debug information in S
 // -enable-per-stage-cache: Enable shader cache per shader stage
 opt<bool> EnablePerStageCache("enable-per-stage-cache", cl::desc("Enable shader cache per shader stage"), init(true));
 
+// -enable-shader-ir-cache: Cache the per-shader LLVM IR after SPIR-V lowering in the shader cache
+opt<bool> EnableShaderIrCache("enable-shader-ir-cache",
+                              cl::desc("Cache per-shader LLVM IR after SPIR-V lowering in the shader cache"),
+                              init(false));
+
+// -enable-spirv-module-cache: Keep parsed SPIR-V modules in the compiler for reuse by later pipelines
+opt<bool> EnableSpirvModuleCache("enable-spirv-module-cache",
+                                 cl::desc("Keep parsed SPIR-V modules for reuse by later pipeline compiles"),
+                                 init(false));
+
+// -spirv-module-cache-size: Maximum number of parsed SPIR-V modules kept by -enable-spirv-module-cache
+opt<unsigned> SpirvModuleCacheSize("spirv-module-cache-size",
+                                   cl::desc("Maximum number of parsed SPIR-V modules kept for reuse"), init(64));
+
+// -pass-stats-file: Write per-pass compile time and IR size statistics as JSON to this file
+static opt<std::string> PassStatsFile("pass-stats-file",
+                                      desc("Write per-pass compile time and IR size statistics as JSON to this file"),
+                                      value_desc("filename"), init(""));
+
+// -trace-dir: Write a Chrome trace-event JSON file of the compile flow per process to this directory
+static opt<std::string> TraceDir("trace-dir",
+                                 desc("Write a Chrome trace-event JSON file of the compile flow per process to this "
+                                      "directory"),
+                                 value_desc("dir"), init(""));
+
+// -parallel-codegen: Generate code for the fragment shader of a graphics pipeline concurrently with the other stages
+static opt<bool> ParallelCodeGen("parallel-codegen",
+                                 desc("Generate code for the fragment shader of a graphics pipeline on a separate "
+                                      "thread, concurrently with the other shader stages"),
+                                 init(false));
+
+// -speculative-compile: Compile likely-needed variants of requested graphics pipelines into the shader cache in the
+// background
+static opt<bool> SpeculativeCompile("speculative-compile",
+                                    desc("Compile likely-needed variants of requested graphics pipelines into the "
+                                         "shader cache on background threads"),
+                                    init(false));
+
+// -speculative-compile-threads: Number of background threads for speculative compiles
+static opt<unsigned> SpeculativeCompileThreads("speculative-compile-threads",
+                                               desc("Number of background threads for speculative compiles"),
+                                               init(1));
+
+// -speculative-compile-budget: Speculative compiles allowed, as a percentage of requested compiles
+static opt<unsigned> SpeculativeCompileBudget("speculative-compile-budget",
+                                              desc("Speculative compiles allowed, as a percentage of requested "
+                                                   "compiles"),
+                                              init(50));
+
+// -speculative-compile-wait: Wait for the speculative compiles queued by a requested compile before returning from it
+static opt<bool> SpeculativeCompileWait("speculative-compile-wait",
+                                        desc("Wait for the speculative compiles queued by a requested compile before "
+                                             "returning from it (for testing)"),
+                                        init(false), Hidden);
+
+// -occupancy-tuning: Recompile pipelines below the target occupancy with tighter register limits, in background
+// compiles
+static opt<bool> OccupancyTuning("occupancy-tuning",
+                                 desc("Recompile pipelines whose occupancy is below -occupancy-target with tighter "
+                                      "register limits, and keep the variant with the best occupancy. Only done in "
+                                      "speculative background compiles, unless -occupancy-tuning-foreground"),
+                                 init(false));
+
+// -occupancy-tuning-foreground: Also do occupancy tuning in requested compiles
+static opt<bool> OccupancyTuningForeground("occupancy-tuning-foreground",
+                                           desc("Also do occupancy tuning in requested compiles"), init(false));
+
+// -occupancy-target: Target waves per SIMD for occupancy tuning
+static opt<unsigned> OccupancyTarget("occupancy-target",
+                                     desc("Target waves per SIMD for occupancy tuning (clamped to the maximum waves "
+                                          "per SIMD of the hardware)"),
+                                     init(4));
+
+extern opt<bool> DisableNullFragShader;
+
 extern opt<bool> EnableOuts;
 
 extern opt<bool> EnableErrs;
@@ -159,9 +241,10 @@ extern opt<std::string> LogFileOuts;
 
 } // namespace llvm
 
-// -use-builder-recorder
+// -use-builder-recorder: with false, the recorder is still used for compiles that need it (see canUseDirectBuilder)
 static cl::opt<bool> UseBuilderRecorder("use-builder-recorder",
-                                        cl::desc("Do lowering via recording and replaying LLPC builder"),
+                                        cl::desc("Do lowering via recording and replaying LLPC builder. If false, the "
+                                                 "recorder is still used for compiles that need it"),
                                         cl::init(true));
 
 namespace Llpc {
@@ -338,6 +421,21 @@ Compiler::Compiler(GfxIpVersion gfxIp, unsigned optionCount, const char *const *
 
   m_shaderCache = ShaderCacheManager::getShaderCacheManager()->getShaderCacheObject(&createInfo, &auxCreateInfo);
 
+  if (cl::EnableSpirvModuleCache)
+    m_spirvModuleCache.reset(new SpirvModuleCache(cl::SpirvModuleCacheSize));
+
+  // Speculative compiles are only useful if their results end up in the internal shader cache.
+  if (cl::SpeculativeCompile && cl::SpeculativeCompileThreads > 0 && cl::ShaderCacheMode != ShaderCacheDisable &&
+      cl::ShaderCacheMode != ShaderCacheEnableOnDiskReadOnly) {
+    m_pipelineSpeculator.reset(
+        new PipelineSpeculator(this, cl::SpeculativeCompileThreads, cl::SpeculativeCompileBudget));
+  }
+
+  if (!cl::PassStatsFile.empty())
+    lgc::PassManager::enablePassStats();
+  if (!cl::TraceDir.empty())
+    lgc::Trace::enable();
+
   ++m_instanceCount;
   ++m_outRedirectCount;
 }
@@ -345,6 +443,17 @@ Compiler::Compiler(GfxIpVersion gfxIp, unsigned optionCount, const char *const *
 // =====================================================================================================================
 Compiler::~Compiler() {
   bool shutdown = false;
+
+  // Stop speculative compiles first, as they use the shader cache and the context pool.
+  if (m_pipelineSpeculator) {
+    if (EnableOuts())
+      m_pipelineSpeculator->writeStats(outs());
+    m_pipelineSpeculator.reset();
+  }
+
+  if (m_spirvModuleCache && EnableOuts())
+    m_spirvModuleCache->writeStats(outs());
+
   {
     // Free context pool
     std::lock_guard<sys::Mutex> lock(m_contextPoolMutex);
@@ -390,6 +499,24 @@ Compiler::~Compiler() {
 
   if (shutdown) {
     ShaderCacheManager::shutdown();
+    if (!cl::PassStatsFile.empty()) {
+      std::error_code errCode;
+      raw_fd_ostream passStatsStream(cl::PassStatsFile, errCode, sys::fs::F_Text);
+      if (!errCode)
+        lgc::PassManager::writePassStats(passStatsStream);
+      else
+        LLPC_ERRS("Fails to open pass statistics file " << cl::PassStatsFile << "\n");
+    }
+    if (lgc::Trace::isEnabled()) {
+      SmallString<256> traceFileName(cl::TraceDir);
+      sys::path::append(traceFileName, Twine("llpc-trace-") + Twine(sys::Process::getProcessId()) + ".json");
+      std::error_code errCode;
+      raw_fd_ostream traceStream(traceFileName, errCode, sys::fs::F_Text);
+      if (!errCode)
+        lgc::Trace::write(traceStream);
+      else
+        LLPC_ERRS("Fails to open trace file " << traceFileName << "\n");
+    }
     llvm_shutdown();
     delete m_contextPool;
     m_contextPool = nullptr;
@@ -408,17 +535,19 @@ void Compiler::Destroy() {
 // @param shaderInfo : Info to build this shader module
 // @param [out] shaderOut : Output of building this shader module
 Result Compiler::BuildShaderModule(const ShaderModuleBuildInfo *shaderInfo, ShaderModuleBuildOut *shaderOut) const {
+  TraceScope traceScope("BuildShaderModule");
   Result result = Result::Success;
   void *allocBuf = nullptr;
   const void *cacheData = nullptr;
   size_t allocSize = 0;
   ShaderModuleDataEx moduleDataEx = {};
   // For trimming debug info
-  uint8_t *trimmedCode = nullptr;
+  bool deferTrim = false;
 
   ElfPackage moduleBinary;
   raw_svector_ostream moduleBinaryStream(moduleBinary);
-  std::vector<ShaderEntryName> entryNames;
+  SpirvScanInfo scanInfo = {};
+  const std::vector<ShaderEntryName> &entryNames = scanInfo.entryNames;
   SmallVector<ShaderModuleEntryData, 4> moduleEntryDatas;
   SmallVector<ShaderModuleEntry, 4> moduleEntries;
   SmallVector<FsOutInfo, 4> fsOutInfos;
@@ -439,20 +568,15 @@ Result Compiler::BuildShaderModule(const ShaderModuleBuildInfo *shaderInfo, Shad
 
   // Check the type of input shader binary
   if (ShaderModuleHelper::isSpirvBinary(&shaderInfo->shaderBin)) {
-    unsigned debugInfoSize = 0;
-
     moduleDataEx.common.binType = BinaryType::Spirv;
-    if (ShaderModuleHelper::verifySpirvBinary(&shaderInfo->shaderBin) != Result::Success) {
+    if (ShaderModuleHelper::scanSpirvBinary(&shaderInfo->shaderBin, &scanInfo) != Result::Success) {
       LLPC_ERRS("Unsupported SPIR-V instructions are found!\n");
       result = Result::Unsupported;
-    }
-    if (result == Result::Success) {
-      ShaderModuleHelper::collectInfoFromSpirvBinary(&shaderInfo->shaderBin, &moduleDataEx.common.usage, entryNames,
-                                                     &debugInfoSize);
-    }
+    } else
+      moduleDataEx.common.usage = scanInfo.usage;
     moduleDataEx.common.binCode.codeSize = shaderInfo->shaderBin.codeSize;
     if (cl::TrimDebugInfo)
-      moduleDataEx.common.binCode.codeSize -= debugInfoSize;
+      moduleDataEx.common.binCode.codeSize -= scanInfo.debugInfoSize;
   } else if (ShaderModuleHelper::isLlvmBitcode(&shaderInfo->shaderBin)) {
     moduleDataEx.common.binType = BinaryType::LlvmBc;
     moduleDataEx.common.binCode = shaderInfo->shaderBin;
@@ -465,26 +589,31 @@ Result Compiler::BuildShaderModule(const ShaderModuleBuildInfo *shaderInfo, Shad
       PipelineDumper::DumpSpirvBinary(cl::PipelineDumpDir.c_str(), &shaderInfo->shaderBin, &hash);
     }
 
-    // Trim debug info
-    if (cl::TrimDebugInfo) {
-      trimmedCode = new uint8_t[moduleDataEx.common.binCode.codeSize];
-      ShaderModuleHelper::trimSpirvDebugInfo(&shaderInfo->shaderBin, moduleDataEx.common.binCode.codeSize, trimmedCode);
-      moduleDataEx.common.binCode.pCode = trimmedCode;
-    } else
-      moduleDataEx.common.binCode.pCode = shaderInfo->shaderBin.pCode;
+    bool enableOpt = cl::EnableShaderModuleOpt;
+    enableOpt = enableOpt || shaderInfo->options.enableOpt;
+    enableOpt = moduleDataEx.common.usage.useSpecConstant ? false : enableOpt;
 
-    // Calculate SPIR-V cache hash
+    // Trim debug info and calculate SPIR-V cache hash. Neither path makes a trimmed copy of the code. If the module is
+    // not translated here, trimming is deferred until the output buffer is allocated, and the trimmed code is written
+    // straight into it. Otherwise only the hash is calculated here, and the translator leaves the debug instructions
+    // out as it reads the original code.
     MetroHash::Hash cacheHash = {};
-    MetroHash64::Hash(reinterpret_cast<const uint8_t *>(moduleDataEx.common.binCode.pCode),
-                      moduleDataEx.common.binCode.codeSize, cacheHash.bytes);
     static_assert(sizeof(moduleDataEx.common.cacheHash) == sizeof(cacheHash), "Unexpected value!");
+    if (cl::TrimDebugInfo) {
+      if (enableOpt) {
+        ShaderModuleHelper::trimSpirvDebugInfo(&shaderInfo->shaderBin, &scanInfo, moduleDataEx.common.binCode.codeSize,
+                                               nullptr, &cacheHash);
+        moduleDataEx.common.binCode = shaderInfo->shaderBin;
+      } else
+        deferTrim = true;
+    } else {
+      moduleDataEx.common.binCode.pCode = shaderInfo->shaderBin.pCode;
+      MetroHash64::Hash(reinterpret_cast<const uint8_t *>(moduleDataEx.common.binCode.pCode),
+                        moduleDataEx.common.binCode.codeSize, cacheHash.bytes);
+    }
     memcpy(moduleDataEx.common.cacheHash, cacheHash.dwords, sizeof(cacheHash));
 
     // Do SPIR-V translate & lower if possible
-    bool enableOpt = cl::EnableShaderModuleOpt;
-    enableOpt = enableOpt || shaderInfo->options.enableOpt;
-    enableOpt = moduleDataEx.common.usage.useSpecConstant ? false : enableOpt;
-
     if (enableOpt) {
       // Check internal cache for shader module build result
       // NOTE: We should not cache non-opt result, we may compile shader module multiple
@@ -532,7 +661,11 @@ Result Compiler::BuildShaderModule(const ShaderModuleBuildInfo *shaderInfo, Shad
           shaderInfo.pModuleData = &moduleDataEx.common;
           shaderInfo.entryStage = entryNames[i].stage;
           shaderInfo.pEntryTarget = entryNames[i].name;
-          lowerPassMgr->add(createSpirvLowerTranslator(static_cast<ShaderStage>(entryNames[i].stage), &shaderInfo));
+          ArrayRef<SpirvWordRange> skipRanges;
+          if (cl::TrimDebugInfo)
+            skipRanges = scanInfo.debugRanges;
+          lowerPassMgr->add(createSpirvLowerTranslator(static_cast<ShaderStage>(entryNames[i].stage), &shaderInfo,
+                                                       nullptr, skipRanges));
           bool collectDetailUsage =
               entryNames[i].stage == ShaderStageFragment || entryNames[i].stage == ShaderStageCompute;
           auto resCollectPass =
@@ -669,14 +802,14 @@ Result Compiler::BuildShaderModule(const ShaderModuleBuildInfo *shaderInfo, Shad
         resNodeData += moduleEntryDatas[i].resNodeDataCount;
       }
 
-      // Copy binary code
-      memcpy(code, moduleDataEx.common.binCode.pCode, moduleDataEx.common.binCode.codeSize);
-      // Destory the temporary module code
-      if (trimmedCode) {
-        delete[] trimmedCode;
-        trimmedCode = nullptr;
-        moduleDataEx.common.binCode.pCode = nullptr;
-      }
+      // Copy binary code, trimming debug info now if it was deferred
+      if (deferTrim) {
+        MetroHash::Hash cacheHash = {};
+        ShaderModuleHelper::trimSpirvDebugInfo(&shaderInfo->shaderBin, &scanInfo, moduleDataEx.common.binCode.codeSize,
+                                               code, &cacheHash);
+        memcpy(moduleDataExCopy->common.cacheHash, cacheHash.dwords, sizeof(cacheHash));
+      } else
+        memcpy(code, moduleDataEx.common.binCode.pCode, moduleDataEx.common.binCode.codeSize);
 
       // Copy fragment shader output variables
       moduleDataExCopy->extra.fsOutInfoCount = fsOutInfos.size();
@@ -707,7 +840,10 @@ Result Compiler::BuildShaderModule(const ShaderModuleBuildInfo *shaderInfo, Shad
 
 // =====================================================================================================================
 // Builds a pipeline by building relocatable elf files and linking them together.  The relocatable elf files will be
-// cached for future use.
+// cached for future use. The pre-rasterization stages (VS, TCS, TES and GS) are built together into one relocatable
+// elf, held in the vertex stage slot, as the interfaces between them are not abstracted. The fragment shader is built
+// into an elf of its own, so that it can be reused with other pre-rasterization stages and vice versa. A graphics
+// pipeline without a fragment shader gets a null fragment shader elf, cached in the same way.
 //
 // @param context : Acquired context
 // @param shaderInfo : Shader info of this pipeline
@@ -722,12 +858,25 @@ Result Compiler::buildPipelineWithRelocatableElf(Context *context, ArrayRef<cons
   unsigned originalShaderStageMask = context->getPipelineContext()->getShaderStageMask();
   context->getLgcContext()->setBuildRelocatableElf(true);
 
+  // Group the stages into the units that are built into one relocatable elf each, keyed by their first stage.
+  unsigned unitStageMasks[ShaderStageNativeStageCount] = {};
+  for (unsigned stage = 0; stage < shaderInfo.size(); ++stage) {
+    if (!shaderInfo[stage] || !shaderInfo[stage]->pModuleData)
+      continue;
+    unsigned unitStage = stage;
+    if (stage != ShaderStageFragment && stage != ShaderStageCompute)
+      unitStage = ShaderStageVertex;
+    unitStageMasks[unitStage] |= shaderStageToMask(static_cast<ShaderStage>(stage));
+  }
+  if (context->isGraphics() && unitStageMasks[ShaderStageFragment] == 0)
+    unitStageMasks[ShaderStageFragment] = shaderStageToMask(ShaderStageFragment);
+
   ElfPackage elf[ShaderStageNativeStageCount];
   for (unsigned stage = 0; stage < shaderInfo.size() && result == Result::Success; ++stage) {
-    if (!shaderInfo[stage] || !shaderInfo[stage]->pModuleData)
+    if (unitStageMasks[stage] == 0)
       continue;
 
-    context->getPipelineContext()->setShaderStageMask(shaderStageToMask(static_cast<ShaderStage>(stage)));
+    context->getPipelineContext()->setShaderStageMask(unitStageMasks[stage]);
 
     // Check the cache for the relocatable shader for this stage.
     MetroHash::Hash cacheHash = {};
@@ -760,12 +909,15 @@ Result Compiler::buildPipelineWithRelocatableElf(Context *context, ArrayRef<cons
     }
 
     // There was a cache miss, so we need to build the relocatable shader for
-    // this stage.
-    const PipelineShaderInfo *singleStageShaderInfo[ShaderStageNativeStageCount] = {nullptr, nullptr, nullptr,
-                                                                                    nullptr, nullptr, nullptr};
-    singleStageShaderInfo[stage] = shaderInfo[stage];
+    // the stages of this unit.
+    const PipelineShaderInfo *unitShaderInfo[ShaderStageNativeStageCount] = {nullptr, nullptr, nullptr,
+                                                                             nullptr, nullptr, nullptr};
+    for (unsigned unitStage = 0; unitStage < shaderInfo.size(); ++unitStage) {
+      if (unitStageMasks[stage] & shaderStageToMask(static_cast<ShaderStage>(unitStage)))
+        unitShaderInfo[unitStage] = shaderInfo[unitStage];
+    }
 
-    result = buildPipelineInternal(context, singleStageShaderInfo, forceLoopUnrollCount, &elf[stage]);
+    result = buildPipelineInternal(context, unitShaderInfo, forceLoopUnrollCount, &elf[stage]);
 
     // Add the result to the cache.
     if (result == Result::Success) {
@@ -791,15 +943,13 @@ bool Compiler::canUseRelocatableGraphicsShaderElf(const ArrayRef<const PipelineS
   if (!cl::UseRelocatableShaderElf)
     return false;
 
-  bool useRelocatableShaderElf = true;
-  for (unsigned stage = 0; stage < shaderInfo.size(); ++stage) {
-    if (stage != ShaderStageVertex && stage != ShaderStageFragment) {
-      if (shaderInfo[stage] && shaderInfo[stage]->pModuleData)
-        useRelocatableShaderElf = false;
-    } else if (!shaderInfo[stage] || !shaderInfo[stage]->pModuleData) {
-      // TODO: Generate pass-through shaders when the fragment or vertex shaders are missing.
+  // NOTE: Tessellation and geometry shaders are allowed, as they are built together with the vertex shader. A missing
+  // fragment shader is allowed, as a null fragment shader is built in its place, unless the standalone compiler has
+  // disabled that. A vertex shader is required.
+  bool useRelocatableShaderElf = shaderInfo[ShaderStageVertex] && shaderInfo[ShaderStageVertex]->pModuleData;
+  if (!shaderInfo[ShaderStageFragment] || !shaderInfo[ShaderStageFragment]->pModuleData) {
+    if (cl::DisableNullFragShader)
       useRelocatableShaderElf = false;
-    }
   }
 
   if (useRelocatableShaderElf && shaderInfo[0]) {
@@ -843,6 +993,73 @@ bool Compiler::canUseRelocatableComputeShaderElf(const PipelineShaderInfo *shade
   return useRelocatableShaderElf;
 }
 
+// =====================================================================================================================
+// Returns true if the front-end can call BuilderImpl directly when translating the shaders of the pipeline to be
+// built with -use-builder-recorder=false, rather than recording Builder calls for BuilderReplayer to replay in the
+// middle-end. That needs all pipeline state used by BuilderImpl to be known before translation, which it is for a
+// whole-pipeline compile from SPIR-V. A relocatable compile does not know the pipeline state until link time, and IR
+// input was already recorded by an earlier shader module compile. The shader IR cache needs the recorder too, so the
+// cached IR does not depend on pipeline state.
+//
+// @param shaderInfo : Shader info for the pipeline to be built
+// @param buildingRelocatableElf : Whether the pipeline is built as relocatable shader ELFs
+bool Compiler::canUseDirectBuilder(ArrayRef<const PipelineShaderInfo *> shaderInfo,
+                                   bool buildingRelocatableElf) const {
+  if (buildingRelocatableElf || cl::EnableShaderIrCache)
+    return false;
+
+  for (const PipelineShaderInfo *shaderInfoEntry : shaderInfo) {
+    if (!shaderInfoEntry || !shaderInfoEntry->pModuleData)
+      continue;
+    const ShaderModuleData *moduleData = reinterpret_cast<const ShaderModuleData *>(shaderInfoEntry->pModuleData);
+    if (moduleData->binType != BinaryType::Spirv)
+      return false;
+  }
+  return true;
+}
+
+// =====================================================================================================================
+// Returns true if the pipeline being built is to be tuned for occupancy by recompiling it (see OccupancyTuner). As
+// that multiplies the compile time, it is only done in speculative background compiles unless asked for otherwise.
+// A relocatable compile is not tuned, as its register usage is only known once linked.
+//
+// @param buildingRelocatableElf : Whether the pipeline is built as relocatable shader ELFs
+bool Compiler::canTuneOccupancy(bool buildingRelocatableElf) const {
+  if (!cl::OccupancyTuning || cl::OccupancyTarget == 0 || buildingRelocatableElf)
+    return false;
+  return PipelineSpeculator::isSpeculating() || cl::OccupancyTuningForeground;
+}
+
+// =====================================================================================================================
+// Tune a compiled pipeline for occupancy, if it is to be tuned (see canTuneOccupancy). Each variant is compiled in a
+// new pipeline context with the register tuning of the variant. This is common code for graphics and compute.
+//
+// @param buildingRelocatableElf : Whether the pipeline is built as relocatable shader ELFs
+// @param createContext : Callback to create a new pipeline context for the pipeline
+// @param shaderInfo : Shader info of this pipeline
+// @param forceLoopUnrollCount : Force loop unroll count (0 means disable)
+// @param [in/out] pipelineElf : Pipeline ELF, replaced by the chosen variant, if any
+void Compiler::tuneOccupancy(bool buildingRelocatableElf,
+                             function_ref<std::unique_ptr<PipelineContext>()> createContext,
+                             ArrayRef<const PipelineShaderInfo *> shaderInfo, unsigned forceLoopUnrollCount,
+                             ElfPackage *pipelineElf) {
+  if (!canTuneOccupancy(buildingRelocatableElf))
+    return;
+  TraceScope tuneTraceScope("OccupancyTuning");
+  OccupancyTuner tuner(m_gfxIp, cl::OccupancyTarget);
+  tuner.tune(
+      [&](const RegisterTuning &tuning, ElfPackage *variantElf) {
+        std::unique_ptr<PipelineContext> variantContext = createContext();
+        variantContext->setRegisterTuning(tuning);
+        Context *context = acquireContext();
+        context->attachPipelineContext(variantContext.get());
+        Result result = buildPipelineInternal(context, shaderInfo, forceLoopUnrollCount, variantElf);
+        releaseContext(context);
+        return result;
+      },
+      pipelineElf);
+}
+
 // =====================================================================================================================
 // Build pipeline internally -- common code for graphics and compute
 //
@@ -874,7 +1091,8 @@ Result Compiler::buildPipelineInternal(Context *context, ArrayRef<const Pipeline
   LgcContext *builderContext = context->getLgcContext();
   std::unique_ptr<Pipeline> pipeline(builderContext->createPipeline());
   context->getPipelineContext()->setPipelineState(&*pipeline);
-  context->setBuilder(builderContext->createBuilder(&*pipeline, UseBuilderRecorder));
+  bool useBuilderRecorder = UseBuilderRecorder || !canUseDirectBuilder(shaderInfo, buildingRelocatableElf);
+  context->setBuilder(builderContext->createBuilder(&*pipeline, useBuilderRecorder));
 
   std::unique_ptr<Module> pipelineModule;
 
@@ -893,6 +1111,11 @@ Result Compiler::buildPipelineInternal(Context *context, ArrayRef<const Pipeline
   // If not IR input, run the per-shader passes, including SPIR-V translation, and then link the modules
   // into a single pipeline module.
   if (pipelineModule == nullptr) {
+    // NOTE: The lowered IR only depends on the pipeline state if the front-end calls BuilderImpl directly.
+    bool useShaderIrCache = cl::EnableShaderIrCache && useBuilderRecorder;
+    std::vector<ShaderCache *> irCaches(shaderInfo.size());
+    std::vector<CacheEntryHandle> hIrEntries(shaderInfo.size());
+
     // Create empty modules and set target machine in each.
     std::vector<Module *> modules(shaderInfo.size());
     unsigned stageSkipMask = 0;
@@ -935,9 +1158,31 @@ Result Compiler::buildPipelineInternal(Context *context, ArrayRef<const Pipeline
 
         timerProfiler.startStopTimer(TimerLoadBc, false);
       } else {
-        module = new Module((Twine("llpc") + getShaderStageName(shaderInfoEntry->entryStage)).str() +
-                                std::to_string(getModuleIdByIndex(shaderIndex)),
-                            *context);
+        if (useShaderIrCache && moduleDataEx->common.binType == BinaryType::Spirv) {
+          // Restore the lowered IR of this shader if an earlier pipeline compile cached it.
+          MetroHash::Hash irCacheHash = {};
+          buildShaderIrCacheHash(context, shaderInfoEntry, forceLoopUnrollCount, &irCacheHash);
+          BinaryData irBin = {};
+          ShaderEntryState irCacheEntryState =
+              lookUpShaderCaches(nullptr, &irCacheHash, &irBin, &irCaches[shaderIndex], &hIrEntries[shaderIndex]);
+          if (irCacheEntryState == ShaderEntryState::Ready) {
+            hIrEntries[shaderIndex] = nullptr;
+            timerProfiler.startStopTimer(TimerIrCache, true);
+            module = context->loadLibary(&irBin).release();
+            timerProfiler.startStopTimer(TimerIrCache, false);
+            if (module) {
+              LLPC_OUTS("Shader IR cache hit: " << getShaderStageAbbreviation(shaderInfoEntry->entryStage, true)
+                                                << "\n");
+              stageSkipMask |= (1 << shaderIndex);
+            }
+          }
+        }
+
+        if (!module) {
+          module = new Module((Twine("llpc") + getShaderStageName(shaderInfoEntry->entryStage)).str() +
+                                  std::to_string(getModuleIdByIndex(shaderIndex)),
+                              *context);
+        }
       }
 
       modules[shaderIndex] = module;
@@ -958,12 +1203,13 @@ Result Compiler::buildPipelineInternal(Context *context, ArrayRef<const Pipeline
 
       // Set the shader stage in the Builder.
       context->getBuilder()->setShaderStage(getLgcShaderStage(entryStage));
+      TraceScope translateTraceScope("Translate");
 
       // Start timer for translate.
       timerProfiler.addTimerStartStopPass(&*lowerPassMgr, TimerTranslate, true);
 
       // SPIR-V translation, then dump the result.
-      lowerPassMgr->add(createSpirvLowerTranslator(entryStage, shaderInfoEntry));
+      lowerPassMgr->add(createSpirvLowerTranslator(entryStage, shaderInfoEntry, m_spirvModuleCache.get()));
       if (EnableOuts()) {
         lowerPassMgr->add(createPrintModulePass(
             outs(), "\n"
@@ -988,11 +1234,12 @@ Result Compiler::buildPipelineInternal(Context *context, ArrayRef<const Pipeline
         continue;
 
       context->getBuilder()->setShaderStage(getLgcShaderStage(entryStage));
+      TraceScope lowerTraceScope("Lower");
       std::unique_ptr<lgc::PassManager> lowerPassMgr(lgc::PassManager::Create());
       lowerPassMgr->setPassIndex(&passIndex);
 
       SpirvLower::addPasses(context, entryStage, *lowerPassMgr, timerProfiler.getTimer(TimerLower),
-                            forceLoopUnrollCount);
+                            forceLoopUnrollCount, context->getPipelineContext()->getPipelineOptions()->fastCompile);
       // Run the passes.
       bool success = runPasses(&*lowerPassMgr, modules[shaderIndex]);
       if (!success) {
@@ -1001,8 +1248,40 @@ Result Compiler::buildPipelineInternal(Context *context, ArrayRef<const Pipeline
       }
     }
 
+    // Store the lowered IR of the shaders that missed in the shader IR cache, or release the cache entries if the
+    // compile failed.
+    for (unsigned shaderIndex = 0; shaderIndex < shaderInfo.size(); ++shaderIndex) {
+      if (!hIrEntries[shaderIndex])
+        continue;
+
+      SmallVector<char, 0> irBitcode;
+      if (result == Result::Success) {
+        // The shader modes are held in the pipeline state, so copy them into the IR of this shader to go with it.
+        context->getBuilder()->setShaderStage(getLgcShaderStage(shaderInfo[shaderIndex]->entryStage));
+        context->getBuilder()->recordCurrentShaderModes(modules[shaderIndex]);
+        raw_svector_ostream irBitcodeStream(irBitcode);
+        WriteBitcodeToFile(*modules[shaderIndex], irBitcodeStream);
+      }
+      BinaryData irBin = {irBitcode.size(), irBitcode.data()};
+      updateShaderCache(result == Result::Success, &irBin, irCaches[shaderIndex], hIrEntries[shaderIndex]);
+    }
+
+    // When building the relocatable null fragment shader of a pipeline without a fragment shader, there is no shader
+    // module. Give the link an empty one; the null fragment shader is generated into it when patching.
+    if (result == Result::Success && buildingRelocatableElf && shaderInfo.size() > ShaderStageFragment &&
+        !modules[ShaderStageFragment] &&
+        context->getPipelineContext()->getShaderStageMask() == shaderStageToMask(ShaderStageFragment)) {
+      modules[ShaderStageFragment] = new Module(
+          (Twine("llpc") + getShaderStageName(ShaderStageFragment)).str() +
+              std::to_string(getModuleIdByIndex(ShaderStageFragment)),
+          *context);
+      context->setModuleTargetMachine(modules[ShaderStageFragment]);
+    }
+
     // Link the shader modules into a single pipeline module.
+    TraceScope linkTraceScope("Link");
     pipelineModule.reset(pipeline->link(modules));
+    linkTraceScope.end();
     if (pipelineModule == nullptr) {
       LLPC_ERRS("Failed to link shader modules into pipeline module\n");
       result = Result::ErrorInvalidShader;
@@ -1022,14 +1301,22 @@ Result Compiler::buildPipelineInternal(Context *context, ArrayRef<const Pipeline
       ) { return graphicsShaderCacheChecker.check(module, stageMask, stageHashes); };
 
   // Only enable per stage cache for full graphic pipeline
+  // The per-stage cache hashes do not include the register tuning, so a tuned variant must not use it.
   bool checkPerStageCache =
       cl::EnablePerStageCache && context->isGraphics() && !buildingRelocatableElf &&
+      !context->getPipelineContext()->hasRegisterTuning() &&
       (context->getShaderStageMask() & (shaderStageToMask(ShaderStageVertex) | shaderStageToMask(ShaderStageFragment)));
   if (!checkPerStageCache)
     checkShaderCacheFunc = nullptr;
 
-  // Generate pipeline.
+  // Generate pipeline. In parallel code generation mode, the fragment shader ELF may be generated separately, and is
+  // then merged into the pipeline ELF.
   raw_svector_ostream elfStream(*pipelineElf);
+  ElfPackage fragmentElf;
+  raw_svector_ostream fragmentElfStream(fragmentElf);
+  raw_pwrite_stream *fragmentOutStream = nullptr;
+  if (cl::ParallelCodeGen && context->isGraphics() && !buildingRelocatableElf)
+    fragmentOutStream = &fragmentElfStream;
 
   if (result == Result::Success) {
     result = Result::ErrorInvalidShader;
@@ -1043,7 +1330,8 @@ Result Compiler::buildPipelineInternal(Context *context, ArrayRef<const Pipeline
           timerProfiler.getTimer(TimerCodeGen),
       };
 
-      pipeline->generate(std::move(pipelineModule), elfStream, checkShaderCacheFunc, timers);
+      TraceScope generateTraceScope("Generate");
+      pipeline->generate(std::move(pipelineModule), elfStream, checkShaderCacheFunc, timers, fragmentOutStream);
       result = Result::Success;
     }
 #if LLPC_ENABLE_EXCEPTION
@@ -1052,6 +1340,21 @@ Result Compiler::buildPipelineInternal(Context *context, ArrayRef<const Pipeline
 #endif
   }
 
+  if (result == Result::Success && !fragmentElf.empty()) {
+    ElfPackage nonFragmentElf = std::move(*pipelineElf);
+    pipelineElf->clear();
+
+    BinaryData fragmentElfData = {};
+    fragmentElfData.codeSize = fragmentElf.size();
+    fragmentElfData.pCode = fragmentElf.data();
+
+    ElfWriter<Elf64> writer(context->getGfxIpVersion());
+    auto readResult = writer.ReadFromBuffer(nonFragmentElf.data(), nonFragmentElf.size());
+    assert(readResult == Result::Success);
+    (void(readResult)); // unused
+    writer.mergeElfBinary(context, &fragmentElfData, pipelineElf);
+  }
+
   if (checkPerStageCache) {
     // For graphics, update shader caches with results of compile, and merge ELF outputs if necessary.
     graphicsShaderCacheChecker.updateAndMerge(result, pipelineElf);
@@ -1096,6 +1399,11 @@ unsigned GraphicsShaderCacheChecker::check(const Module *module, unsigned stageM
                                                                   &m_nonFragmentShaderCache, &m_hNonFragmentEntry);
   }
 
+  if (m_fragmentCacheEntryState == ShaderEntryState::Ready)
+    LLPC_OUTS("Per-stage shader cache hit: fragment stage\n");
+  if (m_nonFragmentCacheEntryState == ShaderEntryState::Ready)
+    LLPC_OUTS("Per-stage shader cache hit: non-fragment stages\n");
+
   if (m_nonFragmentCacheEntryState != ShaderEntryState::Compiling) {
     // Remove non-fragment shader stages.
     stageMask &= shaderStageToMask(ShaderStageFragment);
@@ -1217,7 +1525,9 @@ Result Compiler::buildGraphicsPipelineInternal(GraphicsContext *graphicsContext,
                                                ArrayRef<const PipelineShaderInfo *> shaderInfo,
                                                unsigned forceLoopUnrollCount, bool buildingRelocatableElf,
                                                ElfPackage *pipelineElf) {
+  TraceScope acquireTraceScope("AcquireContext");
   Context *context = acquireContext();
+  acquireTraceScope.end();
   context->attachPipelineContext(graphicsContext);
 
   Result result = Result::Success;
@@ -1229,6 +1539,16 @@ Result Compiler::buildGraphicsPipelineInternal(GraphicsContext *graphicsContext,
   return result;
 }
 
+// =====================================================================================================================
+// Record the per-pass statistics of the pipeline just compiled on this thread under the pipeline hash.
+//
+// @param pipelineHash : Pipeline hash
+static void finishPipelinePassStats(const MetroHash::Hash *pipelineHash) {
+  std::string pipelineName;
+  raw_string_ostream(pipelineName) << format("0x%016" PRIX64, MetroHash::compact64(pipelineHash));
+  lgc::PassManager::finishPipelinePassStats(pipelineName);
+}
+
 // =====================================================================================================================
 // Build graphics pipeline from the specified info.
 //
@@ -1237,6 +1557,7 @@ Result Compiler::buildGraphicsPipelineInternal(GraphicsContext *graphicsContext,
 // @param pipelineDumpFile : Handle of pipeline dump file
 Result Compiler::BuildGraphicsPipeline(const GraphicsPipelineBuildInfo *pipelineInfo,
                                        GraphicsPipelineBuildOut *pipelineOut, void *pipelineDumpFile) {
+  TraceScope traceScope("BuildGraphicsPipeline");
   Result result = Result::Success;
   BinaryData elfBin = {};
 
@@ -1285,9 +1606,18 @@ Result Compiler::BuildGraphicsPipeline(const GraphicsPipelineBuildInfo *pipeline
   ShaderCache *shaderCache = nullptr;
   CacheEntryHandle hEntry = nullptr;
 
-  if (!buildingRelocatableElf)
+  // Let the speculator learn from the requested pipeline and queue compiles of predicted variants. Background
+  // compiles are held off until this build is done.
+  bool speculate = m_pipelineSpeculator && !PipelineSpeculator::isSpeculating() && !buildingRelocatableElf &&
+                   result == Result::Success;
+  PipelineSpeculator::Prediction prediction = PipelineSpeculator::Prediction::Unrelated;
+  if (speculate)
+    prediction = m_pipelineSpeculator->beginBuild(pipelineInfo, MetroHash::compact64(&pipelineHash));
+
+  if (!buildingRelocatableElf) {
+    TraceScope cacheTraceScope("CacheLookup");
     cacheEntryState = lookUpShaderCaches(appCache, &cacheHash, &elfBin, &shaderCache, &hEntry);
-  else
+  } else
     cacheEntryState = ShaderEntryState::Compiling;
 
   ElfPackage candidateElf;
@@ -1299,6 +1629,15 @@ Result Compiler::BuildGraphicsPipeline(const GraphicsPipelineBuildInfo *pipeline
     result = buildGraphicsPipelineInternal(&graphicsContext, shaderInfo, forceLoopUnrollCount, buildingRelocatableElf,
                                            &candidateElf);
 
+    if (result == Result::Success) {
+      tuneOccupancy(
+          buildingRelocatableElf,
+          [&] { return std::make_unique<GraphicsContext>(m_gfxIp, pipelineInfo, &pipelineHash, &cacheHash); },
+          shaderInfo, forceLoopUnrollCount, &candidateElf);
+    }
+    if (lgc::PassManager::isPassStatsEnabled())
+      finishPipelinePassStats(&pipelineHash);
+
     if (result == Result::Success) {
       elfBin.codeSize = candidateElf.size();
       elfBin.pCode = candidateElf.data();
@@ -1308,7 +1647,14 @@ Result Compiler::BuildGraphicsPipeline(const GraphicsPipelineBuildInfo *pipeline
       updateShaderCache((result == Result::Success), &elfBin, shaderCache, hEntry);
   }
 
+  if (speculate) {
+    m_pipelineSpeculator->endBuild(prediction, cacheEntryState == ShaderEntryState::Compiling);
+    if (cl::SpeculativeCompileWait)
+      m_pipelineSpeculator->waitForIdle();
+  }
+
   if (result == Result::Success) {
+    TraceScope outputTraceScope("OutputCopy");
     void *allocBuf = nullptr;
     if (pipelineInfo->pfnOutputAlloc)
       allocBuf = pipelineInfo->pfnOutputAlloc(pipelineInfo->pInstance, pipelineInfo->pUserData, elfBin.codeSize);
@@ -1339,7 +1685,9 @@ Result Compiler::buildComputePipelineInternal(ComputeContext *computeContext,
                                               const ComputePipelineBuildInfo *pipelineInfo,
                                               unsigned forceLoopUnrollCount, bool buildingRelocatableElf,
                                               ElfPackage *pipelineElf) {
+  TraceScope acquireTraceScope("AcquireContext");
   Context *context = acquireContext();
+  acquireTraceScope.end();
   context->attachPipelineContext(computeContext);
 
   const PipelineShaderInfo *shaderInfo[ShaderStageNativeStageCount] = {
@@ -1363,6 +1711,7 @@ Result Compiler::buildComputePipelineInternal(ComputeContext *computeContext,
 // @param pipelineDumpFile : Handle of pipeline dump file
 Result Compiler::BuildComputePipeline(const ComputePipelineBuildInfo *pipelineInfo,
                                       ComputePipelineBuildOut *pipelineOut, void *pipelineDumpFile) {
+  TraceScope traceScope("BuildComputePipeline");
   BinaryData elfBin = {};
 
   bool buildingRelocatableElf = canUseRelocatableComputeShaderElf(&pipelineInfo->cs);
@@ -1402,9 +1751,10 @@ Result Compiler::BuildComputePipeline(const ComputePipelineBuildInfo *pipelineIn
   ShaderCache *shaderCache = nullptr;
   CacheEntryHandle hEntry = nullptr;
 
-  if (!buildingRelocatableElf)
+  if (!buildingRelocatableElf) {
+    TraceScope cacheTraceScope("CacheLookup");
     cacheEntryState = lookUpShaderCaches(appCache, &cacheHash, &elfBin, &shaderCache, &hEntry);
-  else
+  } else
     cacheEntryState = ShaderEntryState::Compiling;
 
   ElfPackage candidateElf;
@@ -1417,6 +1767,18 @@ Result Compiler::BuildComputePipeline(const ComputePipelineBuildInfo *pipelineIn
     result = buildComputePipelineInternal(&computeContext, pipelineInfo, forceLoopUnrollCount, buildingRelocatableElf,
                                           &candidateElf);
 
+    if (result == Result::Success) {
+      const PipelineShaderInfo *shaderInfo[ShaderStageNativeStageCount] = {
+          nullptr, nullptr, nullptr, nullptr, nullptr, &pipelineInfo->cs,
+      };
+      tuneOccupancy(
+          buildingRelocatableElf,
+          [&] { return std::make_unique<ComputeContext>(m_gfxIp, pipelineInfo, &pipelineHash, &cacheHash); },
+          shaderInfo, forceLoopUnrollCount, &candidateElf);
+    }
+    if (lgc::PassManager::isPassStatsEnabled())
+      finishPipelinePassStats(&pipelineHash);
+
     if (result == Result::Success) {
       elfBin.codeSize = candidateElf.size();
       elfBin.pCode = candidateElf.data();
@@ -1426,6 +1788,7 @@ Result Compiler::BuildComputePipeline(const ComputePipelineBuildInfo *pipelineIn
   }
 
   if (result == Result::Success) {
+    TraceScope outputTraceScope("OutputCopy");
     void *allocBuf = nullptr;
     if (pipelineInfo->pfnOutputAlloc) {
       allocBuf = pipelineInfo->pfnOutputAlloc(pipelineInfo->pInstance, pipelineInfo->pUserData, elfBin.codeSize);
@@ -1456,7 +1819,9 @@ MetroHash::Hash Compiler::generateHashForCompileOptions(unsigned optionCount, co
   static StringRef IgnoredOptions[] = {
       cl::PipelineDumpDir.ArgStr, cl::EnablePipelineDump.ArgStr, cl::ShaderCacheFileDir.ArgStr,
       cl::ShaderCacheMode.ArgStr, cl::EnableOuts.ArgStr,         cl::EnableErrs.ArgStr,
-      cl::LogFileDbgs.ArgStr,     cl::LogFileOuts.ArgStr,        cl::ExecutableName.ArgStr};
+      cl::LogFileDbgs.ArgStr,     cl::LogFileOuts.ArgStr,        cl::ExecutableName.ArgStr,
+      cl::PassStatsFile.ArgStr,   cl::TraceDir.ArgStr,           cl::SpeculativeCompile.ArgStr,
+      cl::SpeculativeCompileThreads.ArgStr, cl::SpeculativeCompileBudget.ArgStr, cl::SpeculativeCompileWait.ArgStr};
 
   std::set<StringRef> effectingOptions;
   // Build effecting options
@@ -1719,13 +2084,11 @@ void Compiler::buildShaderCacheHash(Context *context, unsigned stageMask, ArrayR
     PipelineDumper::updateHashForPipelineShaderInfo(stage, shaderInfo, true, &hasher, false);
     hasher.Update(pipelineInfo->iaState.deviceIndex);
 
-    // Update input/output usage (provided by middle-end caller of this callback).
+    // Update input/output usage (provided by middle-end caller of this callback). This includes the vertex input
+    // descriptions of the vertex inputs read by the vertex shader, and the color export formats of the outputs
+    // written by the fragment shader, so the rest of that state is left out of the hash.
     hasher.Update(stageHashes[stage].data(), stageHashes[stage].size());
 
-    // Update vertex input state
-    if (stage == ShaderStageVertex)
-      PipelineDumper::updateHashForVertexInputState(pipelineInfo->pVertexInput, &hasher);
-
     MetroHash::Hash hash = {};
     hasher.Finalize(hash.bytes);
 
@@ -1745,7 +2108,8 @@ void Compiler::buildShaderCacheHash(Context *context, unsigned stageMask, ArrayR
     fragmentHasher.Update(pipelineOptions->reconfigWorkgroupLayout);
     fragmentHasher.Update(pipelineOptions->includeIr);
     fragmentHasher.Update(pipelineOptions->robustBufferAccess);
-    PipelineDumper::updateHashForFragmentState(pipelineInfo, &fragmentHasher);
+    fragmentHasher.Update(pipelineOptions->fastCompile);
+    PipelineDumper::updateHashForFragmentState(pipelineInfo, &fragmentHasher, /*excludeColorTargets=*/true);
     fragmentHasher.Finalize(fragmentHash->bytes);
   }
 
@@ -1755,6 +2119,53 @@ void Compiler::buildShaderCacheHash(Context *context, unsigned stageMask, ArrayR
   }
 }
 
+// =====================================================================================================================
+// Builds the hash code for the per-shader LLVM IR cache. It covers the shader and the subset of the pipeline and
+// shader options that the SPIR-V translation and lowering passes consume.
+//
+// @param context : Acquired context
+// @param shaderInfo : Shader info for this shader
+// @param forceLoopUnrollCount : Force loop unroll count (0 means disable)
+// @param [out] hash : Hash code of the lowered shader IR
+void Compiler::buildShaderIrCacheHash(Context *context, const PipelineShaderInfo *shaderInfo,
+                                      unsigned forceLoopUnrollCount, MetroHash::Hash *hash) {
+  static const char IrCacheTag[] = "ShaderIr";
+  MetroHash64 hasher;
+  hasher.Update(reinterpret_cast<const uint8_t *>(IrCacheTag), sizeof(IrCacheTag));
+
+  const ShaderModuleData *moduleData = reinterpret_cast<const ShaderModuleData *>(shaderInfo->pModuleData);
+  hasher.Update(shaderInfo->entryStage);
+  hasher.Update(reinterpret_cast<const uint8_t *>(moduleData->cacheHash), sizeof(moduleData->cacheHash));
+
+  size_t entryNameLen = shaderInfo->pEntryTarget ? strlen(shaderInfo->pEntryTarget) : 0;
+  hasher.Update(entryNameLen);
+  hasher.Update(reinterpret_cast<const uint8_t *>(shaderInfo->pEntryTarget), entryNameLen);
+
+  auto specializationInfo = shaderInfo->pSpecializationInfo;
+  unsigned mapEntryCount = specializationInfo ? specializationInfo->mapEntryCount : 0;
+  hasher.Update(mapEntryCount);
+  if (mapEntryCount > 0) {
+    hasher.Update(reinterpret_cast<const uint8_t *>(specializationInfo->pMapEntries),
+                  sizeof(VkSpecializationMapEntry) * specializationInfo->mapEntryCount);
+    hasher.Update(specializationInfo->dataSize);
+    hasher.Update(reinterpret_cast<const uint8_t *>(specializationInfo->pData), specializationInfo->dataSize);
+  }
+
+  // Options read by SpirvLowerLoopUnrollControl
+  hasher.Update(forceLoopUnrollCount);
+  hasher.Update(shaderInfo->options.forceLoopUnrollCount);
+#if LLPC_CLIENT_INTERFACE_MAJOR_VERSION >= 35
+  hasher.Update(shaderInfo->options.disableLicm);
+#endif
+
+  // Pipeline options that the front-end uses (see Compiler::buildPipelineInternal)
+  hasher.Update(context->getScalarBlockLayout());
+  hasher.Update(context->getRobustBufferAccess());
+  hasher.Update(context->getPipelineContext()->getPipelineOptions()->fastCompile);
+
+  hasher.Finalize(hash->bytes);
+}
+
 // =====================================================================================================================
 // Link relocatable shader elf file into a pipeline elf file and apply relocations.
 //
@@ -1762,9 +2173,10 @@ void Compiler::buildShaderCacheHash(Context *context, unsigned stageMask, ArrayR
 // @param [out] pipelineElf : Elf package containing the pipeline elf
 // @param context : Acquired context
 void Compiler::linkRelocatableShaderElf(ElfPackage *shaderElfs, ElfPackage *pipelineElf, Context *context) {
-  assert(shaderElfs[ShaderStageTessControl].empty() && "Cannot link tessellation shaders yet.");
-  assert(shaderElfs[ShaderStageTessEval].empty() && "Cannot link tessellation shaders yet.");
-  assert(shaderElfs[ShaderStageGeometry].empty() && "Cannot link geometry shaders yet.");
+  // The tessellation and geometry shaders are in the elf of the vertex stage.
+  assert(shaderElfs[ShaderStageTessControl].empty() && "Tessellation shaders must be built with the vertex shader.");
+  assert(shaderElfs[ShaderStageTessEval].empty() && "Tessellation shaders must be built with the vertex shader.");
+  assert(shaderElfs[ShaderStageGeometry].empty() && "Geometry shaders must be built with the vertex shader.");
 
   Result result = Result::Success;
   ElfWriter<Elf64> writer(m_gfxIp);
@@ -36,6 +36,7 @@
 #include "vkgcElfReader.h"
 #include "vkgcMetroHash.h"
 #include "lgc/CommonDefs.h"
+#include "llvm/ADT/STLExtras.h"
 
 namespace llvm {
 
@@ -59,6 +60,9 @@ class Compiler;
 class ComputeContext;
 class Context;
 class GraphicsContext;
+class PipelineContext;
+class PipelineSpeculator;
+class SpirvModuleCache;
 
 // =====================================================================================================================
 // Object to manage checking and updating shader cache for graphics pipeline.
@@ -147,6 +151,9 @@ public:
                                    llvm::ArrayRef<llvm::ArrayRef<uint8_t>> stageHashes, MetroHash::Hash *fragmentHash,
                                    MetroHash::Hash *nonFragmentHash);
 
+  static void buildShaderIrCacheHash(Context *context, const PipelineShaderInfo *shaderInfo,
+                                     unsigned forceLoopUnrollCount, MetroHash::Hash *hash);
+
 private:
   Compiler() = delete;
   Compiler(const Compiler &) = delete;
@@ -161,17 +168,24 @@ private:
   void linkRelocatableShaderElf(ElfPackage *shaderElfs, ElfPackage *pipelineElf, Context *context);
   bool canUseRelocatableGraphicsShaderElf(const llvm::ArrayRef<const PipelineShaderInfo *> &shaderInfo) const;
   bool canUseRelocatableComputeShaderElf(const PipelineShaderInfo *shaderInfo) const;
+  bool canUseDirectBuilder(llvm::ArrayRef<const PipelineShaderInfo *> shaderInfo, bool buildingRelocatableElf) const;
+  bool canTuneOccupancy(bool buildingRelocatableElf) const;
+  void tuneOccupancy(bool buildingRelocatableElf, llvm::function_ref<std::unique_ptr<PipelineContext>()> createContext,
+                     llvm::ArrayRef<const PipelineShaderInfo *> shaderInfo, unsigned forceLoopUnrollCount,
+                     ElfPackage *pipelineElf);
 
   // -----------------------------------------------------------------------------------------------------------------
 
-  std::vector<std::string> m_options;           // Compilation options
-  MetroHash::Hash m_optionHash;                 // Hash code of compilation options
-  GfxIpVersion m_gfxIp;                         // Graphics IP version info
-  static unsigned m_instanceCount;              // The count of compiler instance
-  static unsigned m_outRedirectCount;           // The count of output redirect
-  ShaderCachePtr m_shaderCache;                 // Shader cache
-  static llvm::sys::Mutex m_contextPoolMutex;   // Mutex for context pool access
-  static std::vector<Context *> *m_contextPool; // Context pool
+  std::vector<std::string> m_options;                       // Compilation options
+  MetroHash::Hash m_optionHash;                             // Hash code of compilation options
+  GfxIpVersion m_gfxIp;                                     // Graphics IP version info
+  static unsigned m_instanceCount;                          // The count of compiler instance
+  static unsigned m_outRedirectCount;                       // The count of output redirect
+  ShaderCachePtr m_shaderCache;                             // Shader cache
+  std::unique_ptr<SpirvModuleCache> m_spirvModuleCache;     // Cache of parsed SPIR-V modules (optional)
+  std::unique_ptr<PipelineSpeculator> m_pipelineSpeculator; // Speculative compiler of pipeline variants (optional)
+  static llvm::sys::Mutex m_contextPoolMutex;               // Mutex for context pool access
+  static std::vector<Context *> *m_contextPool;             // Context pool
 };
 
 // Convert front-end LLPC shader stage to middle-end LGC shader stage
@@ -0,0 +1,278 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  llpcOccupancyTuner.cpp
+ * @brief LLPC source file: contains implementation of class Llpc::OccupancyTuner.
+ ***********************************************************************************************************************
+ */
+#include "llpcOccupancyTuner.h"
+#include "llpcDebug.h"
+#include "vkgcElfReader.h"
+#include "llvm/BinaryFormat/MsgPackDocument.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+
+#define DEBUG_TYPE "llpc-occupancy-tuner"
+
+using namespace llvm;
+using namespace Vkgc;
+
+namespace Llpc {
+
+// The names of hardware shader stages used in PAL metadata, in Util::Abi::HardwareStage order.
+static const char *const HwStageNames[] = {".ls", ".hs", ".es", ".gs", ".vs", ".ps", ".cs"};
+
+// Maximum number of VGPRs a wave can use
+static const unsigned MaxVgprsPerWave = 256;
+
+// =====================================================================================================================
+//
+// @param gfxIp : Graphics IP version info
+// @param targetWaves : Target waves per SIMD
+OccupancyTuner::OccupancyTuner(GfxIpVersion gfxIp, unsigned targetWaves) : m_gfxIp(gfxIp), m_targetWaves(targetWaves) {
+}
+
+// =====================================================================================================================
+// Tune the register usage of a compiled pipeline for occupancy. The target is clamped to the maximum waves per SIMD
+// of the hardware stages. If any hardware stage of the pipeline is below the target occupancy, the pipeline is
+// recompiled with tighter register limits, first for the target occupancy, then for one wave more than the current
+// occupancy, each with the default scheduler and then the SI scheduler. The first variant that reaches the target is
+// taken; otherwise the one with the best occupancy, if any is better than the original. A variant that fails to
+// compile is ignored. The result is reported with -v, including when the original already reaches the target.
+//
+// @param build : Callback to compile the pipeline with the given register tuning
+// @param [in/out] pipelineElf : Pipeline ELF, replaced by the chosen variant, if any
+void OccupancyTuner::tune(BuildFunc build, ElfPackage *pipelineElf) {
+  PipelineOccupancy original;
+  if (!readOccupancy(*pipelineElf, original))
+    return;
+
+  // The target cannot be above the maximum waves per SIMD of any hardware stage; a higher target would only lead to
+  // register limits that cannot reach it.
+  unsigned targetWaves = m_targetWaves;
+  for (const StageOccupancy &stage : original.stages)
+    targetWaves = std::min(targetWaves, getRegisterFile(m_gfxIp, stage.waveSize).maxWaves);
+  if (original.waves >= targetWaves) {
+    report(original, original, 0, targetWaves);
+    return;
+  }
+
+  // Limit the registers to what the hardware stage with the lowest occupancy needs to reach the given occupancy.
+  // The same limits are applied to all shader stages; they have no effect on stages that are below them anyway.
+  const StageOccupancy &worst = *std::min_element(
+      original.stages.begin(), original.stages.end(),
+      [](const StageOccupancy &left, const StageOccupancy &right) { return left.waves < right.waves; });
+  SmallVector<unsigned, 2> waveSteps = {targetWaves};
+  if (original.waves + 1 < targetWaves)
+    waveSteps.push_back(original.waves + 1);
+
+  SmallVector<RegisterTuning, 4> variants;
+  for (unsigned waves : waveSteps) {
+    unsigned vgprLimit = getVgprLimit(waves, worst.waveSize);
+    unsigned sgprLimit = getSgprLimit(waves, worst.waveSize);
+    RegisterTuning tuning = {};
+    tuning.vgprLimit = worst.vgprCount > vgprLimit ? vgprLimit : 0;
+    tuning.sgprLimit = sgprLimit != 0 && worst.sgprCount > sgprLimit ? sgprLimit : 0;
+    if (tuning.vgprLimit == 0 && tuning.sgprLimit == 0)
+      continue;
+    variants.push_back(tuning);
+    tuning.useSiScheduler = true;
+    variants.push_back(tuning);
+  }
+
+  PipelineOccupancy best = original;
+  ElfPackage bestElf;
+  unsigned bestIndex = 0;
+  for (unsigned variantIndex = 0; variantIndex < variants.size() && best.waves < targetWaves; ++variantIndex) {
+    const RegisterTuning &tuning = variants[variantIndex];
+    LLVM_DEBUG(dbgs() << "Occupancy tuner: variant " << variantIndex + 1 << ": VGPR limit " << tuning.vgprLimit
+                      << ", SGPR limit " << tuning.sgprLimit << ", SI scheduler " << tuning.useSiScheduler << "\n");
+    ElfPackage variantElf;
+    PipelineOccupancy variant;
+    if (build(tuning, &variantElf) != Result::Success || !readOccupancy(variantElf, variant))
+      continue;
+    if (variant.scratchSize > original.scratchSize || variant.waves <= best.waves)
+      continue;
+    best = variant;
+    bestElf = std::move(variantElf);
+    bestIndex = variantIndex + 1;
+  }
+
+  if (bestIndex != 0)
+    *pipelineElf = std::move(bestElf);
+  report(original, best, bestIndex, targetWaves);
+}
+
+// =====================================================================================================================
+// Read the register usage of each hardware stage from the PAL metadata of a pipeline ELF, and estimate its occupancy.
+// Returns false if the ELF has no PAL metadata with register usage.
+//
+// @param pipelineElf : Pipeline ELF
+// @param [out] occupancy : Register usage and occupancy of the pipeline
+bool OccupancyTuner::readOccupancy(const ElfPackage &pipelineElf, PipelineOccupancy &occupancy) const {
+  ElfReader<Elf64> reader(m_gfxIp);
+  size_t codeSize = pipelineElf.size();
+  if (reader.ReadFromBuffer(pipelineElf.data(), &codeSize) != Result::Success || !reader.isSectionPresent(NoteName))
+    return false;
+  ElfNote note = reader.getNote(Util::Abi::PipelineAbiNoteType::PalMetadata);
+  if (!note.data)
+    return false;
+
+  msgpack::Document document;
+  if (!document.readFromBlob(StringRef(reinterpret_cast<const char *>(note.data), note.hdr.descSize), false))
+    return false;
+  auto pipelines = document.getRoot().getMap(true)[Util::Abi::PalCodeObjectMetadataKey::Pipelines];
+  if (pipelines.getKind() != msgpack::Type::Array || pipelines.getArray().size() == 0)
+    return false;
+  auto hwStages = pipelines.getArray()[0].getMap(true)[Util::Abi::PipelineMetadataKey::HardwareStages];
+  if (hwStages.getKind() != msgpack::Type::Map)
+    return false;
+
+  // Get an unsigned value from a metadata map, or the default if it is absent.
+  auto getUInt = [](msgpack::MapDocNode &map, StringRef key, unsigned defaultValue) -> unsigned {
+    auto it = map.find(key);
+    if (it == map.end() || it->second.getKind() != msgpack::Type::UInt)
+      return defaultValue;
+    return it->second.getUInt();
+  };
+
+  occupancy.stages.clear();
+  occupancy.scratchSize = 0;
+  occupancy.waves = UINT_MAX;
+  for (const char *hwStageName : HwStageNames) {
+    auto it = hwStages.getMap().find(StringRef(hwStageName));
+    if (it == hwStages.getMap().end() || it->second.getKind() != msgpack::Type::Map)
+      continue;
+    auto &hwStage = it->second.getMap();
+    StageOccupancy stage = {};
+    stage.hwStageName = hwStageName;
+    stage.vgprCount = getUInt(hwStage, Util::Abi::HardwareStageMetadataKey::VgprCount, 0);
+    stage.sgprCount = getUInt(hwStage, Util::Abi::HardwareStageMetadataKey::SgprCount, 0);
+    stage.waveSize = getUInt(hwStage, Util::Abi::HardwareStageMetadataKey::WavefrontSize, 64);
+    stage.waves = getWaves(m_gfxIp, stage.vgprCount, stage.sgprCount, stage.waveSize);
+    occupancy.scratchSize += getUInt(hwStage, Util::Abi::HardwareStageMetadataKey::ScratchMemorySize, 0);
+    occupancy.waves = std::min(occupancy.waves, stage.waves);
+    occupancy.stages.push_back(stage);
+  }
+  return !occupancy.stages.empty();
+}
+
+// =====================================================================================================================
+// Get the register file of a SIMD, as seen by waves of the given size. This is the static occupancy model: it treats
+// the register file of GFX10+ in wave64 mode as half its size, and ignores LDS usage and workgroup size.
+//
+// @param gfxIp : Graphics IP version info
+// @param waveSize : Wavefront size
+OccupancyTuner::RegisterFile OccupancyTuner::getRegisterFile(GfxIpVersion gfxIp, unsigned waveSize) {
+  RegisterFile registerFile = {};
+  if (gfxIp.major >= 10) {
+    // SGPRs do not limit occupancy on GFX10+.
+    registerFile.maxWaves = waveSize == 32 ? 20 : 10;
+    registerFile.vgprCount = waveSize == 32 ? 1024 : 512;
+    registerFile.vgprGranule = waveSize == 32 ? 8 : 4;
+  } else {
+    registerFile.maxWaves = 10;
+    registerFile.vgprCount = 256;
+    registerFile.vgprGranule = 4;
+    registerFile.sgprCount = gfxIp.major >= 8 ? 800 : 512;
+    registerFile.sgprGranule = gfxIp.major >= 8 ? 16 : 8;
+    registerFile.maxSgprs = gfxIp.major >= 8 ? 102 : 104;
+  }
+  return registerFile;
+}
+
+// =====================================================================================================================
+// Get the number of waves per SIMD that the register usage of a hardware stage allows.
+//
+// @param gfxIp : Graphics IP version info
+// @param vgprCount : VGPRs used
+// @param sgprCount : SGPRs used
+// @param waveSize : Wavefront size
+unsigned OccupancyTuner::getWaves(GfxIpVersion gfxIp, unsigned vgprCount, unsigned sgprCount, unsigned waveSize) {
+  RegisterFile registerFile = getRegisterFile(gfxIp, waveSize);
+  unsigned waves = registerFile.maxWaves;
+  unsigned vgprAlloc = alignTo(std::max(vgprCount, 1u), registerFile.vgprGranule);
+  waves = std::min(waves, registerFile.vgprCount / vgprAlloc);
+  if (registerFile.sgprCount != 0) {
+    unsigned sgprAlloc = alignTo(std::max(sgprCount, 1u), registerFile.sgprGranule);
+    waves = std::min(waves, registerFile.sgprCount / sgprAlloc);
+  }
+  return waves;
+}
+
+// =====================================================================================================================
+// Get the VGPR limit that allows the given number of waves per SIMD.
+//
+// @param waves : Waves per SIMD
+// @param waveSize : Wavefront size
+unsigned OccupancyTuner::getVgprLimit(unsigned waves, unsigned waveSize) const {
+  RegisterFile registerFile = getRegisterFile(m_gfxIp, waveSize);
+  return std::min(MaxVgprsPerWave, unsigned(alignDown(registerFile.vgprCount / waves, registerFile.vgprGranule)));
+}
+
+// =====================================================================================================================
+// Get the SGPR limit that allows the given number of waves per SIMD. Returns 0 if SGPRs do not limit occupancy.
+//
+// @param waves : Waves per SIMD
+// @param waveSize : Wavefront size
+unsigned OccupancyTuner::getSgprLimit(unsigned waves, unsigned waveSize) const {
+  RegisterFile registerFile = getRegisterFile(m_gfxIp, waveSize);
+  if (registerFile.sgprCount == 0)
+    return 0;
+  return std::min(registerFile.maxSgprs, unsigned(alignDown(registerFile.sgprCount / waves, registerFile.sgprGranule)));
+}
+
+// =====================================================================================================================
+// Report the occupancy of each hardware stage before and after tuning.
+//
+// @param before : Register usage and occupancy of the original pipeline
+// @param after : Register usage and occupancy of the chosen variant, or the original pipeline
+// @param variantIndex : One-based index of the chosen variant, or 0 if the original pipeline is kept
+// @param targetWaves : Target waves per SIMD, clamped to what the hardware stages allow
+void OccupancyTuner::report(const PipelineOccupancy &before, const PipelineOccupancy &after, unsigned variantIndex,
+                            unsigned targetWaves) const {
+  if (!EnableOuts())
+    return;
+  LLPC_OUTS("===============================================================================\n");
+  LLPC_OUTS("// LLPC occupancy tuning results\n\n");
+  for (unsigned i = 0; i < before.stages.size() && i < after.stages.size(); ++i) {
+    const StageOccupancy &beforeStage = before.stages[i];
+    const StageOccupancy &afterStage = after.stages[i];
+    LLPC_OUTS(format("%-4s: VGPRs %3u -> %3u, SGPRs %3u -> %3u, waves %2u -> %2u\n", beforeStage.hwStageName,
+                     beforeStage.vgprCount, afterStage.vgprCount, beforeStage.sgprCount, afterStage.sgprCount,
+                     beforeStage.waves, afterStage.waves));
+  }
+  if (variantIndex != 0) {
+    LLPC_OUTS("Chose variant " << variantIndex << ": waves " << before.waves << " -> " << after.waves << "\n\n");
+  } else {
+    LLPC_OUTS("Kept original: waves " << before.waves << ", target " << targetWaves << "\n\n");
+  }
+}
+
+} // namespace Llpc
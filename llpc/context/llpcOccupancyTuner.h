@@ -0,0 +1,102 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  llpcOccupancyTuner.h
+ * @brief LLPC header file: contains declaration of class Llpc::OccupancyTuner.
+ ***********************************************************************************************************************
+ */
+#pragma once
+
+#include "llpcPipelineContext.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+
+namespace Llpc {
+
+// =====================================================================================================================
+// Tunes the register usage of a compiled pipeline for occupancy.
+//
+// The register usage of each hardware stage is read from the PAL metadata of the pipeline ELF, and the number of
+// waves per SIMD it allows is estimated by a static occupancy model. If any hardware stage is below the target, the
+// pipeline is recompiled with variants of tighter register limits and scheduler, and the variant with the best
+// occupancy is kept. A variant that needs more scratch memory than the original (because it spills) is rejected, as
+// the model does not account for the cost of spilling.
+class OccupancyTuner {
+public:
+  // Callback to compile the pipeline with the given register tuning
+  typedef llvm::function_ref<Result(const RegisterTuning &tuning, ElfPackage *pipelineElf)> BuildFunc;
+
+  OccupancyTuner(GfxIpVersion gfxIp, unsigned targetWaves);
+
+  void tune(BuildFunc build, ElfPackage *pipelineElf);
+
+  static unsigned getWaves(GfxIpVersion gfxIp, unsigned vgprCount, unsigned sgprCount, unsigned waveSize);
+
+private:
+  OccupancyTuner() = delete;
+  OccupancyTuner(const OccupancyTuner &) = delete;
+  OccupancyTuner &operator=(const OccupancyTuner &) = delete;
+
+  // Register usage and occupancy of one hardware stage of a pipeline
+  struct StageOccupancy {
+    const char *hwStageName; // Name of the hardware stage in PAL metadata
+    unsigned vgprCount;      // VGPRs used
+    unsigned sgprCount;      // SGPRs used
+    unsigned waveSize;       // Wavefront size
+    unsigned waves;          // Waves per SIMD allowed by the register usage
+  };
+
+  // Register usage and occupancy of a pipeline
+  struct PipelineOccupancy {
+    llvm::SmallVector<StageOccupancy, 4> stages; // Hardware stages
+    unsigned scratchSize;                        // Total scratch memory size of all hardware stages
+    unsigned waves;                              // Waves per SIMD of the hardware stage with the fewest
+  };
+
+  // Register file of a SIMD, as seen by waves of one size
+  struct RegisterFile {
+    unsigned maxWaves;     // Maximum waves per SIMD
+    unsigned vgprCount;    // VGPRs per SIMD
+    unsigned vgprGranule;  // VGPR allocation granularity
+    unsigned sgprCount;    // SGPRs per SIMD (0 if SGPRs do not limit occupancy)
+    unsigned sgprGranule;  // SGPR allocation granularity
+    unsigned maxSgprs;     // Maximum SGPRs a wave can use
+  };
+
+  bool readOccupancy(const ElfPackage &pipelineElf, PipelineOccupancy &occupancy) const;
+  static RegisterFile getRegisterFile(GfxIpVersion gfxIp, unsigned waveSize);
+  unsigned getVgprLimit(unsigned waves, unsigned waveSize) const;
+  unsigned getSgprLimit(unsigned waves, unsigned waveSize) const;
+  void report(const PipelineOccupancy &before, const PipelineOccupancy &after, unsigned variantIndex,
+              unsigned targetWaves) const;
+
+  // -----------------------------------------------------------------------------------------------------------------
+
+  GfxIpVersion m_gfxIp;   // Graphics IP version info
+  unsigned m_targetWaves; // Target waves per SIMD
+};
+
+} // namespace Llpc
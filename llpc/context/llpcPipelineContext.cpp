@@ -58,6 +58,14 @@ static cl::opt<bool> IncludeLlvmIr("include-llvm-ir",
                                    cl::desc("Include LLVM IR as a separate section in the ELF binary"),
                                    cl::init(false));
 
+// -include-shader-stats: include static shader statistics as a separate section in the ELF binary
+static cl::opt<bool> IncludeShaderStats("include-shader-stats",
+                                        cl::desc("Include static shader statistics as a separate section in the ELF "
+                                                 "binary. The instruction counts are of LLVM IR, as a proxy for the "
+                                                 "ISA: getelementptr, extractelement and insertvalue, for example, "
+                                                 "count as ALU instructions"),
+                                        cl::init(false));
+
 // -vgpr-limit: maximum VGPR limit for this shader
 static cl::opt<unsigned> VgprLimit("vgpr-limit", cl::desc("Maximum VGPR limit for this shader"), cl::init(0));
 
@@ -79,6 +87,14 @@ static const unsigned MaxScalarThreshold = 0xFFFFFFFF;
 static cl::opt<unsigned> ScalarThreshold("scalar-threshold", cl::desc("The threshold for load scalarizer"),
                                          cl::init(MaxScalarThreshold));
 
+// -load-scalarizer-cost-model: Decide per load whether to scalarize it by a cost model in the load scalarizer
+static cl::opt<bool> LoadScalarizerCostModel("load-scalarizer-cost-model",
+                                             cl::desc("Decide per load whether to scalarize it, by a cost model of "
+                                                      "its uses, alignment and register pressure, in the shader "
+                                                      "stages where the load scalarizer is enabled, as if "
+                                                      "options.loadScalarizerCostModel were set in every stage"),
+                                             cl::init(false));
+
 // -enable-si-scheduler: enable target option si-scheduler
 static cl::opt<bool> EnableSiScheduler("enable-si-scheduler", cl::desc("Enable target option si-scheduler"),
                                        cl::init(false));
@@ -217,6 +233,8 @@ void PipelineContext::setOptionsInPipeline(Pipeline *pipeline) const {
   options.includeDisassembly = (cl::EnablePipelineDump || EnableOuts() || getPipelineOptions()->includeDisassembly);
   options.reconfigWorkgroupLayout = getPipelineOptions()->reconfigWorkgroupLayout;
   options.includeIr = (IncludeLlvmIr || getPipelineOptions()->includeIr);
+  options.fastCompile = getPipelineOptions()->fastCompile;
+  options.includeShaderStats = IncludeShaderStats;
 
   static_assert(static_cast<lgc::ShadowDescriptorTableUsage>(Vkgc::ShadowDescriptorTableUsage::Auto) ==
                     lgc::ShadowDescriptorTableUsage::Auto,
@@ -308,6 +326,16 @@ void PipelineContext::setOptionsInPipeline(Pipeline *pipeline) const {
       else
         shaderOptions.sgprLimit = SgprLimit;
 
+      // Tighten the register limits to those of the occupancy tuner, if any.
+      if (m_registerTuning.vgprLimit != 0)
+        shaderOptions.vgprLimit = shaderOptions.vgprLimit != 0
+                                      ? std::min(shaderOptions.vgprLimit, m_registerTuning.vgprLimit)
+                                      : m_registerTuning.vgprLimit;
+      if (m_registerTuning.sgprLimit != 0)
+        shaderOptions.sgprLimit = shaderOptions.sgprLimit != 0
+                                      ? std::min(shaderOptions.sgprLimit, m_registerTuning.sgprLimit)
+                                      : m_registerTuning.sgprLimit;
+
       if (shaderInfo->options.maxThreadGroupsPerComputeUnit != 0)
         shaderOptions.maxThreadGroupsPerComputeUnit = shaderInfo->options.maxThreadGroupsPerComputeUnit;
       else
@@ -341,8 +369,10 @@ void PipelineContext::setOptionsInPipeline(Pipeline *pipeline) const {
           shaderOptions.loadScalarizerThreshold = MaxScalarThreshold;
       }
 #endif
+      shaderOptions.loadScalarizerCostModel = LoadScalarizerCostModel || shaderInfo->options.loadScalarizerCostModel;
 
-      shaderOptions.useSiScheduler = EnableSiScheduler || shaderInfo->options.useSiScheduler;
+      shaderOptions.useSiScheduler =
+          EnableSiScheduler || shaderInfo->options.useSiScheduler || m_registerTuning.useSiScheduler;
       shaderOptions.updateDescInElf = shaderInfo->options.updateDescInElf;
       shaderOptions.unrollThreshold = shaderInfo->options.unrollThreshold;
 
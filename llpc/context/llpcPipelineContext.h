@@ -89,6 +89,14 @@ struct ShaderFpMode {
   unsigned roundingModeRTZ : 4;          // Bitmask of roundingModeRTZ flags
 };
 
+// Register limits and scheduler that the occupancy tuner imposes on all shader stages of a pipeline, on top of the
+// shader options
+struct RegisterTuning {
+  unsigned vgprLimit;  // VGPR limit (0 means no limit)
+  unsigned sgprLimit;  // SGPR limit (0 means no limit)
+  bool useSiScheduler; // Whether to use the SI scheduler
+};
+
 // =====================================================================================================================
 // Represents pipeline-specific context for pipeline compilation, it is a part of LLPC context
 class PipelineContext {
@@ -142,6 +150,14 @@ public:
   // VkFormat is not supported.
   static std::pair<lgc::BufDataFormat, lgc::BufNumFormat> mapVkFormat(VkFormat format, bool isColorExport);
 
+  // Sets the register limits and scheduler imposed by the occupancy tuner
+  void setRegisterTuning(const RegisterTuning &tuning) { m_registerTuning = tuning; }
+
+  // Checks whether the occupancy tuner imposes register limits or scheduler on this pipeline
+  bool hasRegisterTuning() const {
+    return m_registerTuning.vgprLimit != 0 || m_registerTuning.sgprLimit != 0 || m_registerTuning.useSiScheduler;
+  }
+
 protected:
   // Gets dummy vertex input create info
   virtual VkPipelineVertexInputStateCreateInfo *getDummyVertexInputInfo() { return nullptr; }
@@ -187,6 +203,7 @@ private:
   // -----------------------------------------------------------------------------------------------------------------
 
   ShaderFpMode m_shaderFpModes[ShaderStageCountInternal] = {};
+  RegisterTuning m_registerTuning = {}; // Register limits and scheduler imposed by the occupancy tuner
 };
 
 } // namespace Llpc
@@ -0,0 +1,456 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2017-2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  llpcPipelineSpeculator.cpp
+ * @brief LLPC source file: contains implementation of class Llpc::PipelineSpeculator.
+ ***********************************************************************************************************************
+ */
+#include "llpcPipelineSpeculator.h"
+#include "llpcCompiler.h"
+#include "llpcShaderModuleHelper.h"
+#include "vkgcMetroHash.h"
+#include "vkgcPipelineDumper.h"
+#include "lgc/Trace.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/raw_ostream.h"
+#include <mutex>
+
+#define DEBUG_TYPE "llpc-pipeline-speculator"
+
+using namespace llvm;
+using namespace Vkgc;
+
+namespace Llpc {
+
+// Number of times a transition between variant states must be seen before it is used to predict variants
+static const unsigned MinTransitionCount = 2;
+// Maximum number of queued background compiles
+static const unsigned MaxQueuedJobs = 8;
+// Maximum number of pipelines, bases and variant states remembered, before the history is dropped
+static const unsigned MaxHistorySize = 4096;
+// Maximum number of transitions remembered from each variant state
+static const unsigned MaxTransitionsPerState = 8;
+
+thread_local bool PipelineSpeculator::s_speculating = false;
+
+// =====================================================================================================================
+// A queued background compile. The pipeline build info is a deep copy of the one it was predicted from, as the
+// shader modules and other data of the application might be freed before the compile runs.
+struct PipelineSpeculator::Job {
+  // Copy an array into the job's allocator
+  template <typename T> T *copyArray(const T *src, size_t count) {
+    if (!src || count == 0)
+      return nullptr;
+    T *dst = allocator.Allocate<T>(count);
+    memcpy(dst, src, count * sizeof(T));
+    return dst;
+  }
+
+  const ResourceMappingNode *copyNodes(const ResourceMappingNode *nodes, unsigned nodeCount);
+  const void *copyModuleData(const void *moduleData);
+  void copyShaderInfo(PipelineShaderInfo *shaderInfo);
+  void copyVertexInput();
+
+  // Output allocator for the build
+  static void *allocOutput(void *instance, void *userData, size_t size) {
+    auto job = static_cast<Job *>(userData);
+    job->output.reset(new uint8_t[size]);
+    return job->output.get();
+  }
+
+  BumpPtrAllocator allocator;             // Allocator for the deep copy of the build info
+  GraphicsPipelineBuildInfo pipelineInfo; // Pipeline build info
+  std::unique_ptr<uint8_t[]> output;      // Pipeline ELF output
+};
+
+// =====================================================================================================================
+// Copy a resource mapping node array, including any descriptor tables it points to.
+//
+// @param nodes : Nodes to copy
+// @param nodeCount : Number of nodes
+const ResourceMappingNode *PipelineSpeculator::Job::copyNodes(const ResourceMappingNode *nodes, unsigned nodeCount) {
+  ResourceMappingNode *newNodes = copyArray(nodes, nodeCount);
+  for (unsigned i = 0; i < nodeCount && newNodes; ++i) {
+    if (newNodes[i].type == ResourceMappingNodeType::DescriptorTableVaPtr)
+      newNodes[i].tablePtr.pNext = copyNodes(nodes[i].tablePtr.pNext, nodes[i].tablePtr.nodeCount);
+  }
+  return newNodes;
+}
+
+// =====================================================================================================================
+// Copy the shader module data output by Compiler::BuildShaderModule, fixing up its internal pointers. See there for
+// its memory layout.
+//
+// @param moduleData : Shader module data to copy
+const void *PipelineSpeculator::Job::copyModuleData(const void *moduleData) {
+  if (!moduleData)
+    return nullptr;
+  auto moduleDataEx = static_cast<const ShaderModuleDataEx *>(moduleData);
+  size_t size = moduleDataEx->fsOutInfoOffset + moduleDataEx->extra.fsOutInfoCount * sizeof(FsOutInfo);
+  void *newData = allocator.Allocate(size, alignof(ShaderModuleDataEx));
+  memcpy(newData, moduleData, size);
+
+  auto newModuleDataEx = static_cast<ShaderModuleDataEx *>(newData);
+  newModuleDataEx->common.binCode.pCode = voidPtrInc(newData, newModuleDataEx->codeOffset);
+  newModuleDataEx->extra.pFsOutInfos =
+      reinterpret_cast<const FsOutInfo *>(voidPtrInc(newData, newModuleDataEx->fsOutInfoOffset));
+  auto entry = reinterpret_cast<ShaderModuleEntry *>(voidPtrInc(newData, newModuleDataEx->entryOffset));
+  auto resNodeData = reinterpret_cast<const ResourceNodeData *>(voidPtrInc(newData, newModuleDataEx->resNodeOffset));
+  for (unsigned i = 0; i < newModuleDataEx->extra.entryCount; ++i) {
+    ShaderModuleEntryData &entryData = newModuleDataEx->extra.entryDatas[i];
+    entryData.pShaderEntry = &entry[i];
+    entryData.pResNodeDatas = resNodeData;
+    resNodeData += entryData.resNodeDataCount;
+  }
+  return newData;
+}
+
+// =====================================================================================================================
+// Deep copy the data pointed to by a shader info in the pipeline build info.
+//
+// @param [in/out] shaderInfo : Shader info to update with pointers to the copies
+void PipelineSpeculator::Job::copyShaderInfo(PipelineShaderInfo *shaderInfo) {
+  shaderInfo->pModuleData = copyModuleData(shaderInfo->pModuleData);
+
+  if (const VkSpecializationInfo *specializationInfo = shaderInfo->pSpecializationInfo) {
+    auto newSpecializationInfo = allocator.Allocate<VkSpecializationInfo>();
+    *newSpecializationInfo = *specializationInfo;
+    newSpecializationInfo->pMapEntries =
+        copyArray(specializationInfo->pMapEntries, specializationInfo->mapEntryCount);
+    newSpecializationInfo->pData = copyArray(static_cast<const uint8_t *>(specializationInfo->pData),
+                                             specializationInfo->dataSize);
+    shaderInfo->pSpecializationInfo = newSpecializationInfo;
+  }
+
+  if (shaderInfo->pEntryTarget)
+    shaderInfo->pEntryTarget = copyArray(shaderInfo->pEntryTarget, strlen(shaderInfo->pEntryTarget) + 1);
+
+  DescriptorRangeValue *rangeValues =
+      copyArray(shaderInfo->pDescriptorRangeValues, shaderInfo->descriptorRangeValueCount);
+  for (unsigned i = 0; i < shaderInfo->descriptorRangeValueCount && rangeValues; ++i) {
+    const unsigned descriptorSizeInDw = rangeValues[i].type == ResourceMappingNodeType::DescriptorYCbCrSampler ? 8 : 4;
+    rangeValues[i].pValue = copyArray(rangeValues[i].pValue, rangeValues[i].arraySize * descriptorSizeInDw);
+  }
+  shaderInfo->pDescriptorRangeValues = rangeValues;
+
+  shaderInfo->pUserDataNodes = copyNodes(shaderInfo->pUserDataNodes, shaderInfo->userDataNodeCount);
+}
+
+// =====================================================================================================================
+// Deep copy the vertex input state in the pipeline build info. Of the extension structures, only the vertex divisor
+// state is kept.
+void PipelineSpeculator::Job::copyVertexInput() {
+  const VkPipelineVertexInputStateCreateInfo *vertexInput = pipelineInfo.pVertexInput;
+  if (!vertexInput)
+    return;
+
+  auto newVertexInput = allocator.Allocate<VkPipelineVertexInputStateCreateInfo>();
+  *newVertexInput = *vertexInput;
+  newVertexInput->pVertexBindingDescriptions =
+      copyArray(vertexInput->pVertexBindingDescriptions, vertexInput->vertexBindingDescriptionCount);
+  newVertexInput->pVertexAttributeDescriptions =
+      copyArray(vertexInput->pVertexAttributeDescriptions, vertexInput->vertexAttributeDescriptionCount);
+  newVertexInput->pNext = nullptr;
+
+  auto vertexDivisor = findVkStructInChain<VkPipelineVertexInputDivisorStateCreateInfoEXT>(
+      VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_DIVISOR_STATE_CREATE_INFO_EXT, vertexInput->pNext);
+  if (vertexDivisor) {
+    auto newVertexDivisor = allocator.Allocate<VkPipelineVertexInputDivisorStateCreateInfoEXT>();
+    *newVertexDivisor = *vertexDivisor;
+    newVertexDivisor->pNext = nullptr;
+    newVertexDivisor->pVertexBindingDivisors =
+        copyArray(vertexDivisor->pVertexBindingDivisors, vertexDivisor->vertexBindingDivisorCount);
+    newVertexInput->pNext = newVertexDivisor;
+  }
+  pipelineInfo.pVertexInput = newVertexInput;
+}
+
+// =====================================================================================================================
+//
+// @param compiler : Compiler to build pipelines with
+// @param threadCount : Number of background compile threads
+// @param budgetPercent : Background compiles allowed, as a percentage of foreground compiles
+PipelineSpeculator::PipelineSpeculator(Compiler *compiler, unsigned threadCount, unsigned budgetPercent)
+    : m_compiler(compiler), m_budgetPercent(budgetPercent) {
+  for (unsigned i = 0; i < threadCount; ++i)
+    m_threads.emplace_back([this]() { runThread(); });
+}
+
+// =====================================================================================================================
+// Stops the background compile threads, dropping any queued compiles.
+PipelineSpeculator::~PipelineSpeculator() {
+  {
+    std::lock_guard<sys::Mutex> lock(m_lock);
+    m_stopping = true;
+    m_queue.clear();
+  }
+  m_wakeUp.notify_all();
+  for (std::thread &thread : m_threads)
+    thread.join();
+}
+
+// =====================================================================================================================
+// Hash the variant state of a pipeline, that is, its rasterizer and color target state.
+//
+// @param pipelineInfo : Pipeline build info
+uint64_t PipelineSpeculator::hashVariantState(const GraphicsPipelineBuildInfo *pipelineInfo) {
+  MetroHash::MetroHash64 hasher;
+  const auto &rsState = pipelineInfo->rsState;
+  hasher.Update(rsState.rasterizerDiscardEnable);
+  hasher.Update(rsState.innerCoverage);
+  hasher.Update(rsState.perSampleShading);
+  hasher.Update(rsState.numSamples);
+  hasher.Update(rsState.samplePatternIdx);
+  hasher.Update(rsState.usrClipPlaneMask);
+  hasher.Update(rsState.polygonMode);
+  hasher.Update(rsState.cullMode);
+  hasher.Update(rsState.frontFace);
+  hasher.Update(rsState.depthBiasEnable);
+
+  const auto &cbState = pipelineInfo->cbState;
+  hasher.Update(cbState.alphaToCoverageEnable);
+  hasher.Update(cbState.dualSourceBlendEnable);
+  for (unsigned i = 0; i < MaxColorTargets; ++i) {
+    hasher.Update(cbState.target[i].format);
+    hasher.Update(cbState.target[i].channelWriteMask);
+    hasher.Update(cbState.target[i].blendEnable);
+    hasher.Update(cbState.target[i].blendSrcAlphaToColor);
+  }
+
+  MetroHash::Hash hash = {};
+  hasher.Finalize(hash.bytes);
+  return MetroHash::compact64(&hash);
+}
+
+// =====================================================================================================================
+// Hash the "base" of a pipeline, that is, everything except its variant state.
+//
+// @param pipelineInfo : Pipeline build info
+uint64_t PipelineSpeculator::hashBase(const GraphicsPipelineBuildInfo *pipelineInfo) {
+  GraphicsPipelineBuildInfo baseInfo = *pipelineInfo;
+  baseInfo.rsState = {};
+  baseInfo.cbState = {};
+  MetroHash::Hash hash = PipelineDumper::generateHashForGraphicsPipeline(&baseInfo, false, false);
+  return MetroHash::compact64(&hash);
+}
+
+// =====================================================================================================================
+// Called at the start of a foreground graphics pipeline build. Learns from the requested pipeline, and queues
+// background compiles of predicted variants of it. Returns how the pipeline relates to the earlier predictions.
+//
+// @param pipelineInfo : Pipeline build info
+// @param pipelineHash : Compacted pipeline hash
+PipelineSpeculator::Prediction PipelineSpeculator::beginBuild(const GraphicsPipelineBuildInfo *pipelineInfo,
+                                                              uint64_t pipelineHash) {
+  std::lock_guard<sys::Mutex> lock(m_lock);
+  ++m_foregroundBuilds;
+  m_credits = std::min(m_credits + m_budgetPercent, MaxQueuedJobs * 100);
+  bool speculated = m_speculatedPipelines.erase(pipelineHash);
+  if (m_requestedPipelines.size() >= MaxHistorySize)
+    m_requestedPipelines.clear();
+  m_requestedPipelines.insert(pipelineHash);
+  bool isVariant = learnAndPredict(pipelineInfo, pipelineHash);
+  if (speculated)
+    return Prediction::Speculated;
+  return isVariant ? Prediction::Missed : Prediction::Unrelated;
+}
+
+// =====================================================================================================================
+// Called at the end of a foreground graphics pipeline build, to account for it and let the background compile
+// threads run again.
+//
+// @param prediction : How the pipeline relates to the earlier predictions, as returned by beginBuild
+// @param compiled : Whether the pipeline had to be compiled, rather than being found in the shader cache
+void PipelineSpeculator::endBuild(Prediction prediction, bool compiled) {
+  {
+    std::lock_guard<sys::Mutex> lock(m_lock);
+    --m_foregroundBuilds;
+    if (prediction == Prediction::Speculated) {
+      if (compiled)
+        ++m_lateCount;
+      else
+        ++m_hitCount;
+    } else if (prediction == Prediction::Missed && compiled)
+      ++m_missCount;
+  }
+  m_wakeUp.notify_all();
+}
+
+// =====================================================================================================================
+// Wait until the queued background compiles are done. Used by -speculative-compile-wait, so that the accounting does
+// not depend on the timing of the background threads.
+void PipelineSpeculator::waitForIdle() {
+  std::unique_lock<sys::Mutex> lock(m_lock);
+  m_wakeUp.wait(lock, [this]() { return m_stopping || (m_queue.empty() && m_runningJobs == 0); });
+}
+
+// =====================================================================================================================
+// Count a transition from one variant state to another. Once the transitions from a state are full, a new one only
+// replaces one that has not yet been seen often enough to be used for predictions. Called with m_lock held.
+//
+// @param fromState : Hash of the previous variant state
+// @param toState : Hash of the new variant state
+void PipelineSpeculator::learnTransition(uint64_t fromState, uint64_t toState) {
+  auto &transitions = m_transitions[fromState];
+  auto transitionIt = std::find_if(transitions.begin(), transitions.end(),
+                                   [toState](const Transition &transition) { return transition.toState == toState; });
+  if (transitionIt != transitions.end()) {
+    ++transitionIt->count;
+    return;
+  }
+  if (transitions.size() < MaxTransitionsPerState) {
+    transitions.push_back({toState, 1});
+    return;
+  }
+  auto leastSeenIt =
+      std::min_element(transitions.begin(), transitions.end(),
+                       [](const Transition &lhs, const Transition &rhs) { return lhs.count < rhs.count; });
+  if (leastSeenIt->count < MinTransitionCount)
+    *leastSeenIt = {toState, 1};
+}
+
+// =====================================================================================================================
+// Learns the transition from the previous variant state of the requested pipeline's base to its variant state, then
+// queues background compiles of the variants that have been seen to follow its variant state. Returns true if the
+// pipeline is a variant of a previously requested one. Called with m_lock held.
+//
+// @param pipelineInfo : Pipeline build info
+// @param pipelineHash : Compacted pipeline hash
+bool PipelineSpeculator::learnAndPredict(const GraphicsPipelineBuildInfo *pipelineInfo, uint64_t pipelineHash) {
+  uint64_t baseHash = hashBase(pipelineInfo);
+  uint64_t stateHash = hashVariantState(pipelineInfo);
+
+  // The learned transitions refer to the variant states and the last states of the bases, so they are all dropped
+  // together.
+  if (m_lastStateOfBase.size() >= MaxHistorySize || m_transitions.size() >= MaxHistorySize ||
+      m_variantStates.size() >= MaxHistorySize) {
+    m_lastStateOfBase.clear();
+    m_transitions.clear();
+    m_variantStates.clear();
+  }
+  if (m_variantStates.find(stateHash) == m_variantStates.end())
+    m_variantStates[stateHash] = {pipelineInfo->rsState, pipelineInfo->cbState};
+
+  // Learn the transition from the previous variant state of this base.
+  bool isVariant = false;
+  auto lastStateIt = m_lastStateOfBase.find(baseHash);
+  if (lastStateIt != m_lastStateOfBase.end() && lastStateIt->second != stateHash) {
+    isVariant = true;
+    learnTransition(lastStateIt->second, stateHash);
+  }
+  m_lastStateOfBase[baseHash] = stateHash;
+
+  // Predict the variants that follow this variant state.
+  auto transitionsIt = m_transitions.find(stateHash);
+  if (transitionsIt == m_transitions.end())
+    return isVariant;
+  for (const Transition &transition : transitionsIt->second) {
+    if (transition.count < MinTransitionCount)
+      continue;
+    if (m_credits < 100 || m_queue.size() >= MaxQueuedJobs)
+      break;
+    auto variantStateIt = m_variantStates.find(transition.toState);
+    if (variantStateIt == m_variantStates.end())
+      continue;
+
+    GraphicsPipelineBuildInfo variantInfo = *pipelineInfo;
+    variantInfo.rsState = variantStateIt->second.rsState;
+    variantInfo.cbState = variantStateIt->second.cbState;
+    MetroHash::Hash variantHash = PipelineDumper::generateHashForGraphicsPipeline(&variantInfo, false, false);
+    uint64_t variantPipelineHash = MetroHash::compact64(&variantHash);
+    if (m_requestedPipelines.count(variantPipelineHash) || m_speculatedPipelines.count(variantPipelineHash))
+      continue;
+
+    std::unique_ptr<Job> job(new Job);
+    job->pipelineInfo = variantInfo;
+    job->pipelineInfo.pInstance = nullptr;
+    job->pipelineInfo.pUserData = job.get();
+    job->pipelineInfo.pfnOutputAlloc = Job::allocOutput;
+#if LLPC_CLIENT_INTERFACE_MAJOR_VERSION < 38
+    job->pipelineInfo.pShaderCache = nullptr;
+#endif
+    job->copyShaderInfo(&job->pipelineInfo.vs);
+    job->copyShaderInfo(&job->pipelineInfo.tcs);
+    job->copyShaderInfo(&job->pipelineInfo.tes);
+    job->copyShaderInfo(&job->pipelineInfo.gs);
+    job->copyShaderInfo(&job->pipelineInfo.fs);
+    job->copyVertexInput();
+
+    if (m_speculatedPipelines.size() >= MaxHistorySize)
+      m_speculatedPipelines.clear();
+    m_speculatedPipelines.insert(variantPipelineHash);
+    m_queue.push_back(std::move(job));
+    m_credits -= 100;
+    ++m_queuedCount;
+  }
+  m_wakeUp.notify_all();
+  return isVariant;
+}
+
+// =====================================================================================================================
+// Body of a background compile thread: runs queued compiles while no foreground compile is in progress. The compiled
+// pipeline ends up in the shader cache; its ELF output is freed.
+void PipelineSpeculator::runThread() {
+  s_speculating = true;
+  set_thread_priority(ThreadPriority::Background);
+
+  std::unique_lock<sys::Mutex> lock(m_lock);
+  for (;;) {
+    m_wakeUp.wait(lock, [this]() { return m_stopping || (!m_queue.empty() && m_foregroundBuilds == 0); });
+    if (m_stopping)
+      return;
+
+    std::unique_ptr<Job> job = std::move(m_queue.front());
+    m_queue.pop_front();
+    ++m_runningJobs;
+    lock.unlock();
+
+    {
+      lgc::TraceScope traceScope("SpeculativeCompile");
+      GraphicsPipelineBuildOut pipelineOut = {};
+      m_compiler->BuildGraphicsPipeline(&job->pipelineInfo, &pipelineOut);
+    }
+    job.reset();
+
+    lock.lock();
+    --m_runningJobs;
+    ++m_compiledCount;
+    m_wakeUp.notify_all();
+  }
+}
+
+// =====================================================================================================================
+// Write the hit/miss accounting of the speculator.
+//
+// @param [out] out : Stream to write to
+void PipelineSpeculator::writeStats(raw_ostream &out) {
+  std::lock_guard<sys::Mutex> lock(m_lock);
+  out << "Speculative compile: queued " << m_queuedCount << ", compiled " << m_compiledCount << ", hits " << m_hitCount
+      << ", late " << m_lateCount << ", misses " << m_missCount << "\n";
+}
+
+} // namespace Llpc
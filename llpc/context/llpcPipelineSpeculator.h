@@ -0,0 +1,141 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2017-2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  llpcPipelineSpeculator.h
+ * @brief LLPC header file: contains declaration of class Llpc::PipelineSpeculator.
+ ***********************************************************************************************************************
+ */
+#pragma once
+
+#include "llpc.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Mutex.h"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace llvm {
+class raw_ostream;
+} // namespace llvm
+
+namespace Llpc {
+
+class Compiler;
+
+// =====================================================================================================================
+// Compiles likely-needed variants of graphics pipelines into the shader cache speculatively, on background threads.
+//
+// Applications often request a pipeline, then variants of it that differ only in rasterizer or color target state.
+// The speculator learns such patterns from the requested pipelines: when a pipeline is requested again with the same
+// shaders and other state, but a different rasterizer and color target state (a "variant state"), the transition from
+// the previous variant state to the new one is counted. When a pipeline is later requested with a variant state that
+// has been seen to be followed by another one often enough, the pipeline with that other variant state is queued for
+// compiling in the background.
+//
+// Background compiles only start while no foreground compile is in progress, and run at background priority. Their
+// number is limited to a percentage of the foreground compiles, and by the length of the queue.
+class PipelineSpeculator {
+public:
+  // How a requested pipeline relates to the speculator's predictions
+  enum class Prediction {
+    Unrelated,  // Not a variant of a previously requested pipeline
+    Missed,     // A variant of a previously requested pipeline that was not compiled speculatively
+    Speculated, // Queued for compiling speculatively
+  };
+
+  PipelineSpeculator(Compiler *compiler, unsigned threadCount, unsigned budgetPercent);
+  ~PipelineSpeculator();
+
+  Prediction beginBuild(const GraphicsPipelineBuildInfo *pipelineInfo, uint64_t pipelineHash);
+
+  void endBuild(Prediction prediction, bool compiled);
+
+  void waitForIdle();
+
+  // Returns true if the current thread is a background compile thread
+  static bool isSpeculating() { return s_speculating; }
+
+  void writeStats(llvm::raw_ostream &out);
+
+private:
+  PipelineSpeculator(const PipelineSpeculator &) = delete;
+  PipelineSpeculator &operator=(const PipelineSpeculator &) = delete;
+
+  // Rasterizer and color target state, the state that pipeline variants differ in
+  struct VariantState {
+    decltype(GraphicsPipelineBuildInfo::rsState) rsState;
+    decltype(GraphicsPipelineBuildInfo::cbState) cbState;
+  };
+
+  // Transition from one variant state to another, with the number of times it has been seen
+  struct Transition {
+    uint64_t toState;
+    unsigned count;
+  };
+
+  struct Job;
+
+  static uint64_t hashVariantState(const GraphicsPipelineBuildInfo *pipelineInfo);
+  static uint64_t hashBase(const GraphicsPipelineBuildInfo *pipelineInfo);
+
+  bool learnAndPredict(const GraphicsPipelineBuildInfo *pipelineInfo, uint64_t pipelineHash);
+  void learnTransition(uint64_t fromState, uint64_t toState);
+  void runThread();
+
+  // -----------------------------------------------------------------------------------------------------------------
+
+  static thread_local bool s_speculating; // Whether the current thread is a background compile thread
+
+  Compiler *m_compiler;                     // Compiler to build pipelines with
+  unsigned m_budgetPercent;                 // Background compiles allowed, as a percentage of foreground compiles
+  std::vector<std::thread> m_threads;       // Background compile threads
+  std::condition_variable_any m_wakeUp;     // Signalled when a job is queued or done, or a foreground compile ends
+  llvm::sys::Mutex m_lock;                  // Lock for all state below
+  bool m_stopping = false;                  // Set when the threads are to exit
+  unsigned m_foregroundBuilds = 0;          // Number of foreground pipeline builds in progress
+  unsigned m_runningJobs = 0;               // Number of background compiles in progress
+  unsigned m_credits = 0;                   // Budget left for background compiles, in percent of a compile
+  std::deque<std::unique_ptr<Job>> m_queue; // Queued background compiles
+
+  llvm::DenseMap<uint64_t, uint64_t> m_lastStateOfBase;                     // Last variant state of each base
+  llvm::DenseMap<uint64_t, llvm::SmallVector<Transition, 4>> m_transitions; // Transitions from each variant state
+  llvm::DenseMap<uint64_t, VariantState> m_variantStates;                   // Variant states by hash
+  llvm::DenseSet<uint64_t> m_requestedPipelines;                            // Pipelines requested in foreground
+  llvm::DenseSet<uint64_t> m_speculatedPipelines;                           // Pipelines queued in background
+
+  // Hit/miss accounting
+  unsigned m_queuedCount = 0;   // Background compiles queued
+  unsigned m_compiledCount = 0; // Background compiles done
+  unsigned m_hitCount = 0;      // Foreground requests served by a background compile
+  unsigned m_lateCount = 0;     // Foreground requests of a queued pipeline that had to be compiled before it was ready
+  unsigned m_missCount = 0;     // Foreground requests of an unpredicted variant that had to be compiled
+};
+
+} // namespace Llpc
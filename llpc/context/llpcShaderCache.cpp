@@ -30,6 +30,7 @@
 */
 #include "llpcShaderCache.h"
 #include "vkgcUtil.h"
+#include "lgc/Trace.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/DJB.h"
 #include "llvm/Support/FileSystem.h"
@@ -382,6 +383,7 @@ ShaderEntryState ShaderCache::findShader(MetroHash::Hash hash, bool allocateOnMi
     return ShaderEntryState::Compiling;
   }
 
+  lgc::TraceScope traceScope("ShaderCacheFind");
   ShaderEntryState result = ShaderEntryState::Unavailable;
   bool existed = false;
   ShaderIndex *index = nullptr;
@@ -464,6 +466,7 @@ ShaderEntryState ShaderCache::findShader(MetroHash::Hash hash, bool allocateOnMi
 
     if (index->state == ShaderEntryState::Compiling) {
       // The shader is being compiled by another thread, we should release the lock and wait for it to complete
+      lgc::TraceScope waitTraceScope("ShaderCacheWait");
       while (index->state == ShaderEntryState::Compiling) {
         unlockCacheMap(readOnlyLock);
         {
@@ -508,6 +511,7 @@ void ShaderCache::insertShader(CacheEntryHandle hEntry, const void *blob, size_t
   auto *const index = static_cast<ShaderIndex *>(hEntry);
   assert(m_disableCache == false);
   assert(index && index->state == ShaderEntryState::Compiling);
+  lgc::TraceScope traceScope("ShaderCacheInsert");
 
   lockCacheMap(false);
 
@@ -0,0 +1,114 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2017-2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  llpcSpirvModuleCache.cpp
+ * @brief LLPC source file: contains implementation of class Llpc::SpirvModuleCache.
+ ***********************************************************************************************************************
+ */
+#include "llpcSpirvModuleCache.h"
+#include "SPIRVModule.h"
+#include "llvm/Support/raw_ostream.h"
+#include <mutex>
+
+#define DEBUG_TYPE "llpc-spirv-module-cache"
+
+using namespace llvm;
+
+namespace Llpc {
+
+// =====================================================================================================================
+// NOTE: The destructor is out of line so that the cached modules are freed where SPIRVModule is a complete type.
+SpirvModuleCache::~SpirvModuleCache() {
+}
+
+// =====================================================================================================================
+// Checks out the parsed SPIR-V module with the given cache hash. Returns nullptr if the module is not in the cache, or
+// is currently checked out by another translation.
+//
+// @param cacheHash : Cache hash of the shader module
+std::unique_ptr<SPIRV::SPIRVModule> SpirvModuleCache::acquire(const MetroHash::Hash &cacheHash) {
+  std::lock_guard<sys::Mutex> lock(m_lock);
+  auto it = m_modules.find(MetroHash::compact64(&cacheHash));
+  if (it == m_modules.end() || memcmp(&it->second.cacheHash, &cacheHash, sizeof(cacheHash)) != 0) {
+    ++m_missCount;
+    return nullptr;
+  }
+
+  ++m_hitCount;
+  std::unique_ptr<SPIRV::SPIRVModule> module = std::move(it->second.module);
+  erase(it);
+  return module;
+}
+
+// =====================================================================================================================
+// Hands a parsed SPIR-V module back to the cache after translation. If the cache already holds a module for the hash
+// (because another thread parsed it in the meantime), the one passed in is simply freed. If the cache is full, the
+// least recently released module is evicted.
+//
+// @param cacheHash : Cache hash of the shader module
+// @param module : Parsed SPIR-V module
+void SpirvModuleCache::release(const MetroHash::Hash &cacheHash, std::unique_ptr<SPIRV::SPIRVModule> module) {
+  if (m_capacity == 0)
+    return;
+
+  std::lock_guard<sys::Mutex> lock(m_lock);
+  uint64_t key = MetroHash::compact64(&cacheHash);
+  auto result = m_modules.insert({key, CacheEntry()});
+  if (!result.second)
+    return;
+
+  CacheEntry &entry = result.first->second;
+  entry.cacheHash = cacheHash;
+  entry.module = std::move(module);
+  m_lruList.push_front(key);
+  entry.lruIt = m_lruList.begin();
+
+  if (m_modules.size() > m_capacity) {
+    erase(m_modules.find(m_lruList.back()));
+    ++m_evictionCount;
+  }
+}
+
+// =====================================================================================================================
+// Removes an entry from the module map and the LRU list. The caller must hold m_lock.
+//
+// @param it : Entry to remove
+void SpirvModuleCache::erase(std::unordered_map<uint64_t, CacheEntry>::iterator it) {
+  m_lruList.erase(it->second.lruIt);
+  m_modules.erase(it);
+}
+
+// =====================================================================================================================
+// Write the hit/miss accounting of the cache.
+//
+// @param [out] out : Stream to write to
+void SpirvModuleCache::writeStats(raw_ostream &out) {
+  std::lock_guard<sys::Mutex> lock(m_lock);
+  out << "SPIR-V module cache: hits " << m_hitCount << ", misses " << m_missCount << ", evictions " << m_evictionCount
+      << "\n";
+}
+
+} // namespace Llpc
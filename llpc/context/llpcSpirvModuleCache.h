@@ -0,0 +1,93 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2017-2020 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  llpcSpirvModuleCache.h
+ * @brief LLPC header file: contains declaration of class Llpc::SpirvModuleCache.
+ ***********************************************************************************************************************
+ */
+#pragma once
+
+#include "llpc.h"
+#include "vkgcMetroHash.h"
+#include "llvm/Support/Mutex.h"
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+namespace llvm {
+class raw_ostream;
+} // namespace llvm
+
+namespace SPIRV {
+class SPIRVModule;
+} // namespace SPIRV
+
+namespace Llpc {
+
+// =====================================================================================================================
+// Represents a cache of parsed SPIR-V modules, keyed by the cache hash of the shader module they were parsed from.
+//
+// A cached module is checked out by acquire() for the duration of one translation and handed back by release(), so a
+// module is never translated by two threads at once. Only modules that translation leaves unchanged may be released
+// back into the cache (see llvm::isSpirvModuleReusable).
+//
+// The cache holds at most a fixed number of modules; releasing a module into a full cache evicts the least recently
+// released one.
+class SpirvModuleCache {
+public:
+  SpirvModuleCache(unsigned capacity) : m_capacity(capacity) {}
+  ~SpirvModuleCache();
+
+  std::unique_ptr<SPIRV::SPIRVModule> acquire(const MetroHash::Hash &cacheHash);
+
+  void release(const MetroHash::Hash &cacheHash, std::unique_ptr<SPIRV::SPIRVModule> module);
+
+  void writeStats(llvm::raw_ostream &out);
+
+private:
+  SpirvModuleCache(const SpirvModuleCache &) = delete;
+  SpirvModuleCache &operator=(const SpirvModuleCache &) = delete;
+
+  // Cached module, with the full hash to guard against collisions of the compacted key
+  struct CacheEntry {
+    MetroHash::Hash cacheHash;
+    std::unique_ptr<SPIRV::SPIRVModule> module;
+    std::list<uint64_t>::iterator lruIt; // Position in m_lruList
+  };
+
+  void erase(std::unordered_map<uint64_t, CacheEntry>::iterator it);
+
+  const unsigned m_capacity;                          // Maximum number of cached modules
+  llvm::sys::Mutex m_lock;                            // Lock for all state below
+  std::unordered_map<uint64_t, CacheEntry> m_modules; // Map from compacted cache hash to parsed module
+  std::list<uint64_t> m_lruList;                      // Keys of m_modules, most recently released first
+
+  unsigned m_hitCount = 0;      // Translations that reused a cached module
+  unsigned m_missCount = 0;     // Translations that had to parse the module
+  unsigned m_evictionCount = 0; // Modules evicted to stay within the capacity
+};
+
+} // namespace Llpc
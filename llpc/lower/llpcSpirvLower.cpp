@@ -147,8 +147,9 @@ void SpirvLower::removeConstantExpr(Context *context, GlobalVariable *global) {
 // @param [in/out] passMgr : Pass manager to add passes to
 // @param lowerTimer : Timer to time lower passes with, nullptr if not timing
 // @param forceLoopUnrollCount : 0 or force loop unroll count
+// @param fastCompile : Whether to add only the minimal optimizations, for the fast compile tier
 void SpirvLower::addPasses(Context *context, ShaderStage stage, legacy::PassManager &passMgr, llvm::Timer *lowerTimer,
-                           unsigned forceLoopUnrollCount) {
+                           unsigned forceLoopUnrollCount, bool fastCompile) {
   // Manually add a target-aware TLI pass, so optimizations do not think that we have library functions.
   context->getLgcContext()->preparePassManager(&passMgr);
 
@@ -191,10 +192,12 @@ void SpirvLower::addPasses(Context *context, ShaderStage stage, legacy::PassMana
   passMgr.add(createAggressiveDCEPass());
   passMgr.add(createInstructionCombiningPass(3));
   passMgr.add(createCFGSimplificationPass());
-  passMgr.add(createSROAPass());
-  passMgr.add(createEarlyCSEPass());
-  passMgr.add(createCFGSimplificationPass());
-  passMgr.add(createIPConstantPropagationPass());
+  if (!fastCompile) {
+    passMgr.add(createSROAPass());
+    passMgr.add(createEarlyCSEPass());
+    passMgr.add(createCFGSimplificationPass());
+    passMgr.add(createIPConstantPropagationPass());
+  }
 
   // Lower SPIR-V algebraic transforms
   passMgr.add(createSpirvLowerAlgebraTransform(false, true));
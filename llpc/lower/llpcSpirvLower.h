@@ -32,6 +32,7 @@
 
 #include "llpc.h"
 #include "llpcUtil.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/Pass.h"
 
 namespace llvm {
@@ -82,6 +83,8 @@ inline static void initializeLowerPasses(llvm::PassRegistry &passRegistry) {
 }
 
 class Context;
+class SpirvModuleCache;
+struct SpirvWordRange;
 
 llvm::ModulePass *createSpirvLowerAccessChain();
 llvm::ModulePass *createSpirvLowerAlgebraTransform(bool enableConstFolding, bool enableFloatOpt);
@@ -91,7 +94,9 @@ llvm::ModulePass *createSpirvLowerGlobal();
 llvm::ModulePass *createSpirvLowerInstMetaRemove();
 llvm::ModulePass *createSpirvLowerLoopUnrollControl(unsigned forceLoopUnrollCount);
 llvm::ModulePass *createSpirvLowerResourceCollect(bool collectDetailUsage);
-llvm::ModulePass *createSpirvLowerTranslator(ShaderStage stage, const PipelineShaderInfo *shaderInfo);
+llvm::ModulePass *createSpirvLowerTranslator(ShaderStage stage, const PipelineShaderInfo *shaderInfo,
+                                             SpirvModuleCache *spirvModuleCache = nullptr,
+                                             llvm::ArrayRef<SpirvWordRange> skipRanges = {});
 
 // =====================================================================================================================
 // Represents the pass of SPIR-V lowering operations, as the base class.
@@ -103,7 +108,7 @@ public:
 
   // Add per-shader lowering passes to pass manager
   static void addPasses(Context *context, ShaderStage stage, llvm::legacy::PassManager &passMgr,
-                        llvm::Timer *lowerTimer, unsigned forceLoopUnrollCount);
+                        llvm::Timer *lowerTimer, unsigned forceLoopUnrollCount, bool fastCompile = false);
 
   static void removeConstantExpr(Context *context, llvm::GlobalVariable *global);
   static void replaceConstWithInsts(Context *context, llvm::Constant *const constVal);
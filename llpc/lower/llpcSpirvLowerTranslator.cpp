@@ -32,8 +32,11 @@
 #include "LLVMSPIRVLib.h"
 #include "llpcCompiler.h"
 #include "llpcContext.h"
+#include "llpcShaderModuleHelper.h"
+#include "llpcSpirvModuleCache.h"
+#include "SPIRVModule.h"
 #include "lgc/Builder.h"
-#include <sstream>
+#include <istream>
 #include <string>
 
 #define DEBUG_TYPE "llpc-spirv-lower-translator"
@@ -48,8 +51,11 @@ char SpirvLowerTranslator::ID = 0;
 //
 // @param stage : Shader stage
 // @param shaderInfo : Shader info for this shader
-ModulePass *Llpc::createSpirvLowerTranslator(ShaderStage stage, const PipelineShaderInfo *shaderInfo) {
-  return new SpirvLowerTranslator(stage, shaderInfo);
+// @param spirvModuleCache : Cache of parsed SPIR-V modules (optional)
+// @param skipRanges : Runs of words to leave out when parsing the SPIR-V of the shader module (optional)
+ModulePass *Llpc::createSpirvLowerTranslator(ShaderStage stage, const PipelineShaderInfo *shaderInfo,
+                                             SpirvModuleCache *spirvModuleCache, ArrayRef<SpirvWordRange> skipRanges) {
+  return new SpirvLowerTranslator(stage, shaderInfo, spirvModuleCache, skipRanges);
 }
 
 // =====================================================================================================================
@@ -78,15 +84,33 @@ bool SpirvLowerTranslator::runOnModule(llvm::Module &module) {
 // @param shaderInfo : Specialization info
 // @param [in/out] module : Module to translate into, initially empty
 void SpirvLowerTranslator::translateSpirvToLlvm(const PipelineShaderInfo *shaderInfo, Module *module) {
-  BinaryData optimizedSpirvBin = {};
   const ShaderModuleData *moduleData = reinterpret_cast<const ShaderModuleData *>(shaderInfo->pModuleData);
   assert(moduleData->binType == BinaryType::Spirv);
-  const BinaryData *spirvBin = &moduleData->binCode;
-  if (ShaderModuleHelper::optimizeSpirv(spirvBin, &optimizedSpirvBin) == Result::Success)
-    spirvBin = &optimizedSpirvBin;
 
-  std::string spirvCode(static_cast<const char *>(spirvBin->pCode), spirvBin->codeSize);
-  std::istringstream spirvStream(spirvCode);
+  // Reuse the parsed SPIR-V module if an earlier pipeline left it in the cache.
+  MetroHash::Hash cacheHash = {};
+  memcpy(cacheHash.dwords, moduleData->cacheHash, sizeof(cacheHash));
+  std::unique_ptr<SPIRV::SPIRVModule> spirvModule;
+  if (m_spirvModuleCache)
+    spirvModule = m_spirvModuleCache->acquire(cacheHash);
+
+  if (!spirvModule) {
+    BinaryData optimizedSpirvBin = {};
+    const BinaryData *spirvBin = &moduleData->binCode;
+    ArrayRef<SpirvWordRange> skipRanges = m_skipRanges;
+    if (ShaderModuleHelper::optimizeSpirv(spirvBin, &optimizedSpirvBin) == Result::Success) {
+      spirvBin = &optimizedSpirvBin;
+      skipRanges = {};
+    }
+
+    // Parse the SPIR-V straight from the binary, leaving out the skipped runs, rather than from a copy of it.
+    SpirvTrimStreamBuf spirvStreamBuf(spirvBin, skipRanges);
+    std::istream spirvStream(&spirvStreamBuf);
+    spirvModule.reset(parseSpirv(spirvStream));
+
+    ShaderModuleHelper::cleanOptimizedSpirv(&optimizedSpirvBin);
+  }
+
   std::string errMsg;
   SPIRV::SPIRVSpecConstMap specConstMap;
   ShaderStage entryStage = shaderInfo->entryStage;
@@ -103,7 +127,7 @@ void SpirvLowerTranslator::translateSpirvToLlvm(const PipelineShaderInfo *shader
 
   Context *context = static_cast<Context *>(&module->getContext());
 
-  if (!readSpirv(context->getBuilder(), &(moduleData->usage), spirvStream, convertToExecModel(entryStage),
+  if (!readSpirv(context->getBuilder(), &(moduleData->usage), spirvModule.get(), convertToExecModel(entryStage),
                  shaderInfo->pEntryTarget, specConstMap, module, errMsg)) {
     report_fatal_error(Twine("Failed to translate SPIR-V to LLVM (") +
                            getShaderStageName(static_cast<ShaderStage>(entryStage)) + " shader): " + errMsg,
@@ -114,7 +138,8 @@ void SpirvLowerTranslator::translateSpirvToLlvm(const PipelineShaderInfo *shader
   // rather than a pipeline compile.
   m_context->getBuilder()->recordShaderModes(module);
 
-  ShaderModuleHelper::cleanOptimizedSpirv(&optimizedSpirvBin);
+  if (m_spirvModuleCache && isSpirvModuleReusable(spirvModule.get()))
+    m_spirvModuleCache->release(cacheHash, std::move(spirvModule));
 
   // NOTE: Our shader entrypoint is marked in the SPIR-V reader as dllexport. Here we mark it as follows:
   //   * remove the dllexport;
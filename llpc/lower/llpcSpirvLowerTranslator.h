@@ -44,8 +44,11 @@ public:
   //
   // @param stage : Shader stage
   // @param shaderInfo : Shader info for this shader
-  SpirvLowerTranslator(ShaderStage stage, const PipelineShaderInfo *shaderInfo)
-      : SpirvLower(ID), m_shaderInfo(shaderInfo) {}
+  // @param spirvModuleCache : Cache of parsed SPIR-V modules (optional)
+  // @param skipRanges : Runs of words to leave out when parsing the SPIR-V of the shader module (optional)
+  SpirvLowerTranslator(ShaderStage stage, const PipelineShaderInfo *shaderInfo,
+                       SpirvModuleCache *spirvModuleCache = nullptr, llvm::ArrayRef<SpirvWordRange> skipRanges = {})
+      : SpirvLower(ID), m_shaderInfo(shaderInfo), m_spirvModuleCache(spirvModuleCache), m_skipRanges(skipRanges) {}
 
   bool runOnModule(llvm::Module &module) override;
 
@@ -57,7 +60,9 @@ private:
 
   // -----------------------------------------------------------------------------------------------------------------
 
-  const PipelineShaderInfo *m_shaderInfo; // Input shader info
+  const PipelineShaderInfo *m_shaderInfo;      // Input shader info
+  SpirvModuleCache *m_spirvModuleCache;        // Cache of parsed SPIR-V modules, or nullptr
+  llvm::ArrayRef<SpirvWordRange> m_skipRanges; // Runs of words to leave out when parsing the SPIR-V
 };
 
 } // namespace Llpc
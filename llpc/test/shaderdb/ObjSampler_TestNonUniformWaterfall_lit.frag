@@ -0,0 +1,30 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(set = 0, binding = 0) uniform sampler2D samplers[];
+layout(set = 1, binding = 0) uniform Indices
+{
+    int uniformIndex;
+};
+
+layout(location = 0) flat in int divergentIndex;
+layout(location = 1) in vec2 texCoord;
+layout(location = 0) out vec4 fragColor;
+
+void main()
+{
+    fragColor = texture(samplers[nonuniformEXT(uniformIndex)], texCoord) +
+                texture(samplers[nonuniformEXT(divergentIndex)], texCoord);
+}
+
+// BEGIN_SHADERTEST
+/*
+; Both samples are marked non-uniform, but only the one whose index comes from a fragment shader input keeps its
+; waterfall loop; the index loaded from the uniform buffer is proved uniform.
+; RUN: amdllpc -spvgen-dir=%spvgendir% -v %gfxip %s | FileCheck -check-prefix=SHADERTEST %s
+; SHADERTEST-LABEL: {{^// LLPC}} pipeline patching results
+; SHADERTEST: call {{.*}} @llvm.amdgcn.waterfall.begin
+; SHADERTEST-NOT: call {{.*}} @llvm.amdgcn.waterfall.begin
+; SHADERTEST: AMDLLPC SUCCESS
+*/
+// END_SHADERTEST
@@ -0,0 +1,29 @@
+#version 450 core
+
+layout(binding = 0) uniform Uniforms
+{
+    vec4 data[4];
+};
+
+layout(location = 0) out vec4 f;
+
+void main()
+{
+    vec4 f4 = vec4(0.0);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        f4 += data[i];
+    }
+
+    f = f4;
+}
+// BEGIN_SHADERTEST
+/*
+; RUN: amdllpc -spvgen-dir=%spvgendir% -v %gfxip -fast-compile %s | FileCheck -check-prefix=SHADERTEST %s
+; The fast compile tier does not run loop optimizations, so the loop is still there after patching.
+; SHADERTEST-LABEL: {{^// LLPC}} pipeline patching results
+; SHADERTEST: phi i32
+; SHADERTEST: AMDLLPC SUCCESS
+*/
+// END_SHADERTEST
@@ -0,0 +1,30 @@
+#version 450 core
+
+layout(binding = 0) uniform Uniforms
+{
+    vec4 data[4];
+};
+
+layout(location = 0) out vec4 f;
+
+void main()
+{
+    vec4 f4 = vec4(0.0);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        f4 += data[i];
+    }
+
+    f = f4;
+}
+// BEGIN_SHADERTEST
+/*
+; RUN: amdllpc -spvgen-dir=%spvgendir% -v %gfxip -new-pm-patch-opt %s | FileCheck -check-prefix=SHADERTEST %s
+; The curated optimizations run by the new pass manager fully unroll the loop, as the legacy pass manager does.
+; SHADERTEST-LABEL: {{^// LLPC}} pipeline patching results
+; SHADERTEST-NOT: phi
+; SHADERTEST: call void @llvm.amdgcn.exp.f32
+; SHADERTEST: AMDLLPC SUCCESS
+*/
+// END_SHADERTEST
@@ -61,6 +61,7 @@
 #endif
 #endif
 
+#include <map>
 #include <sstream>
 #include <stdlib.h> // getenv
 
@@ -75,6 +76,7 @@
 #endif
 #include "llpc.h"
 #include "llpcDebug.h"
+#include "llpcOccupancyTuner.h"
 #include "llpcShaderModuleHelper.h"
 #include "llpcSpirvLowerUtil.h"
 #include "llpcUtil.h"
@@ -231,6 +233,17 @@ static cl::opt<std::string> SpvGenDir("spvgen-dir", cl::desc("Directory to load
 static cl::opt<bool> RobustBufferAccess("robust-buffer-access", cl::desc("Validate if the index is out of bounds"),
                                         cl::init(false));
 
+// -fast-compile: compile pipelines with the fast compile tier
+static cl::opt<bool> FastCompile("fast-compile", cl::desc("Compile pipelines with the fast compile tier"),
+                                 cl::init(false));
+
+// -shader-stats-file: append the shader statistics of each compiled pipeline to the specified file
+static cl::opt<std::string> ShaderStatsFile("shader-stats-file",
+                                            cl::desc("Append the shader statistics of each compiled pipeline (see "
+                                                     "-include-shader-stats) to the specified file, one line per "
+                                                     "hardware stage"),
+                                            cl::value_desc("filename"), cl::init(""));
+
 // -check-auto-layout-compatible: check if auto descriptor layout got from spv file is commpatible with real layout
 static cl::opt<bool> CheckAutoLayoutCompatible(
     "check-auto-layout-compatible",
@@ -881,6 +894,138 @@ static Result decodePipelineBinary(const BinaryData *pipelineBin, CompileInfo *c
   return Result::Success;
 }
 
+// Totals of the shader statistics over all compiled pipelines
+struct ShaderStatsTotals {
+  unsigned pipelineCount;               // Pipelines with shader statistics
+  unsigned shaderCount;                 // Hardware stages with shader statistics
+  unsigned minOccupancy;                // Lowest occupancy (waves per SIMD) of any hardware stage
+  std::map<std::string, uint64_t> sums; // Sum of each statistic over all hardware stages
+};
+
+static ShaderStatsTotals StatsTotals = {0, 0, UINT_MAX, {}};
+
+// =====================================================================================================================
+// Collects the shader statistics from the ELF of a compiled pipeline, if it has them (see -include-shader-stats).
+// The code size of each hardware stage is added to them, from the size of its entry-point symbol, and its register
+// counts and occupancy, from the PAL metadata. The statistics are added to the totals printed at exit, and, with
+// -shader-stats-file, appended to that file, so two runs over a set of pipelines can be compared.
+//
+// @param pipelineBin : Pipeline ELF
+// @param compileInfo : Compilation info of LLPC standalone tool
+static void collectShaderStats(const BinaryData *pipelineBin, const CompileInfo *compileInfo) {
+  ElfReader<Elf64> reader(compileInfo->gfxIp);
+  size_t readSize = 0;
+  const void *statsData = nullptr;
+  size_t statsSize = 0;
+  if (reader.ReadFromBuffer(pipelineBin->pCode, &readSize) != Result::Success ||
+      !reader.isSectionPresent(ShaderStatsName) ||
+      reader.GetSectionData(ShaderStatsName, &statsData, &statsSize) != Result::Success)
+    return;
+
+  msgpack::Document statsDocument;
+  if (!statsDocument.readFromBlob(StringRef(static_cast<const char *>(statsData), statsSize), false) ||
+      statsDocument.getRoot().getKind() != msgpack::Type::Map)
+    return;
+  auto hwStages = statsDocument.getRoot().getMap()[".hardware_stages"];
+  if (hwStages.getKind() != msgpack::Type::Map)
+    return;
+
+  // Get the hardware stages from the PAL metadata, for their register usage.
+  msgpack::Document palDocument;
+  msgpack::DocNode palHwStages;
+  if (reader.isSectionPresent(NoteName)) {
+    ElfNote note = reader.getNote(Util::Abi::PipelineAbiNoteType::PalMetadata);
+    if (note.data &&
+        palDocument.readFromBlob(StringRef(reinterpret_cast<const char *>(note.data), note.hdr.descSize), false)) {
+      auto pipelines = palDocument.getRoot().getMap(true)[Util::Abi::PalCodeObjectMetadataKey::Pipelines];
+      if (pipelines.getKind() == msgpack::Type::Array && pipelines.getArray().size() != 0)
+        palHwStages = pipelines.getArray()[0].getMap(true)[Util::Abi::PipelineMetadataKey::HardwareStages];
+    }
+  }
+
+  // Get the code size of each hardware stage from the size of its entry-point symbol.
+  std::map<std::string, uint64_t> symbolSizes;
+  for (unsigned i = 0; i < reader.getSymbolCount(); ++i) {
+    ElfSymbol symbol = {};
+    reader.getSymbol(i, &symbol);
+    if (symbol.pSymName)
+      symbolSizes[symbol.pSymName] = symbol.size;
+  }
+
+  std::string lines;
+  raw_string_ostream linesStream(lines);
+  StringRef fileNames = StringRef(compileInfo->fileNames).rtrim();
+  ++StatsTotals.pipelineCount;
+  for (auto &hwStage : hwStages.getMap()) {
+    if (hwStage.first.getKind() != msgpack::Type::String || hwStage.second.getKind() != msgpack::Type::Map)
+      continue;
+    ++StatsTotals.shaderCount;
+    linesStream << fileNames << " " << hwStage.first.getString();
+    for (auto &stat : hwStage.second.getMap()) {
+      if (stat.first.getKind() != msgpack::Type::String || stat.second.getKind() != msgpack::Type::UInt)
+        continue;
+      linesStream << " " << stat.first.getString() << "=" << stat.second.getUInt();
+      StatsTotals.sums[stat.first.getString().str()] += stat.second.getUInt();
+    }
+
+    auto symbolSizeIt = symbolSizes.find((Twine("_amdgpu_") + hwStage.first.getString().drop_front() + "_main").str());
+    if (symbolSizeIt != symbolSizes.end()) {
+      linesStream << " .isa_size=" << symbolSizeIt->second;
+      StatsTotals.sums[".isa_size"] += symbolSizeIt->second;
+    }
+
+    if (palHwStages.getKind() == msgpack::Type::Map) {
+      auto palHwStageIt = palHwStages.getMap().find(hwStage.first);
+      if (palHwStageIt != palHwStages.getMap().end() && palHwStageIt->second.getKind() == msgpack::Type::Map) {
+        // Get an unsigned value from the PAL metadata of the hardware stage, or the default if it is absent.
+        auto &palHwStage = palHwStageIt->second.getMap();
+        auto getUInt = [&palHwStage](StringRef key, unsigned defaultValue) -> unsigned {
+          auto it = palHwStage.find(key);
+          if (it == palHwStage.end() || it->second.getKind() != msgpack::Type::UInt)
+            return defaultValue;
+          return it->second.getUInt();
+        };
+        unsigned vgprCount = getUInt(Util::Abi::HardwareStageMetadataKey::VgprCount, 0);
+        unsigned sgprCount = getUInt(Util::Abi::HardwareStageMetadataKey::SgprCount, 0);
+        unsigned occupancy = OccupancyTuner::getWaves(compileInfo->gfxIp, vgprCount, sgprCount,
+                                                      getUInt(Util::Abi::HardwareStageMetadataKey::WavefrontSize, 64));
+        linesStream << " .vgpr_count=" << vgprCount << " .sgpr_count=" << sgprCount << " .occupancy=" << occupancy;
+        StatsTotals.sums[".vgpr_count"] += vgprCount;
+        StatsTotals.sums[".sgpr_count"] += sgprCount;
+        StatsTotals.sums[".occupancy"] += occupancy;
+        StatsTotals.minOccupancy = std::min(StatsTotals.minOccupancy, occupancy);
+      }
+    }
+    linesStream << "\n";
+  }
+  linesStream.flush();
+
+  if (!ShaderStatsFile.empty()) {
+    std::error_code errCode;
+    raw_fd_ostream statsStream(ShaderStatsFile, errCode, sys::fs::F_Append | sys::fs::F_Text);
+    if (errCode) {
+      LLPC_ERRS("Failed to open shader statistics file " << ShaderStatsFile << ": " << errCode.message() << "\n");
+    } else
+      statsStream << lines;
+  }
+}
+
+// =====================================================================================================================
+// Prints the totals of the shader statistics over all compiled pipelines, if any had them.
+static void printShaderStatsTotals() {
+  if (StatsTotals.shaderCount == 0)
+    return;
+  outs() << "===============================================================================\n";
+  outs() << "// LLPC shader statistics totals\n\n";
+  outs() << left_justify("pipelines", 30) << " = " << StatsTotals.pipelineCount << "\n";
+  outs() << left_justify("hardware stages", 30) << " = " << StatsTotals.shaderCount << "\n";
+  for (const auto &sum : StatsTotals.sums)
+    outs() << left_justify(sum.first, 30) << " = " << sum.second << "\n";
+  if (StatsTotals.minOccupancy != UINT_MAX)
+    outs() << left_justify("min occupancy", 30) << " = " << StatsTotals.minOccupancy << "\n";
+  outs() << "\n";
+}
+
 // =====================================================================================================================
 // Builds shader module based on the specified SPIR-V binary.
 //
@@ -1033,6 +1178,8 @@ static Result buildPipeline(ICompiler *compiler, CompileInfo *compileInfo) {
       pipelineInfo->iaState.patchControlPoints = 3;
 
     pipelineInfo->options.robustBufferAccess = RobustBufferAccess;
+    if (FastCompile)
+      pipelineInfo->options.fastCompile = true;
 
     void *pipelineDumpHandle = nullptr;
     if (llvm::cl::EnablePipelineDump) {
@@ -1066,6 +1213,7 @@ static Result buildPipeline(ICompiler *compiler, CompileInfo *compileInfo) {
       }
 
       result = decodePipelineBinary(&pipelineOut->pipelineBin, compileInfo, true);
+      collectShaderStats(&pipelineOut->pipelineBin, compileInfo);
     }
   }
   else {
@@ -1098,6 +1246,8 @@ static Result buildPipeline(ICompiler *compiler, CompileInfo *compileInfo) {
     pipelineInfo->pUserData = &compileInfo->pipelineBuf;
     pipelineInfo->pfnOutputAlloc = allocateBuffer;
     pipelineInfo->options.robustBufferAccess = RobustBufferAccess;
+    if (FastCompile)
+      pipelineInfo->options.fastCompile = true;
 
     void *pipelineDumpHandle = nullptr;
     if (llvm::cl::EnablePipelineDump) {
@@ -1130,6 +1280,7 @@ static Result buildPipeline(ICompiler *compiler, CompileInfo *compileInfo) {
       }
 
       result = decodePipelineBinary(&pipelineOut->pipelineBin, compileInfo, false);
+      collectShaderStats(&pipelineOut->pipelineBin, compileInfo);
     }
   }
 
@@ -1630,6 +1781,8 @@ int main(int argc, char *argv[]) {
 
   compiler->Destroy();
 
+  printShaderStatsTotals();
+
   if (result == Result::Success) {
     LLPC_OUTS("\n=====  AMDLLPC SUCCESS  =====\n");
   } else {
@@ -117,6 +117,26 @@ bool readSpirv(lgc::Builder *Builder,
                llvm::Module *M,
                std::string &ErrMsg);
 
+/// \brief Translate an already parsed SPIRV module to LLVM module.
+/// \returns true if succeeds.
+bool readSpirv(lgc::Builder *Builder,
+               const Vkgc::ShaderModuleUsage* ModuleData,
+               SPIRV::SPIRVModule *BM,
+               spv::ExecutionModel EntryExecModel,
+               const char *EntryName,
+               const SPIRV::SPIRVSpecConstMap &SpecConstMap,
+               llvm::Module *M,
+               std::string &ErrMsg);
+
+/// \brief Parse SPIRV from istream into a new SPIRV module.
+/// \returns the module, owned by the caller.
+SPIRV::SPIRVModule *parseSpirv(std::istream &IS);
+
+/// \brief Check whether translation leaves a parsed SPIRV module unchanged, so
+/// that it may be translated again. This is not the case if the module has
+/// specialization constants, as their values are written back into the module.
+bool isSpirvModuleReusable(const SPIRV::SPIRVModule *BM);
+
 /// \brief Regularize LLVM module by removing entities not representable by
 /// SPIRV.
 bool regularizeLlvmForSpirv(llvm::Module *M, std::string &ErrMsg);
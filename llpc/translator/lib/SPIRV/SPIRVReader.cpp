@@ -8077,13 +8077,17 @@ llvm::GlobalValue::LinkageTypes SPIRVToLLVM::transLinkageType(const SPIRVValue *
 bool llvm::readSpirv(Builder *builder, const ShaderModuleUsage *shaderInfo, std::istream &is,
                      spv::ExecutionModel entryExecModel, const char *entryName, const SPIRVSpecConstMap &specConstMap,
                      Module *m, std::string &errMsg) {
-  assert(entryExecModel != ExecutionModelKernel && "Not support ExecutionModelKernel");
+  std::unique_ptr<SPIRVModule> bm(parseSpirv(is));
 
-  std::unique_ptr<SPIRVModule> bm(SPIRVModule::createSPIRVModule());
+  return readSpirv(builder, shaderInfo, bm.get(), entryExecModel, entryName, specConstMap, m, errMsg);
+}
 
-  is >> *bm;
+bool llvm::readSpirv(Builder *builder, const ShaderModuleUsage *shaderInfo, SPIRVModule *bm,
+                     spv::ExecutionModel entryExecModel, const char *entryName, const SPIRVSpecConstMap &specConstMap,
+                     Module *m, std::string &errMsg) {
+  assert(entryExecModel != ExecutionModelKernel && "Not support ExecutionModelKernel");
 
-  SPIRVToLLVM btl(m, bm.get(), specConstMap, builder, shaderInfo);
+  SPIRVToLLVM btl(m, bm, specConstMap, builder, shaderInfo);
   bool succeed = true;
   if (!btl.translate(entryExecModel, entryName)) {
     bm->getError(errMsg);
@@ -8095,3 +8099,27 @@ bool llvm::readSpirv(Builder *builder, const ShaderModuleUsage *shaderInfo, std:
 
   return succeed;
 }
+
+SPIRVModule *llvm::parseSpirv(std::istream &is) {
+  SPIRVModule *bm = SPIRVModule::createSPIRVModule();
+  is >> *bm;
+  return bm;
+}
+
+bool llvm::isSpirvModuleReusable(const SPIRVModule *bm) {
+  // Specialization constants get their values from the pipeline, and SPIRVToLLVM::translate() stores those
+  // values (and the folded results of OpSpecConstantOp) back into the module.
+  for (unsigned i = 0, e = bm->getNumConstants(); i != e; ++i) {
+    switch (bm->getConstant(i)->getOpCode()) {
+    case OpSpecConstant:
+    case OpSpecConstantTrue:
+    case OpSpecConstantFalse:
+    case OpSpecConstantComposite:
+    case OpSpecConstantOp:
+      return false;
+    default:
+      break;
+    }
+  }
+  return true;
+}
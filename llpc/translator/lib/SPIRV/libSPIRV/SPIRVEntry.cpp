@@ -57,10 +57,15 @@ using namespace SPIRV;
 
 namespace SPIRV {
 
-template <typename T> SPIRVEntry *create() { return new T(); }
+template <typename T> SPIRVEntry *create(SPIRVModule *M) { return new (M) T(); }
 
-SPIRVEntry *SPIRVEntry::create(Op OpCode) {
-  typedef SPIRVEntry *(*SPIRVFactoryTy)();
+void *SPIRVEntry::operator new(size_t Size, SPIRVModule *M) {
+  assert(M && "Entry must be allocated from a module");
+  return M->allocateEntry(Size);
+}
+
+SPIRVEntry *SPIRVEntry::create(Op OpCode, SPIRVModule *M) {
+  typedef SPIRVEntry *(*SPIRVFactoryTy)(SPIRVModule *);
   struct TableEntry {
     Op Opn;
     SPIRVFactoryTy Factory;
@@ -81,21 +86,12 @@ SPIRVEntry *SPIRVEntry::create(Op OpCode) {
 
   OpToFactoryMapTy::const_iterator Loc = OpToFactoryMap.find(OpCode);
   if (Loc != OpToFactoryMap.end())
-    return Loc->second();
+    return Loc->second(M);
 
   assert(0 && "Not implemented");
   return 0;
 }
 
-std::unique_ptr<SPIRV::SPIRVEntry> SPIRVEntry::createUnique(Op OC) {
-  return std::unique_ptr<SPIRVEntry>(create(OC));
-}
-
-std::unique_ptr<SPIRV::SPIRVExtInst>
-SPIRVEntry::createUnique(SPIRVExtInstSetKind Set, unsigned ExtOp) {
-  return std::unique_ptr<SPIRVExtInst>(new SPIRVExtInst(Set, ExtOp));
-}
-
 SPIRVErrorLog &SPIRVEntry::getErrorLog() const { return Module->getErrorLog(); }
 
 bool SPIRVEntry::exist(SPIRVId TheId) const { return Module->exist(TheId); }
@@ -211,11 +207,11 @@ void SPIRVEntry::addDecorate(const SPIRVDecorate *Dec) {
 }
 
 void SPIRVEntry::addDecorate(Decoration Kind) {
-  addDecorate(new SPIRVDecorate(Kind, this));
+  addDecorate(new (Module) SPIRVDecorate(Kind, this));
 }
 
 void SPIRVEntry::addDecorate(Decoration Kind, SPIRVWord Literal) {
-  addDecorate(new SPIRVDecorate(Kind, this, Literal));
+  addDecorate(new (Module) SPIRVDecorate(Kind, this, Literal));
 }
 
 void SPIRVEntry::eraseDecorate(Decoration Dec) { Decorates.erase(Dec); }
@@ -237,12 +233,12 @@ void SPIRVEntry::addMemberDecorate(const SPIRVMemberDecorate *Dec){
 }
 
 void SPIRVEntry::addMemberDecorate(SPIRVWord MemberNumber, Decoration Kind) {
-  addMemberDecorate(new SPIRVMemberDecorate(Kind, MemberNumber, this));
+  addMemberDecorate(new (Module) SPIRVMemberDecorate(Kind, MemberNumber, this));
 }
 
 void SPIRVEntry::addMemberDecorate(SPIRVWord MemberNumber, Decoration Kind,
                                    SPIRVWord Literal) {
-  addMemberDecorate(new SPIRVMemberDecorate(Kind, MemberNumber, this, Literal));
+  addMemberDecorate(new (Module) SPIRVMemberDecorate(Kind, MemberNumber, this, Literal));
 }
 
 void SPIRVEntry::eraseMemberDecorate(SPIRVWord MemberNumber, Decoration Dec) {
@@ -317,7 +313,7 @@ SPIRVLinkageTypeKind SPIRVEntry::getLinkageType() const {
 void SPIRVEntry::setLinkageType(SPIRVLinkageTypeKind LT) {
   assert(isValid(LT));
   assert(hasLinkageType());
-  addDecorate(new SPIRVDecorateLinkageAttr(this, Name, LT));
+  addDecorate(new (Module) SPIRVDecorateLinkageAttr(this, Name, LT));
 }
 
 void SPIRVEntry::updateModuleVersion() const {
@@ -215,6 +215,14 @@ public:
 
   virtual ~SPIRVEntry() {}
 
+  // Entries are allocated from the arena of the module that owns them, and the
+  // storage is released in bulk when that module is destroyed. Deleting an
+  // entry therefore only runs its destructor.
+  static void *operator new(size_t Size, SPIRVModule *M);
+  static void operator delete(void *, SPIRVModule *) {}
+  static void operator delete(void *) {}
+  static void *operator new(size_t) = delete;
+
   bool exist(SPIRVId) const;
   template <class T> T *get(SPIRVId TheId) const {
     return static_cast<T *>(getEntry(TheId));
@@ -291,13 +299,8 @@ public:
   virtual void setWordCount(SPIRVWord TheWordCount);
 
   /// Create an empty SPIRV object by op code, e.g. OpTypeInt creates
-  /// SPIRVTypeInt.
-  static SPIRVEntry *create(Op);
-  static std::unique_ptr<SPIRVEntry> createUnique(Op);
-
-  /// Create an empty extended instruction.
-  static std::unique_ptr<SPIRVExtInst> createUnique(SPIRVExtInstSetKind Set,
-                                                    unsigned ExtOp);
+  /// SPIRVTypeInt. The object is allocated from the arena of module M.
+  static SPIRVEntry *create(Op, SPIRVModule *M);
 
   friend std::istream &operator>>(std::istream &I, SPIRVEntry &E);
   virtual void decode(std::istream &I);
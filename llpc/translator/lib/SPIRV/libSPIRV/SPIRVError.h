@@ -83,6 +83,7 @@ public:
     ErrMsg = ErrorMsg;
     return ErrorCode;
   }
+  SPIRVErrorCode getErrorCode() const { return ErrorCode; }
   void setError(SPIRVErrorCode ErrCode, const std::string &ErrMsg) {
     ErrorCode = ErrCode;
     ErrorMsg = ErrMsg;
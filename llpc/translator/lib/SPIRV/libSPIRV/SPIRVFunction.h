@@ -124,7 +124,7 @@ public:
 
 private:
   SPIRVFunctionParameter *addArgument(unsigned TheArgNo, SPIRVId TheId) {
-    SPIRVFunctionParameter *Arg = new SPIRVFunctionParameter(
+    SPIRVFunctionParameter *Arg = new (Module) SPIRVFunctionParameter(
         getFunctionType()->getParameterType(TheArgNo), TheId, this, TheArgNo);
     Module->add(Arg);
     Parameters.push_back(Arg);
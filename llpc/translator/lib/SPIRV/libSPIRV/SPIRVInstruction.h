@@ -160,8 +160,9 @@ class SPIRVInstTemplateBase : public SPIRVInstruction {
 public:
   /// Create an empty instruction. Mainly for getting format information,
   /// e.g. whether an operand is literal.
-  static SPIRVInstTemplateBase *create(Op TheOC) {
-    auto Inst = static_cast<SPIRVInstTemplateBase *>(SPIRVEntry::create(TheOC));
+  static SPIRVInstTemplateBase *create(Op TheOC, SPIRVModule *TheModule) {
+    auto Inst = static_cast<SPIRVInstTemplateBase *>(
+        SPIRVEntry::create(TheOC, TheModule));
     assert(Inst);
     Inst->init();
     return Inst;
@@ -170,7 +171,7 @@ public:
   static SPIRVInstTemplateBase *create(Op TheOC, SPIRVType *TheType,
                                        SPIRVId TheId, SPIRVBasicBlock *TheBB,
                                        SPIRVModule *TheModule) {
-    auto Inst = create(TheOC);
+    auto Inst = create(TheOC, TheModule);
     Inst->init(TheType, TheId, TheBB, TheModule);
     return Inst;
   }
@@ -180,7 +181,7 @@ public:
                                        const std::vector<SPIRVWord> &TheOps,
                                        SPIRVBasicBlock *TheBB,
                                        SPIRVModule *TheModule) {
-    auto Inst = create(TheOC);
+    auto Inst = create(TheOC, TheModule);
     Inst->init(TheType, TheId, TheBB, TheModule);
     Inst->setOpWords(TheOps);
     Inst->validate();
@@ -478,7 +479,7 @@ public:
   }
   void setBuiltin(SPIRVBuiltinVariableKind Kind) {
     assert(isValid(Kind));
-    addDecorate(new SPIRVDecorate(DecorationBuiltIn, this, Kind));
+    addDecorate(new (Module) SPIRVDecorate(DecorationBuiltIn, this, Kind));
   }
   std::vector<SPIRVEntry *> getNonLiteralOperands() const override {
     if (SPIRVValue *V = getInitializer())
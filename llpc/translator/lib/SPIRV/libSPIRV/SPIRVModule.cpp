@@ -46,7 +46,10 @@
 #include "SPIRVStream.h"
 #include "SPIRVType.h"
 #include "SPIRVValue.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/Allocator.h"
 
+#include <cstddef>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
@@ -78,6 +81,11 @@ public:
   SPIRVEntry *getEntry(SPIRVId Id) const override;
   bool hasDebugInfo() const override { return !StringVec.empty(); }
 
+  // Entry storage functions
+  void *allocateEntry(size_t Size) override {
+    return EntryAllocator.Allocate(Size, alignof(std::max_align_t));
+  }
+
   // Error handling functions
   SPIRVErrorLog &getErrorLog() override { return ErrLog; }
   SPIRVErrorCode getError(std::string &ErrMsg) override {
@@ -340,6 +348,10 @@ public:
   friend std::istream &operator>>(std::istream &I, SPIRVModule &M);
 
 private:
+  // Arena for all entries owned by this module. It is declared first so that
+  // it outlives every member that may still refer to an entry (e.g. the shared
+  // OpLine entries) during destruction.
+  llvm::BumpPtrAllocator EntryAllocator;
   SPIRVErrorLog ErrLog;
   SPIRVId NextId;
   SPIRVWord SPIRVVersion;
@@ -353,7 +365,13 @@ private:
   SPIRVAddressingModelKind AddrModel;
   SPIRVMemoryModelKind MemoryModel;
 
-  typedef std::map<SPIRVId, SPIRVEntry *> SPIRVIdToEntryMap;
+  typedef llvm::DenseMap<SPIRVId, SPIRVEntry *> SPIRVIdToEntryMap;
+  // DenseMap reserves ~0U and ~0U - 1 as its empty and tombstone keys, so
+  // those ids can never be stored in or looked up in IdEntryMap.
+  static bool isMappableId(SPIRVId Id) {
+    return Id != llvm::DenseMapInfo<SPIRVId>::getEmptyKey() &&
+           Id != llvm::DenseMapInfo<SPIRVId>::getTombstoneKey();
+  }
   typedef std::vector<SPIRVEntry *> SPIRVEntryVector;
   typedef std::set<SPIRVId> SPIRVIdSet;
   typedef std::vector<SPIRVId> SPIRVIdVec;
@@ -397,6 +415,8 @@ private:
   void layoutEntry(SPIRVEntry *Entry);
 };
 
+// NOTE: Deleting an entry only runs its destructor; the storage itself is
+// released in one go when EntryAllocator is destroyed.
 SPIRVModuleImpl::~SPIRVModuleImpl() {
 
   for (auto I : IdEntryMap)
@@ -430,7 +450,7 @@ SPIRVModuleImpl::setCurrentLine(const std::shared_ptr<const SPIRVLine>& Line) {
 void SPIRVModuleImpl::addLine(SPIRVEntry *E, SPIRVId FileNameId, SPIRVWord Line,
                               SPIRVWord Column) {
   if (!(CurrentLine && CurrentLine->equals(FileNameId, Line, Column)))
-    CurrentLine.reset(new SPIRVLine(this, FileNameId, Line, Column));
+    CurrentLine.reset(new (this) SPIRVLine(this, FileNameId, Line, Column));
   assert(E && "invalid entry");
   E->setLine(CurrentLine);
 }
@@ -449,7 +469,7 @@ void SPIRVModuleImpl::optimizeDecorates() {
       I = ER.second;
       continue;
     }
-    auto G = add(new SPIRVDecorationGroup(this, getId()));
+    auto G = add(new (this) SPIRVDecorationGroup(this, getId()));
     std::vector<SPIRVId> Targets;
     Targets.push_back(D->getTargetId());
     const_cast<SPIRVDecorateGeneric *>(D)->setTargetId(G->getId());
@@ -466,7 +486,7 @@ void SPIRVModuleImpl::optimizeDecorates() {
     // For now, just skip using a group if the number of targets to too big
     if (Targets.size() < 65530) {
       DecorateSet.erase(ER.first, ER.second);
-      auto GD = add(new SPIRVGroupDecorate(G, Targets));
+      auto GD = add(new (this) SPIRVGroupDecorate(G, Targets));
       DecGroupVec.push_back(G);
       GroupDecVec.push_back(GD);
     }
@@ -478,7 +498,7 @@ void SPIRVModuleImpl::addCapability(SPIRVCapabilityKind Cap) {
   if (hasCapability(Cap))
     return;
 
-  CapMap.insert(std::make_pair(Cap, new SPIRVCapability(this, Cap)));
+  CapMap.insert(std::make_pair(Cap, new (this) SPIRVCapability(this, Cap)));
 }
 
 void SPIRVModuleImpl::addCapabilityInternal(SPIRVCapabilityKind Cap) {
@@ -486,7 +506,7 @@ void SPIRVModuleImpl::addCapabilityInternal(SPIRVCapabilityKind Cap) {
     if (hasCapability(Cap))
       return;
 
-    CapMap.insert(std::make_pair(Cap, new SPIRVCapability(this, Cap)));
+    CapMap.insert(std::make_pair(Cap, new (this) SPIRVCapability(this, Cap)));
   }
 }
 
@@ -495,7 +515,7 @@ SPIRVConstant *SPIRVModuleImpl::getLiteralAsConstant(unsigned Literal) {
   if (Loc != LiteralMap.end())
     return Loc->second;
   auto Ty = addIntegerType(32);
-  auto V = new SPIRVConstant(this, Ty, getId(), static_cast<uint64_t>(Literal));
+  auto V = new (this) SPIRVConstant(this, Ty, getId(), static_cast<uint64_t>(Literal));
   LiteralMap[Literal] = V;
   addConstant(V);
   return V;
@@ -533,6 +553,9 @@ SPIRVEntry *SPIRVModuleImpl::addEntry(SPIRVEntry *Entry) {
   if (Entry->hasId()) {
     SPIRVId Id = Entry->getId();
     assert(Entry->getId() != SPIRVID_INVALID && "Invalid id");
+    if (!ErrLog.checkError(isMappableId(Id), SPIRVEC_InvalidModule,
+                           "Id " + std::to_string(Id) + " is out of range"))
+      return Entry;
     SPIRVEntry *Mapped = nullptr;
     if (exist(Id, &Mapped)) {
       if (Mapped->getOpCode() == OpForward) {
@@ -571,6 +594,8 @@ bool SPIRVModuleImpl::exist(SPIRVId Id) const { return exist(Id, nullptr); }
 
 bool SPIRVModuleImpl::exist(SPIRVId Id, SPIRVEntry **Entry) const {
   assert(Id != SPIRVID_INVALID && "Invalid Id");
+  if (!isMappableId(Id))
+    return false;
   SPIRVIdToEntryMap::const_iterator Loc = IdEntryMap.find(Id);
   if (Loc == IdEntryMap.end())
     return false;
@@ -592,6 +617,8 @@ SPIRVId SPIRVModuleImpl::getId(SPIRVId Id, unsigned Increment) {
 
 SPIRVEntry *SPIRVModuleImpl::getEntry(SPIRVId Id) const {
   assert(Id != SPIRVID_INVALID && "Invalid Id");
+  if (!isMappableId(Id))
+    return nullptr;
   SPIRVIdToEntryMap::const_iterator Loc = IdEntryMap.find(Id);
   assert(Loc != IdEntryMap.end() && "Id is not in map");
   return Loc->second;
@@ -683,29 +710,29 @@ template <class T> T *SPIRVModuleImpl::addType(T *Ty) {
 }
 
 SPIRVTypeVoid *SPIRVModuleImpl::addVoidType() {
-  return addType(new SPIRVTypeVoid(this, getId()));
+  return addType(new (this) SPIRVTypeVoid(this, getId()));
 }
 
 SPIRVTypeArray *SPIRVModuleImpl::addArrayType(SPIRVType *ElementType,
                                               SPIRVConstant *Length) {
-  return addType(new SPIRVTypeArray(this, getId(), ElementType, Length));
+  return addType(new (this) SPIRVTypeArray(this, getId(), ElementType, Length));
 }
 
 SPIRVTypeBool *SPIRVModuleImpl::addBoolType() {
-  return addType(new SPIRVTypeBool(this, getId()));
+  return addType(new (this) SPIRVTypeBool(this, getId()));
 }
 
 SPIRVTypeInt *SPIRVModuleImpl::addIntegerType(unsigned BitWidth) {
   auto Loc = IntTypeMap.find(BitWidth);
   if (Loc != IntTypeMap.end())
     return Loc->second;
-  auto Ty = new SPIRVTypeInt(this, getId(), BitWidth, false);
+  auto Ty = new (this) SPIRVTypeInt(this, getId(), BitWidth, false);
   IntTypeMap[BitWidth] = Ty;
   return addType(Ty);
 }
 
 SPIRVTypeFloat *SPIRVModuleImpl::addFloatType(unsigned BitWidth) {
-  SPIRVTypeFloat *T = addType(new SPIRVTypeFloat(this, getId(), BitWidth));
+  SPIRVTypeFloat *T = addType(new (this) SPIRVTypeFloat(this, getId(), BitWidth));
   return T;
 }
 
@@ -713,33 +740,33 @@ SPIRVTypePointer *
 SPIRVModuleImpl::addPointerType(SPIRVStorageClassKind StorageClass,
                                 SPIRVType *ElementType) {
   return addType(
-      new SPIRVTypePointer(this, getId(), StorageClass, ElementType));
+      new (this) SPIRVTypePointer(this, getId(), StorageClass, ElementType));
 }
 
 SPIRVTypeFunction *SPIRVModuleImpl::addFunctionType(
     SPIRVType *ReturnType, const std::vector<SPIRVType *> &ParameterTypes) {
   return addType(
-      new SPIRVTypeFunction(this, getId(), ReturnType, ParameterTypes));
+      new (this) SPIRVTypeFunction(this, getId(), ReturnType, ParameterTypes));
 }
 
 SPIRVTypeVector *SPIRVModuleImpl::addVectorType(SPIRVType *CompType,
                                                 SPIRVWord CompCount) {
-  return addType(new SPIRVTypeVector(this, getId(), CompType, CompCount));
+  return addType(new (this) SPIRVTypeVector(this, getId(), CompType, CompCount));
 }
 
 SPIRVTypeImage *
 SPIRVModuleImpl::addImageType(SPIRVType *SampledType,
                               const SPIRVTypeImageDescriptor &Desc) {
-  return addType(new SPIRVTypeImage(
+  return addType(new (this) SPIRVTypeImage(
       this, getId(), SampledType ? SampledType->getId() : 0, Desc));
 }
 
 SPIRVTypeSampler *SPIRVModuleImpl::addSamplerType() {
-  return addType(new SPIRVTypeSampler(this, getId()));
+  return addType(new (this) SPIRVTypeSampler(this, getId()));
 }
 
 SPIRVTypeSampledImage *SPIRVModuleImpl::addSampledImageType(SPIRVTypeImage *T) {
-  return addType(new SPIRVTypeSampledImage(this, getId(), T));
+  return addType(new (this) SPIRVTypeSampledImage(this, getId(), T));
 }
 
 void SPIRVModuleImpl::createForwardPointers() {
@@ -761,7 +788,7 @@ void SPIRVModuleImpl::createForwardPointers() {
       auto Ptr = static_cast<SPIRVTypePointer *>(MemberTy);
 
       if (Seen.find(Ptr->getId()) == Seen.end()) {
-        ForwardPointerVec.push_back(new SPIRVTypeForwardPointer(
+        ForwardPointerVec.push_back(new (this) SPIRVTypeForwardPointer(
             this, Ptr, Ptr->getPointerStorageClass()));
       }
     }
@@ -775,13 +802,13 @@ SPIRVFunction *SPIRVModuleImpl::addFunction(SPIRVFunction *Func) {
 
 SPIRVFunction *SPIRVModuleImpl::addFunction(SPIRVTypeFunction *FuncType,
                                             SPIRVId Id) {
-  return addFunction(new SPIRVFunction(
+  return addFunction(new (this) SPIRVFunction(
       this, FuncType, getId(Id, FuncType->getNumParameters() + 1)));
 }
 
 SPIRVBasicBlock *SPIRVModuleImpl::addBasicBlock(SPIRVFunction *Func,
                                                 SPIRVId Id) {
-  return Func->addBasicBlock(new SPIRVBasicBlock(getId(Id), Func));
+  return Func->addBasicBlock(new (this) SPIRVBasicBlock(getId(Id), Func));
 }
 
 const SPIRVDecorateGeneric *
@@ -803,11 +830,11 @@ void SPIRVModuleImpl::addEntryPoint(SPIRVEntryPoint *EntryPoint) {
 }
 
 SPIRVForward *SPIRVModuleImpl::addForward(SPIRVType *Ty) {
-  return add(new SPIRVForward(this, Ty, getId()));
+  return add(new (this) SPIRVForward(this, Ty, getId()));
 }
 
 SPIRVForward *SPIRVModuleImpl::addForward(SPIRVId Id, SPIRVType *Ty) {
-  return add(new SPIRVForward(this, Ty, Id));
+  return add(new (this) SPIRVForward(this, Ty, Id));
 }
 
 SPIRVEntry *SPIRVModuleImpl::replaceForward(SPIRVForward *Forward,
@@ -851,13 +878,13 @@ SPIRVValue *SPIRVModuleImpl::addConstant(SPIRVValue *C) { return add(C); }
 SPIRVValue *SPIRVModuleImpl::addConstant(SPIRVType *Ty, uint64_t V) {
   if (Ty->isTypeBool()) {
     if (V)
-      return addConstant(new SPIRVConstantTrue(this, Ty, getId()));
+      return addConstant(new (this) SPIRVConstantTrue(this, Ty, getId()));
     else
-      return addConstant(new SPIRVConstantFalse(this, Ty, getId()));
+      return addConstant(new (this) SPIRVConstantFalse(this, Ty, getId()));
   }
   if (Ty->isTypeInt())
     return addIntegerConstant(static_cast<SPIRVTypeInt *>(Ty), V);
-  return addConstant(new SPIRVConstant(this, Ty, getId(), V));
+  return addConstant(new (this) SPIRVConstant(this, Ty, getId(), V));
 }
 
 SPIRVValue *SPIRVModuleImpl::addIntegerConstant(SPIRVTypeInt *Ty, uint64_t V) {
@@ -866,28 +893,28 @@ SPIRVValue *SPIRVModuleImpl::addIntegerConstant(SPIRVTypeInt *Ty, uint64_t V) {
     assert(I32 == V && "Integer value truncated");
     return getLiteralAsConstant(I32);
   }
-  return addConstant(new SPIRVConstant(this, Ty, getId(), V));
+  return addConstant(new (this) SPIRVConstant(this, Ty, getId(), V));
 }
 
 SPIRVValue *SPIRVModuleImpl::addFloatConstant(SPIRVTypeFloat *Ty, float V) {
-  return addConstant(new SPIRVConstant(this, Ty, getId(), V));
+  return addConstant(new (this) SPIRVConstant(this, Ty, getId(), V));
 }
 
 SPIRVValue *SPIRVModuleImpl::addDoubleConstant(SPIRVTypeFloat *Ty, double V) {
-  return addConstant(new SPIRVConstant(this, Ty, getId(), V));
+  return addConstant(new (this) SPIRVConstant(this, Ty, getId(), V));
 }
 
 SPIRVValue *SPIRVModuleImpl::addNullConstant(SPIRVType *Ty) {
-  return addConstant(new SPIRVConstantNull(this, Ty, getId()));
+  return addConstant(new (this) SPIRVConstantNull(this, Ty, getId()));
 }
 
 SPIRVValue *SPIRVModuleImpl::addCompositeConstant(
     SPIRVType *Ty, const std::vector<SPIRVValue *> &Elements) {
-  return addConstant(new SPIRVConstantComposite(this, Ty, getId(), Elements));
+  return addConstant(new (this) SPIRVConstantComposite(this, Ty, getId(), Elements));
 }
 
 SPIRVValue *SPIRVModuleImpl::addUndef(SPIRVType *TheType) {
-  return addConstant(new SPIRVUndef(this, TheType, getId()));
+  return addConstant(new (this) SPIRVUndef(this, TheType, getId()));
 }
 
 // Instruction creation functions
@@ -897,7 +924,7 @@ SPIRVModuleImpl::addStoreInst(SPIRVValue *Target, SPIRVValue *Source,
                               const std::vector<SPIRVWord> &TheMemoryAccess,
                               SPIRVBasicBlock *BB) {
   return BB->addInstruction(
-      new SPIRVStore(Target->getId(), Source->getId(), TheMemoryAccess, BB));
+      new (this) SPIRVStore(Target->getId(), Source->getId(), TheMemoryAccess, BB));
 }
 
 SPIRVInstruction *SPIRVModuleImpl::addSwitchInst(
@@ -905,14 +932,14 @@ SPIRVInstruction *SPIRVModuleImpl::addSwitchInst(
     const std::vector<std::pair<std::vector<SPIRVWord>, SPIRVBasicBlock *>>
         &Pairs,
     SPIRVBasicBlock *BB) {
-  return BB->addInstruction(new SPIRVSwitch(Select, Default, Pairs, BB));
+  return BB->addInstruction(new (this) SPIRVSwitch(Select, Default, Pairs, BB));
 }
 SPIRVInstruction *SPIRVModuleImpl::addFModInst(SPIRVType *TheType,
                                                SPIRVId TheDividend,
                                                SPIRVId TheDivisor,
                                                SPIRVBasicBlock *BB) {
   return BB->addInstruction(
-      new SPIRVFMod(TheType, getId(), TheDividend, TheDivisor, BB));
+      new (this) SPIRVFMod(TheType, getId(), TheDividend, TheDivisor, BB));
 }
 
 SPIRVInstruction *
@@ -920,7 +947,7 @@ SPIRVModuleImpl::addVectorTimesScalarInst(SPIRVType *TheType, SPIRVId TheVector,
                                           SPIRVId TheScalar,
                                           SPIRVBasicBlock *BB) {
   return BB->addInstruction(
-      new SPIRVVectorTimesScalar(TheType, getId(), TheVector, TheScalar, BB));
+      new (this) SPIRVVectorTimesScalar(TheType, getId(), TheVector, TheScalar, BB));
 }
 
 SPIRVInstruction *
@@ -947,28 +974,28 @@ SPIRVModuleImpl::addLoadInst(SPIRVValue *Source,
                              const std::vector<SPIRVWord> &TheMemoryAccess,
                              SPIRVBasicBlock *BB) {
   return addInstruction(
-      new SPIRVLoad(getId(), Source->getId(), TheMemoryAccess, BB), BB);
+      new (this) SPIRVLoad(getId(), Source->getId(), TheMemoryAccess, BB), BB);
 }
 
 SPIRVInstruction *
 SPIRVModuleImpl::addPhiInst(SPIRVType *Type,
                             std::vector<SPIRVValue *> IncomingPairs,
                             SPIRVBasicBlock *BB) {
-  return addInstruction(new SPIRVPhi(Type, getId(), IncomingPairs, BB), BB);
+  return addInstruction(new (this) SPIRVPhi(Type, getId(), IncomingPairs, BB), BB);
 }
 
 SPIRVInstruction *SPIRVModuleImpl::addExtInst(
     SPIRVType *TheType, SPIRVWord BuiltinSet, SPIRVWord EntryPoint,
     const std::vector<SPIRVWord> &Args, SPIRVBasicBlock *BB) {
   return addInstruction(
-      new SPIRVExtInst(TheType, getId(), BuiltinSet, EntryPoint, Args, BB), BB);
+      new (this) SPIRVExtInst(TheType, getId(), BuiltinSet, EntryPoint, Args, BB), BB);
 }
 
 SPIRVInstruction *SPIRVModuleImpl::addExtInst(
     SPIRVType *TheType, SPIRVWord BuiltinSet, SPIRVWord EntryPoint,
     const std::vector<SPIRVValue *> &Args, SPIRVBasicBlock *BB) {
   return addInstruction(
-      new SPIRVExtInst(TheType, getId(), BuiltinSet, EntryPoint, Args, BB), BB);
+      new (this) SPIRVExtInst(TheType, getId(), BuiltinSet, EntryPoint, Args, BB), BB);
 }
 
 SPIRVInstruction *
@@ -976,7 +1003,7 @@ SPIRVModuleImpl::addCallInst(SPIRVFunction *TheFunction,
                              const std::vector<SPIRVWord> &TheArguments,
                              SPIRVBasicBlock *BB) {
   return addInstruction(
-      new SPIRVFunctionCall(getId(), TheFunction, TheArguments, BB), BB);
+      new (this) SPIRVFunctionCall(getId(), TheFunction, TheArguments, BB), BB);
 }
 
 SPIRVInstruction *SPIRVModuleImpl::addBinaryInst(Op TheOpCode, SPIRVType *Type,
@@ -990,16 +1017,16 @@ SPIRVInstruction *SPIRVModuleImpl::addBinaryInst(Op TheOpCode, SPIRVType *Type,
 }
 
 SPIRVInstruction *SPIRVModuleImpl::addUnreachableInst(SPIRVBasicBlock *BB) {
-  return addInstruction(new SPIRVUnreachable(BB), BB);
+  return addInstruction(new (this) SPIRVUnreachable(BB), BB);
 }
 
 SPIRVInstruction *SPIRVModuleImpl::addReturnInst(SPIRVBasicBlock *BB) {
-  return addInstruction(new SPIRVReturn(BB), BB);
+  return addInstruction(new (this) SPIRVReturn(BB), BB);
 }
 
 SPIRVInstruction *SPIRVModuleImpl::addReturnValueInst(SPIRVValue *ReturnValue,
                                                       SPIRVBasicBlock *BB) {
-  return addInstruction(new SPIRVReturnValue(ReturnValue, BB), BB);
+  return addInstruction(new (this) SPIRVReturnValue(ReturnValue, BB), BB);
 }
 
 SPIRVInstruction *SPIRVModuleImpl::addUnaryInst(Op TheOpCode,
@@ -1015,14 +1042,14 @@ SPIRVInstruction *SPIRVModuleImpl::addUnaryInst(Op TheOpCode,
 SPIRVInstruction *SPIRVModuleImpl::addVectorExtractDynamicInst(
     SPIRVValue *TheVector, SPIRVValue *Index, SPIRVBasicBlock *BB) {
   return addInstruction(
-      new SPIRVVectorExtractDynamic(getId(), TheVector, Index, BB), BB);
+      new (this) SPIRVVectorExtractDynamic(getId(), TheVector, Index, BB), BB);
 }
 
 SPIRVInstruction *SPIRVModuleImpl::addVectorInsertDynamicInst(
     SPIRVValue *TheVector, SPIRVValue *TheComponent, SPIRVValue *Index,
     SPIRVBasicBlock *BB) {
   return addInstruction(
-      new SPIRVVectorInsertDynamic(getId(), TheVector, TheComponent, Index, BB),
+      new (this) SPIRVVectorInsertDynamic(getId(), TheVector, TheComponent, Index, BB),
       BB);
 }
 
@@ -1030,19 +1057,19 @@ SPIRVValue *SPIRVModuleImpl::addVectorShuffleInst(
     SPIRVType *Type, SPIRVValue *Vec1, SPIRVValue *Vec2,
     const std::vector<SPIRVWord> &Components, SPIRVBasicBlock *BB) {
   return addInstruction(
-      new SPIRVVectorShuffle(getId(), Type, Vec1, Vec2, Components, BB), BB);
+      new (this) SPIRVVectorShuffle(getId(), Type, Vec1, Vec2, Components, BB), BB);
 }
 
 SPIRVInstruction *SPIRVModuleImpl::addBranchInst(SPIRVLabel *TargetLabel,
                                                  SPIRVBasicBlock *BB) {
-  return addInstruction(new SPIRVBranch(TargetLabel, BB), BB);
+  return addInstruction(new (this) SPIRVBranch(TargetLabel, BB), BB);
 }
 
 SPIRVInstruction *SPIRVModuleImpl::addBranchConditionalInst(
     SPIRVValue *Condition, SPIRVLabel *TrueLabel, SPIRVLabel *FalseLabel,
     SPIRVBasicBlock *BB) {
   return addInstruction(
-      new SPIRVBranchConditional(Condition, TrueLabel, FalseLabel, BB), BB);
+      new (this) SPIRVBranchConditional(Condition, TrueLabel, FalseLabel, BB), BB);
 }
 
 SPIRVInstruction *SPIRVModuleImpl::addCmpInst(Op TheOpCode, SPIRVType *TheType,
@@ -1058,7 +1085,7 @@ SPIRVInstruction *SPIRVModuleImpl::addControlBarrierInst(SPIRVValue *ExecKind,
                                                          SPIRVValue *MemKind,
                                                          SPIRVValue *MemSema,
                                                          SPIRVBasicBlock *BB) {
-  return addInstruction(new SPIRVControlBarrier(ExecKind, MemKind, MemSema, BB),
+  return addInstruction(new (this) SPIRVControlBarrier(ExecKind, MemKind, MemSema, BB),
                         BB);
 }
 
@@ -1076,7 +1103,7 @@ SPIRVInstruction *SPIRVModuleImpl::addSelectInst(SPIRVValue *Condition,
                                                  SPIRVValue *Op1,
                                                  SPIRVValue *Op2,
                                                  SPIRVBasicBlock *BB) {
-  return addInstruction(new SPIRVSelect(getId(), Condition->getId(),
+  return addInstruction(new (this) SPIRVSelect(getId(), Condition->getId(),
                                         Op1->getId(), Op2->getId(), BB),
                         BB);
 }
@@ -1084,7 +1111,7 @@ SPIRVInstruction *SPIRVModuleImpl::addSelectInst(SPIRVValue *Condition,
 SPIRVInstruction *SPIRVModuleImpl::addSelectionMergeInst(
     SPIRVId MergeBlock, SPIRVWord SelectionControl, SPIRVBasicBlock *BB) {
   return addInstruction(
-      new SPIRVSelectionMerge(MergeBlock, SelectionControl, BB), BB);
+      new (this) SPIRVSelectionMerge(MergeBlock, SelectionControl, BB), BB);
 }
 
 SPIRVInstruction *SPIRVModuleImpl::addLoopMergeInst(SPIRVId MergeBlock,
@@ -1093,7 +1120,7 @@ SPIRVInstruction *SPIRVModuleImpl::addLoopMergeInst(SPIRVId MergeBlock,
                                                     std::vector<SPIRVWord> LoopControlParameters,
                                                     SPIRVBasicBlock *BB) {
   return addInstruction(
-      new SPIRVLoopMerge(MergeBlock, ContinueTarget, LoopControl, LoopControlParameters, BB), BB);
+      new (this) SPIRVLoopMerge(MergeBlock, ContinueTarget, LoopControl, LoopControlParameters, BB), BB);
 }
 
 SPIRVInstruction *
@@ -1111,7 +1138,7 @@ SPIRVInstruction *SPIRVModuleImpl::addCompositeConstructInst(
     SPIRVType *Type, const std::vector<SPIRVId> &Constituents,
     SPIRVBasicBlock *BB) {
   return addInstruction(
-      new SPIRVCompositeConstruct(Type, getId(), Constituents, BB), BB);
+      new (this) SPIRVCompositeConstruct(Type, getId(), Constituents, BB), BB);
 }
 
 SPIRVInstruction *
@@ -1119,33 +1146,33 @@ SPIRVModuleImpl::addCompositeExtractInst(SPIRVType *Type, SPIRVValue *TheVector,
                                          const std::vector<SPIRVWord> &Indices,
                                          SPIRVBasicBlock *BB) {
   return addInstruction(
-      new SPIRVCompositeExtract(Type, getId(), TheVector, Indices, BB), BB);
+      new (this) SPIRVCompositeExtract(Type, getId(), TheVector, Indices, BB), BB);
 }
 
 SPIRVInstruction *SPIRVModuleImpl::addCompositeInsertInst(
     SPIRVValue *Object, SPIRVValue *Composite,
     const std::vector<SPIRVWord> &Indices, SPIRVBasicBlock *BB) {
   return addInstruction(
-      new SPIRVCompositeInsert(getId(), Object, Composite, Indices, BB), BB);
+      new (this) SPIRVCompositeInsert(getId(), Object, Composite, Indices, BB), BB);
 }
 
 SPIRVInstruction *SPIRVModuleImpl::addCopyObjectInst(SPIRVType *TheType,
                                                      SPIRVValue *Operand,
                                                      SPIRVBasicBlock *BB) {
-  return addInstruction(new SPIRVCopyObject(TheType, getId(), Operand, BB), BB);
+  return addInstruction(new (this) SPIRVCopyObject(TheType, getId(), Operand, BB), BB);
 }
 
 SPIRVInstruction *SPIRVModuleImpl::addCopyMemoryInst(
     SPIRVValue *TheTarget, SPIRVValue *TheSource,
     const std::vector<SPIRVWord> &TheMemoryAccess, SPIRVBasicBlock *BB) {
   return addInstruction(
-      new SPIRVCopyMemory(TheTarget, TheSource, TheMemoryAccess, BB), BB);
+      new (this) SPIRVCopyMemory(TheTarget, TheSource, TheMemoryAccess, BB), BB);
 }
 
 SPIRVInstruction *SPIRVModuleImpl::addCopyMemorySizedInst(
     SPIRVValue *TheTarget, SPIRVValue *TheSource, SPIRVValue *TheSize,
     const std::vector<SPIRVWord> &TheMemoryAccess, SPIRVBasicBlock *BB) {
-  return addInstruction(new SPIRVCopyMemorySized(TheTarget, TheSource, TheSize,
+  return addInstruction(new (this) SPIRVCopyMemorySized(TheTarget, TheSource, TheSize,
                                                  TheMemoryAccess, BB),
                         BB);
 }
@@ -1154,7 +1181,7 @@ SPIRVInstruction *SPIRVModuleImpl::addVariable(
     SPIRVType *Type, bool IsConstant, SPIRVLinkageTypeKind LinkageType,
     SPIRVValue *Initializer, const std::string &Name,
     SPIRVStorageClassKind StorageClass, SPIRVBasicBlock *BB) {
-  SPIRVVariable *Variable = new SPIRVVariable(Type, getId(), Initializer, Name,
+  SPIRVVariable *Variable = new (this) SPIRVVariable(Type, getId(), Initializer, Name,
                                               StorageClass, BB, this);
   if (BB)
     return addInstruction(Variable, BB);
@@ -1181,7 +1208,7 @@ void SPIRVModuleImpl::addTo(std::vector<T *> &V, SPIRVEntry *E) {
 // The second decoration group includes all the decorates defined between the
 // first and second decoration group. So long so forth.
 SPIRVDecorationGroup *SPIRVModuleImpl::addDecorationGroup() {
-  return addDecorationGroup(new SPIRVDecorationGroup(this, getId()));
+  return addDecorationGroup(new (this) SPIRVDecorationGroup(this, getId()));
 }
 
 SPIRVDecorationGroup *
@@ -1202,14 +1229,14 @@ SPIRVModuleImpl::addGroupDecorateGeneric(SPIRVGroupDecorateGeneric *GDec) {
 SPIRVGroupDecorate *
 SPIRVModuleImpl::addGroupDecorate(SPIRVDecorationGroup *Group,
                                   const std::vector<SPIRVEntry *> &Targets) {
-  auto GD = new SPIRVGroupDecorate(Group, getIds(Targets));
+  auto GD = new (this) SPIRVGroupDecorate(Group, getIds(Targets));
   addGroupDecorateGeneric(GD);
   return GD;
 }
 
 SPIRVGroupMemberDecorate *SPIRVModuleImpl::addGroupMemberDecorate(
     SPIRVDecorationGroup *Group, const std::vector<SPIRVEntry *> &Targets) {
-  auto GMD = new SPIRVGroupMemberDecorate(Group, getIds(Targets));
+  auto GMD = new (this) SPIRVGroupMemberDecorate(Group, getIds(Targets));
   addGroupDecorateGeneric(GMD);
   return GMD;
 }
@@ -1218,7 +1245,7 @@ SPIRVString *SPIRVModuleImpl::getString(const std::string &Str) {
   auto Loc = StrMap.find(Str);
   if (Loc != StrMap.end())
     return Loc->second;
-  auto S = add(new SPIRVString(this, getId(), Str));
+  auto S = add(new (this) SPIRVString(this, getId(), Str));
   StrMap[Str] = S;
   return S;
 }
@@ -1226,7 +1253,7 @@ SPIRVString *SPIRVModuleImpl::getString(const std::string &Str) {
 SPIRVMemberName *SPIRVModuleImpl::addMemberName(SPIRVTypeStruct *ST,
                                                 SPIRVWord MemberNumber,
                                                 const std::string &Name) {
-  return add(new SPIRVMemberName(ST, MemberNumber, Name));
+  return add(new (this) SPIRVMemberName(ST, MemberNumber, Name));
 }
 
 void SPIRVModuleImpl::addUnknownStructField(SPIRVTypeStruct *Struct, unsigned I,
@@ -1259,7 +1286,26 @@ std::istream &operator>>(std::istream &I, SPIRVModule &M) {
   assert(MI.InstSchema == SPIRVISCH_Default &&
          "Unsupported instruction schema");
 
-  while(Decoder.getWordCountAndOpCode())
+  // All ids are below the bound, so a bound that lets ids reach the DenseMap
+  // reserved keys is malformed.
+  if (!MI.ErrLog.checkError(MI.NextId <= llvm::DenseMapInfo<SPIRVId>::getTombstoneKey(),
+                            SPIRVEC_InvalidModule,
+                            "Id bound " + std::to_string(MI.NextId) +
+                                " is out of range"))
+    return I;
+
+  // The bound comes from the untrusted header, so do not reserve more entries
+  // than the rest of the binary has words; every result id takes at least one.
+  auto HeaderEnd = I.tellg();
+  if (HeaderEnd != std::istream::pos_type(-1)) {
+    I.seekg(0, std::ios::end);
+    uint64_t RemainingWords = (I.tellg() - HeaderEnd) / sizeof(SPIRVWord);
+    I.seekg(HeaderEnd);
+    MI.IdEntryMap.reserve(std::min<uint64_t>(MI.NextId, RemainingWords));
+  }
+
+  while (MI.ErrLog.getErrorCode() == SPIRVEC_Success &&
+         Decoder.getWordCountAndOpCode())
     Decoder.getEntry();
 
   MI.optimizeDecorates();
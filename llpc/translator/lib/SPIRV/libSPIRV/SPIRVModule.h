@@ -98,6 +98,9 @@ public:
   virtual SPIRVEntry *getEntry(SPIRVId) const = 0;
   virtual bool hasDebugInfo() const = 0;
 
+  // Entry storage functions
+  virtual void *allocateEntry(size_t Size) = 0;
+
   // Error handling functions
   virtual SPIRVErrorLog &getErrorLog() = 0;
   virtual SPIRVErrorCode getError(std::string &) = 0;
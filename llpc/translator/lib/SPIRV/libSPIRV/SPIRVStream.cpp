@@ -113,7 +113,7 @@ bool SPIRVDecoder::getWordCountAndOpCode() {
 SPIRVEntry *SPIRVDecoder::getEntry() {
   if (WordCount == 0 || OpCode == OpNop)
     return nullptr;
-  SPIRVEntry *Entry = SPIRVEntry::create(OpCode);
+  SPIRVEntry *Entry = SPIRVEntry::create(OpCode, &M);
   assert(Entry);
   Entry->setModule(&M);
   if (!Scope && (isModuleScopeAllowedOpCode(OpCode) || OpCode == OpExtInst)) {
@@ -50,7 +50,7 @@ void SPIRVValue::setVolatile(bool IsVolatile) {
     eraseDecorate(DecorationVolatile);
     return;
   }
-  addDecorate(new SPIRVDecorate(DecorationVolatile, this));
+  addDecorate(new (Module) SPIRVDecorate(DecorationVolatile, this));
 }
 
 bool SPIRVValue::isCoherent() { return hasDecorate(DecorationCoherent); }
@@ -60,7 +60,7 @@ void SPIRVValue::setCoherent(bool IsCoherent) {
     eraseDecorate(DecorationCoherent);
     return;
   }
-  addDecorate(new SPIRVDecorate(DecorationCoherent, this));
+  addDecorate(new (Module) SPIRVDecorate(DecorationCoherent, this));
 }
 
 } // namespace SPIRV
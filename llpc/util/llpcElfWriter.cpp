@@ -30,7 +30,10 @@
  */
 #include "llpcElfWriter.h"
 #include "llpcContext.h"
+#include "lgc/Trace.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/BinaryFormat/MsgPackDocument.h"
 #include <algorithm>
 #include <string.h>
@@ -830,6 +833,7 @@ template <class Elf> void ElfWriter<Elf>::updateElfBinary(Context *pContext, Elf
 // @param [out] pPipelineElf : Final ELF binary
 template <class Elf>
 void ElfWriter<Elf>::mergeElfBinary(Context *pContext, const BinaryData *pFragmentElf, ElfPackage *pPipelineElf) {
+  lgc::TraceScope traceScope("ElfMerge");
   auto fragmentIsaSymbolName =
       Util::Abi::PipelineAbiSymbolNameStrings[static_cast<unsigned>(Util::Abi::PipelineSymbolType::PsMainEntry)];
   auto fragmentIntrlTblSymbolName =
@@ -1030,83 +1034,120 @@ template <class Elf> void ElfWriter<Elf>::reinitialize() {
 }
 
 // =====================================================================================================================
-// Retrieves the actual descriptor offset at the specified binding from UserDataNode.
+// Index of the descriptor nodes in the user data nodes of a pipeline by {set,binding}, used to fix up the descriptor
+// relocations without searching the user data node tree for each one. Only descriptor nodes (the types up to
+// DescriptorBuffer) are indexed; the other node types have no {set,binding}. Of the nodes with the same {set,binding},
+// the first one added is kept.
+class DescriptorNodeIndex {
+public:
+  DescriptorNodeIndex(Context *context, bool isGraphicsPipeline);
+
+  const ResourceMappingNode *find(unsigned descSet, unsigned binding) const;
+
+private:
+  void addNodes(const ResourceMappingNode *nodes, unsigned nodeCount);
+
+  static uint64_t getKey(unsigned descSet, unsigned binding) { return (uint64_t(descSet) << 32) | binding; }
+  static bool isReservedKey(uint64_t key) {
+    return key == DenseMapInfo<uint64_t>::getEmptyKey() || key == DenseMapInfo<uint64_t>::getTombstoneKey();
+  }
+
+  DenseMap<uint64_t, const ResourceMappingNode *> m_nodes; // Descriptor node for each {set,binding}
+  // Descriptor nodes whose key is one that DenseMap reserves, so cannot be in m_nodes
+  SmallVector<const ResourceMappingNode *, 1> m_reservedKeyNodes;
+};
+
+// =====================================================================================================================
+// Build the index from the user data nodes of the pipeline. For a graphics pipeline, the nodes of the vertex shader
+// come before those of the fragment shader.
 //
-// @param descSet : DescriptorSet index of the resource
-// @param binding : Binding slot of the resource
-// @param nodeType : Type of resource requested by the shader
-// @param nodes: The UserDataNode provided at runtime
+// @param context : Pipeline compilation context
+// @param isGraphicsPipeline : Whether we are processing a compute or graphics pipeline
+DescriptorNodeIndex::DescriptorNodeIndex(Context *context, bool isGraphicsPipeline) {
+  if (isGraphicsPipeline) {
+    auto pipelineInfo = reinterpret_cast<const GraphicsPipelineBuildInfo *>(context->getPipelineBuildInfo());
+    addNodes(pipelineInfo->vs.pUserDataNodes, pipelineInfo->vs.userDataNodeCount);
+    addNodes(pipelineInfo->fs.pUserDataNodes, pipelineInfo->fs.userDataNodeCount);
+  } else {
+    auto pipelineInfo = reinterpret_cast<const ComputePipelineBuildInfo *>(context->getPipelineBuildInfo());
+    addNodes(pipelineInfo->cs.pUserDataNodes, pipelineInfo->cs.userDataNodeCount);
+  }
+}
+
+// =====================================================================================================================
+// Add the descriptor nodes of a table of user data nodes, including those in descriptor tables, to the index.
+//
+// @param nodes : The UserDataNode provided at runtime
 // @param nodeCount : Number of resource nodes in UserDataNode
-static unsigned getDescriptorResourceOffset(unsigned descSet, unsigned binding, ResourceMappingNodeType nodeType,
-                                            const ResourceMappingNode *nodes, unsigned nodeCount) {
+void DescriptorNodeIndex::addNodes(const ResourceMappingNode *nodes, unsigned nodeCount) {
   for (unsigned i = 0; i < nodeCount; ++i) {
     const ResourceMappingNode *resource = nodes + i;
 
     if (resource->type == ResourceMappingNodeType::DescriptorTableVaPtr) {
-      unsigned offset = getDescriptorResourceOffset(descSet, binding, nodeType, resource->tablePtr.pNext,
-                                                    resource->tablePtr.nodeCount);
-      if (offset != InvalidValue) {
-        return offset;
-      }
+      addNodes(resource->tablePtr.pNext, resource->tablePtr.nodeCount);
       continue;
     }
-    if (resource->type > ResourceMappingNodeType::DescriptorBuffer) {
+    if (resource->type > ResourceMappingNodeType::DescriptorBuffer)
       continue;
-    }
-    if (resource->srdRange.set != descSet || resource->srdRange.binding != binding) {
-      continue;
-    }
 
-    if (nodeType == ResourceMappingNodeType::DescriptorSampler &&
-        resource->type == ResourceMappingNodeType::DescriptorCombinedTexture) {
-      return (resource->offsetInDwords + 8) * sizeof(unsigned); // Offset by DescriptorSizeResource.
-    } else {
-      return (resource->offsetInDwords) * sizeof(unsigned);
-    }
+    uint64_t key = getKey(resource->srdRange.set, resource->srdRange.binding);
+    if (isReservedKey(key)) {
+      if (!find(resource->srdRange.set, resource->srdRange.binding))
+        m_reservedKeyNodes.push_back(resource);
+    } else
+      m_nodes.insert({key, resource});
   }
-  return InvalidValue;
 }
 
 // =====================================================================================================================
-// Retrieves the actual descriptor stride at the specified binding from UserDataNode.
+// Find the descriptor node at the specified binding. Returns nullptr if there is none.
 //
 // @param descSet : DescriptorSet index of the resource
 // @param binding : Binding slot of the resource
-// @param nodes : The UserDataNode provided at runtime
-// @param nodeCount : Number of resource nodes in UserDataNode
-static unsigned getDescriptorResourceStride(unsigned descSet, unsigned binding, const ResourceMappingNode *nodes,
-                                            unsigned nodeCount) {
-  for (unsigned i = 0; i < nodeCount; ++i) {
-    const ResourceMappingNode *resource = nodes + i;
-
-    if (resource->type == ResourceMappingNodeType::DescriptorTableVaPtr) {
-      unsigned offset =
-          getDescriptorResourceStride(descSet, binding, resource->tablePtr.pNext, resource->tablePtr.nodeCount);
-      if (offset != InvalidValue) {
-        return offset;
-      }
-      continue;
-    }
-    if (resource->type > ResourceMappingNodeType::DescriptorBuffer) {
-      continue;
-    }
-    if (resource->srdRange.set != descSet || resource->srdRange.binding != binding) {
-      continue;
+const ResourceMappingNode *DescriptorNodeIndex::find(unsigned descSet, unsigned binding) const {
+  uint64_t key = getKey(descSet, binding);
+  if (isReservedKey(key)) {
+    for (const ResourceMappingNode *resource : m_reservedKeyNodes) {
+      if (resource->srdRange.set == descSet && resource->srdRange.binding == binding)
+        return resource;
     }
+    return nullptr;
+  }
+  auto it = m_nodes.find(key);
+  return it != m_nodes.end() ? it->second : nullptr;
+}
 
-    switch (resource->type) {
-    case ResourceMappingNodeType::DescriptorSampler:
-      return DescriptorSizeSampler / 4;
-      break;
-    case ResourceMappingNodeType::DescriptorResource:
-    case ResourceMappingNodeType::DescriptorFmask:
-      return DescriptorSizeResource / 4;
-    case ResourceMappingNodeType::DescriptorCombinedTexture:
-      return (DescriptorSizeResource + DescriptorSizeSampler) / 4;
-    default:
-      llvm_unreachable("Unexpected resource node type");
-      break;
-    }
+// =====================================================================================================================
+// Retrieves the actual descriptor offset of a descriptor node.
+//
+// @param nodeType : Type of resource requested by the shader
+// @param resource : Descriptor node at the binding of the resource
+static unsigned getDescriptorResourceOffset(ResourceMappingNodeType nodeType, const ResourceMappingNode *resource) {
+  if (nodeType == ResourceMappingNodeType::DescriptorSampler &&
+      resource->type == ResourceMappingNodeType::DescriptorCombinedTexture) {
+    return (resource->offsetInDwords + 8) * sizeof(unsigned); // Offset by DescriptorSizeResource.
+  } else {
+    return (resource->offsetInDwords) * sizeof(unsigned);
+  }
+}
+
+// =====================================================================================================================
+// Retrieves the actual descriptor stride of a descriptor node.
+//
+// @param resource : Descriptor node at the binding of the resource
+static unsigned getDescriptorResourceStride(const ResourceMappingNode *resource) {
+  switch (resource->type) {
+  case ResourceMappingNodeType::DescriptorSampler:
+    return DescriptorSizeSampler / 4;
+    break;
+  case ResourceMappingNodeType::DescriptorResource:
+  case ResourceMappingNodeType::DescriptorFmask:
+    return DescriptorSizeResource / 4;
+  case ResourceMappingNodeType::DescriptorCombinedTexture:
+    return (DescriptorSizeResource + DescriptorSizeSampler) / 4;
+  default:
+    llvm_unreachable("Unexpected resource node type");
+    break;
   }
   return InvalidValue;
 }
@@ -1114,11 +1155,10 @@ static unsigned getDescriptorResourceStride(unsigned descSet, unsigned binding,
 // =====================================================================================================================
 // Get value for a descriptor offset relocation (doff_x_y_t symbol).
 //
-// @param context : [in] Pipeline compilation context
 // @param relocEntry : The relocation entry to fixup
-// @param isGraphicsPipeline : Whether we are processing a compute or graphics pipeline
+// @param nodeIndex : Index of the descriptor nodes of the pipeline
 // @param value : [out] The value of the relocation
-bool getDescriptorOffsetRelocationValue(Context *context, RelocationEntry relocEntry, bool isGraphicsPipeline,
+bool getDescriptorOffsetRelocationValue(RelocationEntry relocEntry, const DescriptorNodeIndex &nodeIndex,
                                         unsigned *value) {
   size_t idx = 0;
   const char *relocName = relocEntry.name + 5;
@@ -1140,31 +1180,18 @@ bool getDescriptorOffsetRelocationValue(Context *context, RelocationEntry relocE
     break;
   }
 
-  if (isGraphicsPipeline) {
-    auto pPipelineInfo = reinterpret_cast<const GraphicsPipelineBuildInfo *>(context->getPipelineBuildInfo());
-    *value = getDescriptorResourceOffset(descSet, binding, type, pPipelineInfo->vs.pUserDataNodes,
-                                         pPipelineInfo->vs.userDataNodeCount);
-    if (*value == InvalidValue) {
-      *value = getDescriptorResourceOffset(descSet, binding, type, pPipelineInfo->fs.pUserDataNodes,
-                                           pPipelineInfo->fs.userDataNodeCount);
-    }
-  } else {
-    auto pPipelineInfo = reinterpret_cast<const ComputePipelineBuildInfo *>(context->getPipelineBuildInfo());
-    *value = getDescriptorResourceOffset(descSet, binding, type, pPipelineInfo->cs.pUserDataNodes,
-                                         pPipelineInfo->cs.userDataNodeCount);
-  }
-
+  const ResourceMappingNode *resource = nodeIndex.find(descSet, binding);
+  *value = resource ? getDescriptorResourceOffset(type, resource) : InvalidValue;
   return *value != InvalidValue;
 }
 
 // =====================================================================================================================
 // Get value for a descriptor stride relocation (dstride_x_y symbol).
 //
-// @param context : [in] Pipeline compilation context
 // @param relocEntry : The relocation entry to fixup
-// @param isGraphicsPipeline : Whether we are processing a compute or graphics pipeline
+// @param nodeIndex : Index of the descriptor nodes of the pipeline
 // @param value : [out] The value of the relocation
-bool getDescriptorStrideRelocationValue(Context *context, RelocationEntry relocEntry, bool isGraphicsPipeline,
+bool getDescriptorStrideRelocationValue(RelocationEntry relocEntry, const DescriptorNodeIndex &nodeIndex,
                                         unsigned *value) {
   size_t idx = 0;
   const char *relocName = relocEntry.name + 8;
@@ -1174,35 +1201,22 @@ bool getDescriptorStrideRelocationValue(Context *context, RelocationEntry relocE
   unsigned binding = std::stoi(relocName, &idx);
   relocName += idx + 1;
 
-  if (isGraphicsPipeline) {
-    auto pPipelineInfo = reinterpret_cast<const GraphicsPipelineBuildInfo *>(context->getPipelineBuildInfo());
-    *value = getDescriptorResourceStride(descSet, binding, pPipelineInfo->vs.pUserDataNodes,
-                                         pPipelineInfo->vs.userDataNodeCount);
-    if (*value == InvalidValue) {
-      *value = getDescriptorResourceStride(descSet, binding, pPipelineInfo->fs.pUserDataNodes,
-                                           pPipelineInfo->fs.userDataNodeCount);
-    }
-  } else {
-    auto pPipelineInfo = reinterpret_cast<const ComputePipelineBuildInfo *>(context->getPipelineBuildInfo());
-    *value = getDescriptorResourceStride(descSet, binding, pPipelineInfo->cs.pUserDataNodes,
-                                         pPipelineInfo->cs.userDataNodeCount);
-  }
-
+  const ResourceMappingNode *resource = nodeIndex.find(descSet, binding);
+  *value = resource ? getDescriptorResourceStride(resource) : InvalidValue;
   return *value != InvalidValue;
 }
 
 // =====================================================================================================================
 // Get the value of a relocation symbol. Returns true if success, and false if the symbol is unknown.
 //
-// @param context : [in] Pipeline compilation context
 // @param relocEntry : The relocation entry to fixup
-// @param isGraphicsPipeline : Whether we are processing a compute or graphics pipeline
+// @param nodeIndex : Index of the descriptor nodes of the pipeline
 // @param value : [out] The value of the relocation
-bool getRelocationSymbolValue(Context *context, RelocationEntry relocEntry, bool isGraphicsPipeline, unsigned *value) {
+bool getRelocationSymbolValue(RelocationEntry relocEntry, const DescriptorNodeIndex &nodeIndex, unsigned *value) {
   if (strncmp(relocEntry.name, "doff_", 5) == 0) {
-    return getDescriptorOffsetRelocationValue(context, relocEntry, isGraphicsPipeline, value);
+    return getDescriptorOffsetRelocationValue(relocEntry, nodeIndex, value);
   } else if (strncmp(relocEntry.name, "dstride_", 8) == 0) {
-    return getDescriptorStrideRelocationValue(context, relocEntry, isGraphicsPipeline, value);
+    return getDescriptorStrideRelocationValue(relocEntry, nodeIndex, value);
   }
   return false;
 }
@@ -1220,11 +1234,12 @@ void fixUpRelocations(ElfWriter<Elf> *writer, const std::vector<RelocationEntry>
   char *data = nullptr;
   size_t dataLength = 0;
   writer->getSectionData(TextName, const_cast<const void **>(reinterpret_cast<void **>(&data)), &dataLength);
+  DescriptorNodeIndex nodeIndex(context, isGraphicsPipeline);
 
   for (unsigned i = 0; i < relocations.size(); ++i) {
     auto &reloc = relocations[i];
     unsigned relocationValue = 0;
-    if (getRelocationSymbolValue(context, reloc, isGraphicsPipeline, &relocationValue)) {
+    if (getRelocationSymbolValue(reloc, nodeIndex, &relocationValue)) {
       assert(data != nullptr && dataLength >= reloc.reloc.offset);
       assert(reloc.reloc.type == R_AMDGPU_ABS32 && "can only handle R_AMDGPU_ABS32 typed relocations.");
       unsigned *targetDword = reinterpret_cast<unsigned *>(data + reloc.reloc.offset);
@@ -1240,14 +1255,16 @@ void fixUpRelocations(ElfWriter<Elf> *writer, const std::vector<RelocationEntry>
 }
 
 // =====================================================================================================================
-// Link the relocatable ELF readers into a pipeline ELF.
+// Link the relocatable ELF readers into a pipeline ELF. The first ELF contains the pre-rasterization stages, and the
+// second one the fragment shader.
 //
 // @param relocatableElfs : An array of relocatable ELF objects
 // @param context : Acquired context
 template <class Elf>
 Result ElfWriter<Elf>::linkGraphicsRelocatableElf(const ArrayRef<ElfReader<Elf> *> &relocatableElfs, Context *context) {
+  lgc::TraceScope traceScope("ElfLink");
   reinitialize();
-  assert(relocatableElfs.size() == 2 && "Can only handle VsPs Shaders for now.");
+  assert(relocatableElfs.size() == 2 && "Can only handle pre-rasterization and fragment shaders.");
 
   // Get the main data for the header, the parts that change will be updated when writing to buffer.
   m_header = relocatableElfs[0]->getHeader();
@@ -1348,6 +1365,7 @@ Result ElfWriter<Elf>::linkGraphicsRelocatableElf(const ArrayRef<ElfReader<Elf>
 // @param context : Acquired context
 template <class Elf>
 Result ElfWriter<Elf>::linkComputeRelocatableElf(const ElfReader<Elf> &relocatableElf, Context *context) {
+  lgc::TraceScope traceScope("ElfLink");
   // Currently nothing to do, just copy the elf.
   copyFromReader(relocatableElf);
 
@@ -33,166 +33,307 @@
 #include "llpcUtil.h"
 #include "spirvExt.h"
 #include "vkgcUtil.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/raw_ostream.h"
-#include <set>
-#include <unordered_set>
 using namespace llvm;
 
 using namespace spv;
 
 namespace Llpc {
+namespace {
+
+// Bits of the per-opcode property table used by ShaderModuleHelper::scanSpirvBinary
+enum SpirvOpProperty : unsigned char {
+  SpirvOpSupported = 0x01,        // Opcode is supported by the SPIR-V reader
+  SpirvOpDebug = 0x02,            // Debug instruction, removed when trimming debug info
+  SpirvOpHelperInvocation = 0x04, // Instruction requires helper invocations
+  SpirvOpSpecConstant = 0x08,     // Specialization constant
+  SpirvOpModuleInfo = 0x10,       // Instruction carries module info (capability, entry-point, function start)
+};
+
+#define _SPIRV_OP(x, ...) Op##x,
+constexpr Op SupportedOps[] = {
+#include "SPIRVOpCodeEnum.h"
+};
+#undef _SPIRV_OP
+
+constexpr Op DebugOps[] = {OpString, OpSource, OpSourceContinued, OpSourceExtension, OpName,
+                           OpMemberName, OpLine, OpNop, OpNoLine, OpModuleProcessed};
+
+constexpr Op HelperInvocationOps[] = {OpDPdx,
+                                      OpDPdy,
+                                      OpDPdxCoarse,
+                                      OpDPdyCoarse,
+                                      OpDPdxFine,
+                                      OpDPdyFine,
+                                      OpImageSampleImplicitLod,
+                                      OpImageSampleDrefImplicitLod,
+                                      OpImageSampleProjImplicitLod,
+                                      OpImageSampleProjDrefImplicitLod,
+                                      OpImageSparseSampleImplicitLod,
+                                      OpImageSparseSampleProjDrefImplicitLod,
+                                      OpImageSparseSampleProjImplicitLod};
+
+constexpr Op SpecConstantOps[] = {OpSpecConstantTrue, OpSpecConstantFalse, OpSpecConstant, OpSpecConstantComposite,
+                                  OpSpecConstantOp};
+
+constexpr Op ModuleInfoOps[] = {OpCapability, OpEntryPoint, OpFunction};
+
+// =====================================================================================================================
+// Gets the size of the opcode property table, which covers all supported opcodes.
+constexpr unsigned getOpPropertyTableSize() {
+  unsigned size = 0;
+  for (Op op : SupportedOps)
+    size = static_cast<unsigned>(op) >= size ? static_cast<unsigned>(op) + 1 : size;
+  return size;
+}
+
+// Represents the per-opcode property table, indexed by opcode
+struct SpirvOpPropertyTable {
+  unsigned char properties[getOpPropertyTableSize()];
+};
+
+// =====================================================================================================================
+// Builds the opcode property table at compile time.
+constexpr SpirvOpPropertyTable buildOpPropertyTable() {
+  SpirvOpPropertyTable table = {};
+  for (Op op : SupportedOps)
+    table.properties[op] |= SpirvOpSupported;
+  for (Op op : DebugOps)
+    table.properties[op] |= SpirvOpDebug;
+  for (Op op : HelperInvocationOps)
+    table.properties[op] |= SpirvOpHelperInvocation;
+  for (Op op : SpecConstantOps)
+    table.properties[op] |= SpirvOpSpecConstant;
+  for (Op op : ModuleInfoOps)
+    table.properties[op] |= SpirvOpModuleInfo;
+  return table;
+}
+
+constexpr SpirvOpPropertyTable OpPropertyTable = buildOpPropertyTable();
+
+} // anonymous namespace
+
 // =====================================================================================================================
-// Collect information from SPIR-V binary
+// Scans SPIR-V binary in a single pass, verifying that it is well-formed and only uses supported opcodes, and
+// collecting its usage info, capabilities, entry-points and the ranges of its debug instructions.
 //
-// @param spvBinCode : SPIR-V binary data
-// @param [out] shaderModuleUsage : Shader module usage info
-// @param [out] shaderEntryNames : Entry names for this shader module
-// @param debugInfoSize : Debug info size
-Result ShaderModuleHelper::collectInfoFromSpirvBinary(const BinaryData *spvBinCode,
-                                                      ShaderModuleUsage *shaderModuleUsage,
-                                                      std::vector<ShaderEntryName> &shaderEntryNames,
-                                                      unsigned *debugInfoSize) {
+// Each instruction costs one lookup in a compile-time opcode property table; only instructions with a property of
+// interest take the slow path. If preambleOnly is set, the scan stops at the first "OpFunction", which is enough to
+// gather capabilities and entry-points. Such a scan skips opcodes that the SPIR-V reader does not support instead of
+// failing, so that the entry-points of a module can still be found; the module is rejected when it is built.
+//
+// @param spvBin : SPIR-V binary
+// @param [out] scanInfo : Information gathered from the SPIR-V binary
+// @param preambleOnly : Whether to stop scanning at the first function
+Result ShaderModuleHelper::scanSpirvBinary(const BinaryData *spvBin, SpirvScanInfo *scanInfo, bool preambleOnly) {
   Result result = Result::Success;
+  *scanInfo = {};
 
-  const unsigned *code = reinterpret_cast<const unsigned *>(spvBinCode->pCode);
-  const unsigned *end = code + spvBinCode->codeSize / sizeof(unsigned);
+  const unsigned *code = reinterpret_cast<const unsigned *>(spvBin->pCode);
+  const unsigned *end = code + spvBin->codeSize / sizeof(unsigned);
 
+  // Skip SPIR-V header
   const unsigned *codePos = code + sizeof(SpirvHeader) / sizeof(unsigned);
 
-  // Parse SPIR-V instructions
-  std::unordered_set<unsigned> capabilities;
-
   while (codePos < end) {
     unsigned opCode = (codePos[0] & OpCodeMask);
     unsigned wordCount = (codePos[0] >> WordCountShift);
 
-    if (wordCount == 0 || codePos + wordCount > end) {
+    if (wordCount == 0 || wordCount > static_cast<size_t>(end - codePos)) {
       LLPC_ERRS("Invalid SPIR-V binary\n");
       result = Result::ErrorInvalidShader;
       break;
     }
 
-    // Parse each instruction and find those we are interested in
-    switch (opCode) {
-    case OpCapability: {
-      assert(wordCount == 2);
-      auto capability = static_cast<Capability>(codePos[1]);
-      capabilities.insert(capability);
-      break;
-    }
-    case OpDPdx:
-    case OpDPdy:
-    case OpDPdxCoarse:
-    case OpDPdyCoarse:
-    case OpDPdxFine:
-    case OpDPdyFine:
-    case OpImageSampleImplicitLod:
-    case OpImageSampleDrefImplicitLod:
-    case OpImageSampleProjImplicitLod:
-    case OpImageSampleProjDrefImplicitLod:
-    case OpImageSparseSampleImplicitLod:
-    case OpImageSparseSampleProjDrefImplicitLod:
-    case OpImageSparseSampleProjImplicitLod: {
-      shaderModuleUsage->useHelpInvocation = true;
-      break;
-    }
-    case OpString:
-    case OpSource:
-    case OpSourceContinued:
-    case OpSourceExtension:
-    case OpName:
-    case OpMemberName:
-    case OpLine:
-    case OpNop:
-    case OpNoLine:
-    case OpModuleProcessed: {
-      *debugInfoSize += wordCount * sizeof(unsigned);
-      break;
-    }
-    case OpSpecConstantTrue:
-    case OpSpecConstantFalse:
-    case OpSpecConstant:
-    case OpSpecConstantComposite:
-    case OpSpecConstantOp: {
-      shaderModuleUsage->useSpecConstant = true;
-      break;
-    }
-    case OpEntryPoint: {
-      ShaderEntryName entry = {};
-      // The fourth word is start of the name string of the entry-point
-      entry.name = reinterpret_cast<const char *>(&codePos[3]);
-      entry.stage = convertToStageShage(codePos[1]);
-      shaderEntryNames.push_back(entry);
-      break;
-    }
-    default: {
+    unsigned properties = opCode < sizeof(OpPropertyTable.properties) ? OpPropertyTable.properties[opCode] : 0;
+    if ((properties & SpirvOpSupported) == 0 && !preambleOnly) {
+      result = Result::ErrorInvalidShader;
       break;
     }
+
+    if (properties & SpirvOpDebug) {
+      // Extend the previous range if this instruction immediately follows it
+      unsigned offset = static_cast<unsigned>(codePos - code);
+      auto &debugRanges = scanInfo->debugRanges;
+      if (!debugRanges.empty() && debugRanges.back().offset + debugRanges.back().count == offset)
+        debugRanges.back().count += wordCount;
+      else
+        debugRanges.push_back({offset, wordCount});
+      scanInfo->debugInfoSize += wordCount * sizeof(unsigned);
+    } else if (properties & SpirvOpHelperInvocation)
+      scanInfo->usage.useHelpInvocation = true;
+    else if (properties & SpirvOpSpecConstant)
+      scanInfo->usage.useSpecConstant = true;
+    else if (properties & SpirvOpModuleInfo) {
+      if (opCode == OpFunction && preambleOnly)
+        break;
+
+      if (opCode == OpCapability) {
+        if (wordCount < 2) {
+          result = Result::ErrorInvalidShader;
+          break;
+        }
+        unsigned capability = codePos[1];
+        scanInfo->capabilities.push_back(capability);
+        if (capability == CapabilityVariablePointersStorageBuffer)
+          scanInfo->usage.enableVarPtrStorageBuf = true;
+        else if (capability == CapabilityVariablePointers)
+          scanInfo->usage.enableVarPtr = true;
+      } else if (opCode == OpEntryPoint) {
+        if (wordCount < 4) {
+          result = Result::ErrorInvalidShader;
+          break;
+        }
+        ShaderEntryName entry = {};
+        // The fourth word is start of the name string of the entry-point
+        entry.name = reinterpret_cast<const char *>(&codePos[3]);
+        entry.stage = convertToStageShage(codePos[1]);
+        scanInfo->entryNames.push_back(entry);
+        scanInfo->stageMask |= shaderStageToMask(entry.stage);
+      }
     }
+
     codePos += wordCount;
   }
 
-  if (capabilities.find(CapabilityVariablePointersStorageBuffer) != capabilities.end())
-    shaderModuleUsage->enableVarPtrStorageBuf = true;
-
-  if (capabilities.find(CapabilityVariablePointers) != capabilities.end())
-    shaderModuleUsage->enableVarPtr = true;
-
+  scanInfo->result = result;
   return result;
 }
 
 // =====================================================================================================================
-// Removes all debug instructions for SPIR-V binary.
+// Removes all debug instructions for SPIR-V binary, copying the runs of instructions between the debug ranges found
+// by scanSpirvBinary(). If trimHash is specified, the hash code of the trimmed code is computed in the same pass. If
+// trimSpvBin is null, only the hash code is computed.
 //
 // @param spvBin : SPIR-V binay code
+// @param scanInfo : Information gathered by scanSpirvBinary() from the same SPIR-V binary
 // @param bufferSize : Output buffer size in bytes
-// @param [out] trimSpvBin : Trimmed SPIR-V binary code
-void ShaderModuleHelper::trimSpirvDebugInfo(const BinaryData *spvBin, unsigned bufferSize, void *trimSpvBin) {
+// @param [out] trimSpvBin : Trimmed SPIR-V binary code (optional)
+// @param [out] trimHash : Hash code of the trimmed SPIR-V binary code (optional)
+void ShaderModuleHelper::trimSpirvDebugInfo(const BinaryData *spvBin, const SpirvScanInfo *scanInfo,
+                                            unsigned bufferSize, void *trimSpvBin, MetroHash::Hash *trimHash) {
   assert(bufferSize > sizeof(SpirvHeader));
 
   const unsigned *code = reinterpret_cast<const unsigned *>(spvBin->pCode);
-  const unsigned *end = code + spvBin->codeSize / sizeof(unsigned);
-  const unsigned *codePos = code + sizeof(SpirvHeader) / sizeof(unsigned);
+  const unsigned codeWordCount = spvBin->codeSize / sizeof(unsigned);
+  unsigned *trimCode = reinterpret_cast<unsigned *>(trimSpvBin);
+  unsigned trimWordCount = 0;
+  unsigned wordPos = 0;
+  MetroHash64 hasher;
+
+  auto copyWords = [&](unsigned copyCount) {
+    if (trimCode)
+      memcpy(trimCode + trimWordCount, code + wordPos, copyCount * sizeof(unsigned));
+    if (trimHash)
+      hasher.Update(reinterpret_cast<const uint8_t *>(code + wordPos), copyCount * sizeof(unsigned));
+    trimWordCount += copyCount;
+  };
+
+  // Copy SPIR-V header and the instructions before each debug range, then the instructions after the last one
+  for (const SpirvWordRange &debugRange : scanInfo->debugRanges) {
+    assert(debugRange.offset >= wordPos);
+    copyWords(debugRange.offset - wordPos);
+    wordPos = debugRange.offset + debugRange.count;
+  }
+  assert(wordPos <= codeWordCount);
+  copyWords(codeWordCount - wordPos);
 
-  unsigned *trimEnd = reinterpret_cast<unsigned *>(voidPtrInc(trimSpvBin, bufferSize));
-  (void(trimEnd)); // unused
-  unsigned *trimCodePos = reinterpret_cast<unsigned *>(voidPtrInc(trimSpvBin, sizeof(SpirvHeader)));
+  if (trimHash)
+    hasher.Finalize(trimHash->bytes);
 
-  // Copy SPIR-V header
-  memcpy(trimSpvBin, code, sizeof(SpirvHeader));
+  assert(trimWordCount * sizeof(unsigned) == bufferSize);
+  (void(trimWordCount)); // unused
+}
 
-  // Copy SPIR-V instructions
-  while (codePos < end) {
-    unsigned opCode = (codePos[0] & OpCodeMask);
-    unsigned wordCount = (codePos[0] >> WordCountShift);
-    switch (opCode) {
-    case OpString:
-    case OpSource:
-    case OpSourceContinued:
-    case OpSourceExtension:
-    case OpName:
-    case OpMemberName:
-    case OpLine:
-    case OpNop:
-    case OpNoLine:
-    case OpModuleProcessed: {
-      // Skip debug instructions
-      break;
-    }
-    default: {
-      // Copy other instructions
-      assert(codePos + wordCount <= end);
-      assert(trimCodePos + wordCount <= trimEnd);
-      memcpy(trimCodePos, codePos, wordCount * sizeof(unsigned));
-      trimCodePos += wordCount;
-      break;
-    }
-    }
+// =====================================================================================================================
+//
+// @param spvBin : SPIR-V binary
+// @param skipRanges : Runs of words to leave out, in ascending order and not adjacent to each other
+SpirvTrimStreamBuf::SpirvTrimStreamBuf(const BinaryData *spvBin, ArrayRef<SpirvWordRange> skipRanges)
+    : m_code(static_cast<const char *>(spvBin->pCode)), m_codeSize(spvBin->codeSize), m_skipRanges(skipRanges) {
+  m_trimmedSize = m_codeSize;
+  for (const SpirvWordRange &skipRange : m_skipRanges)
+    m_trimmedSize -= skipRange.count * sizeof(unsigned);
+  setGetArea(0);
+}
 
-    codePos += wordCount;
+// =====================================================================================================================
+// Makes the get area the run of bytes from the given offset in the SPIR-V binary up to the next run left out, first
+// stepping over a run left out that contains the offset.
+//
+// @param byteOffset : Byte offset in the SPIR-V binary
+void SpirvTrimStreamBuf::setGetArea(size_t byteOffset) {
+  // Find the first run left out that ends after the offset.
+  auto skipRange = partition_point(m_skipRanges, [byteOffset](const SpirvWordRange &range) {
+    return (range.offset + range.count) * sizeof(unsigned) <= byteOffset;
+  });
+  if (skipRange != m_skipRanges.end() && skipRange->offset * sizeof(unsigned) <= byteOffset) {
+    byteOffset = (skipRange->offset + skipRange->count) * sizeof(unsigned);
+    ++skipRange;
   }
+  size_t endOffset = skipRange != m_skipRanges.end() ? skipRange->offset * sizeof(unsigned) : m_codeSize;
 
-  assert(trimCodePos == trimEnd);
+  char *code = const_cast<char *>(m_code);
+  setg(code + byteOffset, code + byteOffset, code + endOffset);
+}
+
+// =====================================================================================================================
+// Gets the offset in the trimmed stream of the given byte offset in the SPIR-V binary, which is not in a run left out.
+//
+// @param byteOffset : Byte offset in the SPIR-V binary
+size_t SpirvTrimStreamBuf::getTrimmedOffset(size_t byteOffset) const {
+  size_t trimmedOffset = byteOffset;
+  for (const SpirvWordRange &skipRange : m_skipRanges) {
+    if (skipRange.offset * sizeof(unsigned) >= byteOffset)
+      break;
+    trimmedOffset -= skipRange.count * sizeof(unsigned);
+  }
+  return trimmedOffset;
+}
+
+// =====================================================================================================================
+// Moves on to the next run of bytes that is not left out, when the current one has been read.
+SpirvTrimStreamBuf::int_type SpirvTrimStreamBuf::underflow() {
+  if (gptr() == egptr())
+    setGetArea(egptr() - m_code);
+  return gptr() == egptr() ? traits_type::eof() : traits_type::to_int_type(*gptr());
+}
+
+// =====================================================================================================================
+// Moves the read position by an offset in the trimmed stream.
+//
+// @param offset : Offset from the position given by dir
+// @param dir : Whether the offset is from the start, the current position or the end of the trimmed stream
+// @param mode : Which of the read and write positions to move
+SpirvTrimStreamBuf::pos_type SpirvTrimStreamBuf::seekoff(off_type offset, std::ios_base::seekdir dir,
+                                                         std::ios_base::openmode mode) {
+  if (dir == std::ios_base::cur)
+    offset += getTrimmedOffset(gptr() - m_code);
+  else if (dir == std::ios_base::end)
+    offset += m_trimmedSize;
+  return seekpos(offset, mode);
+}
+
+// =====================================================================================================================
+// Moves the read position to a position in the trimmed stream.
+//
+// @param pos : Byte position in the trimmed stream
+// @param mode : Which of the read and write positions to move
+SpirvTrimStreamBuf::pos_type SpirvTrimStreamBuf::seekpos(pos_type pos, std::ios_base::openmode mode) {
+  off_type trimmedOffset = pos;
+  if ((mode & std::ios_base::in) == 0 || trimmedOffset < 0 || static_cast<size_t>(trimmedOffset) > m_trimmedSize)
+    return pos_type(off_type(-1));
+
+  // Add in the runs left out before the position.
+  size_t byteOffset = trimmedOffset;
+  for (const SpirvWordRange &skipRange : m_skipRanges) {
+    if (skipRange.offset * sizeof(unsigned) > byteOffset)
+      break;
+    byteOffset += skipRange.count * sizeof(unsigned);
+  }
+  setGetArea(byteOffset);
+  return pos;
 }
 
 // =====================================================================================================================
@@ -250,39 +391,16 @@ void ShaderModuleHelper::cleanOptimizedSpirv(BinaryData *spirvBin) {
 unsigned ShaderModuleHelper::getStageMaskFromSpirvBinary(const BinaryData *spvBin, const char *entryName) {
   unsigned stageMask = 0;
 
-  const unsigned *code = reinterpret_cast<const unsigned *>(spvBin->pCode);
-  const unsigned *end = code + spvBin->codeSize / sizeof(unsigned);
-
   if (isSpirvBinary(spvBin)) {
-    // Skip SPIR-V header
-    const unsigned *codePos = code + sizeof(SpirvHeader) / sizeof(unsigned);
-
-    while (codePos < end) {
-      unsigned opCode = (codePos[0] & OpCodeMask);
-      unsigned wordCount = (codePos[0] >> WordCountShift);
-
-      if (wordCount == 0 || codePos + wordCount > end) {
-        LLPC_ERRS("Invalid SPIR-V binary\n");
-        stageMask = 0;
-        break;
-      }
-
-      if (opCode == OpEntryPoint) {
-        assert(wordCount >= 4);
-
-        // The fourth word is start of the name string of the entry-point
-        const char *name = reinterpret_cast<const char *>(&codePos[3]);
-        if (strcmp(entryName, name) == 0) {
+    // All "OpEntryPoint" are before "OpFunction"
+    SpirvScanInfo scanInfo;
+    if (scanSpirvBinary(spvBin, &scanInfo, true) == Result::Success) {
+      for (const ShaderEntryName &entry : scanInfo.entryNames) {
+        if (strcmp(entryName, entry.name) == 0) {
           // An matching entry-point is found
-          stageMask |= shaderStageToMask(convertToStageShage(codePos[1]));
+          stageMask |= shaderStageToMask(entry.stage);
         }
       }
-
-      // All "OpEntryPoint" are before "OpFunction"
-      if (opCode == OpFunction)
-        break;
-
-      codePos += wordCount;
     }
   } else {
     LLPC_ERRS("Invalid SPIR-V binary\n");
@@ -301,36 +419,12 @@ unsigned ShaderModuleHelper::getStageMaskFromSpirvBinary(const BinaryData *spvBi
 const char *ShaderModuleHelper::getEntryPointNameFromSpirvBinary(const BinaryData *spvBin) {
   const char *entryName = nullptr;
 
-  const unsigned *code = reinterpret_cast<const unsigned *>(spvBin->pCode);
-  const unsigned *end = code + spvBin->codeSize / sizeof(unsigned);
-
   if (isSpirvBinary(spvBin)) {
-    // Skip SPIR-V header
-    const unsigned *codePos = code + sizeof(SpirvHeader) / sizeof(unsigned);
-
-    while (codePos < end) {
-      unsigned opCode = (codePos[0] & OpCodeMask);
-      unsigned wordCount = (codePos[0] >> WordCountShift);
-
-      if (wordCount == 0 || codePos + wordCount > end) {
-        LLPC_ERRS("Invalid SPIR-V binary\n");
-        break;
-      }
-
-      if (opCode == OpEntryPoint) {
-        assert(wordCount >= 4);
-
-        // The fourth word is start of the name string of the entry-point
-        entryName = reinterpret_cast<const char *>(&codePos[3]);
-        break;
-      }
-
-      // All "OpEntryPoint" are before "OpFunction"
-      if (opCode == OpFunction)
-        break;
-
-      codePos += wordCount;
-    }
+    // All "OpEntryPoint" are before "OpFunction"
+    SpirvScanInfo scanInfo;
+    scanSpirvBinary(spvBin, &scanInfo, true);
+    if (!scanInfo.entryNames.empty())
+      entryName = scanInfo.entryNames[0].name;
 
     if (!entryName) {
       LLPC_ERRS("Entry-point not found\n");
@@ -344,45 +438,6 @@ const char *ShaderModuleHelper::getEntryPointNameFromSpirvBinary(const BinaryDat
   return entryName;
 }
 
-// =====================================================================================================================
-// Verifies if the SPIR-V binary is valid and is supported
-//
-// @param spvBin : SPIR-V binary
-Result ShaderModuleHelper::verifySpirvBinary(const BinaryData *spvBin) {
-  Result result = Result::Success;
-
-#define _SPIRV_OP(x, ...) Op##x,
-  static const std::set<Op> OpSet{{
-#include "SPIRVOpCodeEnum.h"
-  }};
-#undef _SPIRV_OP
-
-  const unsigned *code = reinterpret_cast<const unsigned *>(spvBin->pCode);
-  const unsigned *end = code + spvBin->codeSize / sizeof(unsigned);
-
-  // Skip SPIR-V header
-  const unsigned *codePos = code + sizeof(SpirvHeader) / sizeof(unsigned);
-
-  while (codePos < end) {
-    Op opCode = static_cast<Op>(codePos[0] & OpCodeMask);
-    unsigned wordCount = (codePos[0] >> WordCountShift);
-
-    if (wordCount == 0 || codePos + wordCount > end) {
-      result = Result::ErrorInvalidShader;
-      break;
-    }
-
-    if (OpSet.find(opCode) == OpSet.end()) {
-      result = Result::ErrorInvalidShader;
-      break;
-    }
-
-    codePos += wordCount;
-  }
-
-  return result;
-}
-
 // =====================================================================================================================
 // Checks whether input binary data is SPIR-V binary
 //
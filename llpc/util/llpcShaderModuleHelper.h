@@ -31,6 +31,9 @@
 
 #pragma once
 #include "llpc.h"
+#include "vkgcMetroHash.h"
+#include "llvm/ADT/ArrayRef.h"
+#include <streambuf>
 #include <vector>
 
 namespace Llpc {
@@ -58,14 +61,53 @@ struct ShaderEntryName {
   const char *name;  // Entry name
 };
 
+// Represents a run of consecutive SPIR-V instructions, in words from the start of the binary
+struct SpirvWordRange {
+  unsigned offset; // Word offset of the first instruction
+  unsigned count;  // Word count of the run
+};
+
+// Represents the information gathered by a single scan of a SPIR-V binary
+struct SpirvScanInfo {
+  Result result;                           // Success, or ErrorInvalidShader if malformed or unsupported
+  ShaderModuleUsage usage;                 // Usage info of the shader module
+  std::vector<unsigned> capabilities;      // Capabilities declared by "OpCapability"
+  std::vector<ShaderEntryName> entryNames; // Entry-points declared by "OpEntryPoint"
+  unsigned stageMask;                      // Stage mask of all entry-points
+  std::vector<SpirvWordRange> debugRanges; // Runs of debug instructions, in ascending order
+  unsigned debugInfoSize;                  // Byte size of all debug instructions
+};
+
+// =====================================================================================================================
+// Represents a stream buffer that reads a SPIR-V binary with some runs of words left out, so that the SPIR-V parser can
+// read the binary with its debug instructions trimmed without a trimmed copy of it being made.
+class SpirvTrimStreamBuf : public std::streambuf {
+public:
+  SpirvTrimStreamBuf(const BinaryData *spvBin, llvm::ArrayRef<SpirvWordRange> skipRanges);
+
+protected:
+  int_type underflow() override;
+  pos_type seekoff(off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode mode) override;
+  pos_type seekpos(pos_type pos, std::ios_base::openmode mode) override;
+
+private:
+  void setGetArea(size_t byteOffset);
+  size_t getTrimmedOffset(size_t byteOffset) const;
+
+  const char *m_code;                          // SPIR-V binary
+  size_t m_codeSize;                           // Byte size of the SPIR-V binary
+  llvm::ArrayRef<SpirvWordRange> m_skipRanges; // Runs of words to leave out, in ascending order
+  size_t m_trimmedSize;                        // Byte size of the SPIR-V binary without the runs left out
+};
+
 // =====================================================================================================================
 // Represents LLPC shader module helper class
 class ShaderModuleHelper {
 public:
-  static Result collectInfoFromSpirvBinary(const BinaryData *spvBinCode, ShaderModuleUsage *shaderModuleUsage,
-                                           std::vector<ShaderEntryName> &shaderEntryNames, unsigned *debugInfoSize);
+  static Result scanSpirvBinary(const BinaryData *spvBin, SpirvScanInfo *scanInfo, bool preambleOnly = false);
 
-  static void trimSpirvDebugInfo(const BinaryData *spvBin, unsigned bufferSize, void *trimSpvBin);
+  static void trimSpirvDebugInfo(const BinaryData *spvBin, const SpirvScanInfo *scanInfo, unsigned bufferSize,
+                                 void *trimSpvBin, MetroHash::Hash *trimHash = nullptr);
 
   static Result optimizeSpirv(const BinaryData *spirvBinIn, BinaryData *spirvBinOut);
 
@@ -75,8 +117,6 @@ public:
 
   static const char *getEntryPointNameFromSpirvBinary(const BinaryData *spvBin);
 
-  static Result verifySpirvBinary(const BinaryData *spvBin);
-
   static bool isSpirvBinary(const BinaryData *shaderBin);
 
   static bool isLlvmBitcode(const BinaryData *shaderBin);
@@ -100,6 +100,11 @@ TimerProfiler::TimerProfiler(uint64_t hash64, const char *descriptionPrefix, uns
                                        (Twine(descriptionPrefix) + Twine(" CodeGen ") + hashString).str(), m_phases);
     }
 
+    if (enableMask & (1 << TimerIrCache)) {
+      m_phaseTimers[TimerIrCache].init(
+          "llpc-ir-cache", (Twine(descriptionPrefix) + Twine(" IR Cache Restore ") + hashString).str(), m_phases);
+    }
+
     // Start whole timer
     m_wholeTimer.startTimer();
   }
@@ -52,6 +52,7 @@ enum TimerKind : unsigned {
   TimerPatch,     // Timer for LLVM patching
   TimerOpt,       // Timer for LLVM optimization
   TimerCodeGen,   // Timer for backend code generation
+  TimerIrCache,   // Timer for restoring lowered shader IR from cache
 
   TimerCount
 };
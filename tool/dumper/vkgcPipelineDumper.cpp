@@ -520,6 +520,7 @@ void PipelineDumper::dumpPipelineShaderInfo(const PipelineShaderInfo *shaderInfo
 #endif
   dumpFile << "options.unrollThreshold = " << shaderInfo->options.unrollThreshold << "\n";
   dumpFile << "options.scalarThreshold = " << shaderInfo->options.scalarThreshold << "\n";
+  dumpFile << "options.loadScalarizerCostModel = " << shaderInfo->options.loadScalarizerCostModel << "\n";
 
   dumpFile << "\n";
 }
@@ -620,6 +621,7 @@ void PipelineDumper::dumpPipelineOptions(const PipelineOptions *options, std::os
   dumpFile << "options.reconfigWorkgroupLayout = " << options->reconfigWorkgroupLayout << "\n";
   dumpFile << "options.shadowDescriptorTableUsage = " << options->shadowDescriptorTableUsage << "\n";
   dumpFile << "options.shadowDescriptorTablePtrHigh = " << options->shadowDescriptorTablePtrHigh << "\n";
+  dumpFile << "options.fastCompile = " << options->fastCompile << "\n";
 }
 
 // =====================================================================================================================
@@ -761,7 +763,8 @@ void PipelineDumper::dumpGraphicsPipelineInfo(std::ostream *dumpFile, const char
 // =====================================================================================================================
 // Builds hash code from graphics pipline build info.  If stage is a specific stage of the graphics pipeline, then only
 // the portions of the pipeline build info that affect that stage will be included in the hash.  Otherwise, stage must
-// be ShaderStageInvalid, and all values in the build info will be included.
+// be ShaderStageInvalid, and all values in the build info will be included. For relocatable shaders, the
+// pre-rasterization stages are compiled together, so the vertex stage hash includes all of them.
 //
 // @param pipeline : Info to build a graphics pipeline
 // @param isCacheHash : TRUE if the hash is used by shader cache
@@ -775,6 +778,12 @@ MetroHash::Hash PipelineDumper::generateHashForGraphicsPipeline(const GraphicsPi
   switch (stage) {
   case ShaderStageVertex:
     updateHashForPipelineShaderInfo(ShaderStageVertex, &pipeline->vs, isCacheHash, &hasher, isRelocatableShader);
+    if (isRelocatableShader) {
+      updateHashForPipelineShaderInfo(ShaderStageTessControl, &pipeline->tcs, isCacheHash, &hasher,
+                                      isRelocatableShader);
+      updateHashForPipelineShaderInfo(ShaderStageTessEval, &pipeline->tes, isCacheHash, &hasher, isRelocatableShader);
+      updateHashForPipelineShaderInfo(ShaderStageGeometry, &pipeline->gs, isCacheHash, &hasher, isRelocatableShader);
+    }
     break;
   case ShaderStageTessControl:
     updateHashForPipelineShaderInfo(ShaderStageTessControl, &pipeline->tcs, isCacheHash, &hasher, isRelocatableShader);
@@ -802,6 +811,8 @@ MetroHash::Hash PipelineDumper::generateHashForGraphicsPipeline(const GraphicsPi
 
   hasher.Update(pipeline->iaState.deviceIndex);
 
+  // Vertex fetch and color export are compiled into the relocatable vertex and fragment shaders, as the ELF linker
+  // has no fetch prolog or export epilog, so the vertex input state and the color target state stay in their hashes.
   if (stage != ShaderStageFragment) {
     updateHashForVertexInputState(pipeline->pVertexInput, &hasher);
     updateHashForNonFragmentState(pipeline, isCacheHash, &hasher);
@@ -810,6 +821,11 @@ MetroHash::Hash PipelineDumper::generateHashForGraphicsPipeline(const GraphicsPi
   if (stage == ShaderStageFragment || stage == ShaderStageInvalid)
     updateHashForFragmentState(pipeline, &hasher);
 
+  // The fragment shader unit of a relocatable build, including a null fragment shader, does not hash the non-fragment
+  // state, which holds the compile tier for the other stages.
+  if (stage == ShaderStageFragment && isCacheHash)
+    hasher.Update(pipeline->options.fastCompile);
+
   MetroHash::Hash hash = {};
   hasher.Finalize(hash.bytes);
 
@@ -833,6 +849,7 @@ MetroHash::Hash PipelineDumper::generateHashForComputePipeline(const ComputePipe
   hasher.Update(pipeline->options.robustBufferAccess);
   hasher.Update(pipeline->options.shadowDescriptorTableUsage);
   hasher.Update(pipeline->options.shadowDescriptorTablePtrHigh);
+  hasher.Update(pipeline->options.fastCompile);
 
   MetroHash::Hash hash = {};
   hasher.Finalize(hash.bytes);
@@ -933,6 +950,7 @@ void PipelineDumper::updateHashForNonFragmentState(const GraphicsPipelineBuildIn
     hasher->Update(pipeline->options.reconfigWorkgroupLayout);
     hasher->Update(pipeline->options.shadowDescriptorTableUsage);
     hasher->Update(pipeline->options.shadowDescriptorTablePtrHigh);
+    hasher->Update(pipeline->options.fastCompile);
   }
 }
 
@@ -941,7 +959,11 @@ void PipelineDumper::updateHashForNonFragmentState(const GraphicsPipelineBuildIn
 //
 // @param pipeline : Info to build a graphics pipeline
 // @param [in,out] hasher : Hasher to generate hash code
-void PipelineDumper::updateHashForFragmentState(const GraphicsPipelineBuildInfo *pipeline, MetroHash64 *hasher) {
+// @param excludeColorTargets : TRUE to leave the per-target color state out of the hash. This is the case for the
+//                              per-stage cache hash, where the middle-end hashes the formats of the targets that are
+//                              actually written
+void PipelineDumper::updateHashForFragmentState(const GraphicsPipelineBuildInfo *pipeline, MetroHash64 *hasher,
+                                                bool excludeColorTargets) {
   auto rsState = &pipeline->rsState;
   hasher->Update(rsState->innerCoverage);
   hasher->Update(rsState->perSampleShading);
@@ -951,6 +973,8 @@ void PipelineDumper::updateHashForFragmentState(const GraphicsPipelineBuildInfo
   auto cbState = &pipeline->cbState;
   hasher->Update(cbState->alphaToCoverageEnable);
   hasher->Update(cbState->dualSourceBlendEnable);
+  if (excludeColorTargets)
+    return;
   for (unsigned i = 0; i < MaxColorTargets; ++i) {
     if (cbState->target[i].format != VK_FORMAT_UNDEFINED) {
       hasher->Update(cbState->target[i].channelWriteMask);
@@ -1051,6 +1075,7 @@ void PipelineDumper::updateHashForPipelineShaderInfo(ShaderStage stage, const Pi
 #endif
       hasher->Update(options.unrollThreshold);
       hasher->Update(options.scalarThreshold);
+      hasher->Update(options.loadScalarizerCostModel);
     }
   }
 }
@@ -1377,6 +1402,29 @@ OStream &operator<<(OStream &out, ElfReader<Elf> &reader) {
         ++symIdx;
         startPos = endPos;
       }
+    } else if (strcmp(section->name, ShaderStatsName) == 0) {
+      // Output shader statistics section, a msgpack map of statistics by hardware stage
+      out << section->name << " (size = " << section->secHead.sh_size << " bytes)\n";
+      msgpack::Document document;
+      StringRef blob(reinterpret_cast<const char *>(section->data), section->secHead.sh_size);
+      if (document.readFromBlob(blob, false) && document.getRoot().getKind() == msgpack::Type::Map) {
+        auto hwStages = document.getRoot().getMap()[".hardware_stages"];
+        if (hwStages.getKind() == msgpack::Type::Map) {
+          for (auto &hwStage : hwStages.getMap()) {
+            if (hwStage.first.getKind() != msgpack::Type::String || hwStage.second.getKind() != msgpack::Type::Map)
+              continue;
+            out << "    " << hwStage.first.getString().str() << ":\n";
+            for (auto &stat : hwStage.second.getMap()) {
+              if (stat.first.getKind() != msgpack::Type::String || stat.second.getKind() != msgpack::Type::UInt)
+                continue;
+              auto length = snprintf(formatBuf, sizeof(formatBuf), "        %-30s = %" PRIu64 "\n",
+                                     stat.first.getString().str().c_str(), stat.second.getUInt());
+              (void(length)); // unused
+              out << formatBuf;
+            }
+          }
+        }
+      }
     } else if (strncmp(section->name, Util::Abi::AmdGpuCommentName, sizeof(Util::Abi::AmdGpuCommentName) - 1) == 0) {
       auto name = section->name;
 #if PAL_CLIENT_INTERFACE_MAJOR_VERSION >= 475
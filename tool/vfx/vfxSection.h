@@ -973,13 +973,14 @@ public:
     INIT_STATE_MEMBER_NAME_TO_ADDR(SectionPipelineOption, reconfigWorkgroupLayout, MemberTypeBool, false);
     INIT_STATE_MEMBER_NAME_TO_ADDR(SectionPipelineOption, shadowDescriptorTableUsage, MemberTypeEnum, false);
     INIT_STATE_MEMBER_NAME_TO_ADDR(SectionPipelineOption, shadowDescriptorTablePtrHigh, MemberTypeInt, false);
+    INIT_STATE_MEMBER_NAME_TO_ADDR(SectionPipelineOption, fastCompile, MemberTypeBool, false);
     VFX_ASSERT(tableItem - &m_addrTable[0] <= MemberCount);
   }
 
   void getSubState(SubState &state) { state = m_state; };
 
 private:
-  static const unsigned MemberCount = 7;
+  static const unsigned MemberCount = 8;
   static StrToMemberAddr m_addrTable[MemberCount];
 
   SubState m_state;
@@ -1020,6 +1021,7 @@ public:
 #endif
     INIT_STATE_MEMBER_NAME_TO_ADDR(SectionShaderOption, unrollThreshold, MemberTypeInt, false);
     INIT_STATE_MEMBER_NAME_TO_ADDR(SectionShaderOption, scalarThreshold, MemberTypeInt, false);
+    INIT_STATE_MEMBER_NAME_TO_ADDR(SectionShaderOption, loadScalarizerCostModel, MemberTypeBool, false);
 
     VFX_ASSERT(tableItem - &m_addrTable[0] <= MemberCount);
   }
@@ -1027,7 +1029,7 @@ public:
   void getSubState(SubState &state) { state = m_state; };
 
 private:
-  static const unsigned MemberCount = 18;
+  static const unsigned MemberCount = 19;
   static StrToMemberAddr m_addrTable[MemberCount];
 
   SubState m_state;
@@ -152,6 +152,9 @@ static const char NoteName[] = ".note";         // Name of ".note" section
 static const char RelocName[] = ".rel.text";    // Name of ".reloc" section
 static const char CommentName[] = ".comment";   // Name of ".comment" section
 
+// Name of the section of static shader statistics, included by -include-shader-stats
+static const char ShaderStatsName[] = ".AMDGPU.comment.shaderstats";
+
 static const uint32_t NT_AMD_AMDGPU_ISA = 11; // Note type of AMDGPU ISA version
 
 // Represents the layout of standard note header